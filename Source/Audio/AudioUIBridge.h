@@ -1,8 +1,14 @@
 #pragma once
 
-#include "../Util/PluginModules.h"
+#include "../Util/CoreModules.h"
 #include "../Graph/RTData.h"
 #include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
 
 template <typename Command, int Capacity = 512>
 class CommandFifo
@@ -10,6 +16,14 @@ class CommandFifo
 public:
 
     void push(const Command& command)
+    {
+        if (!tryPush(command)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            jassertfalse;
+        }
+    }
+
+    bool tryPush(const Command& command)
     {
         const auto scope = fifo.write(1);
 
@@ -20,14 +34,22 @@ public:
             buffer[static_cast<size_t>(scope.startIndex2)] = command;
         }
         else {
-            jassertfalse;
+            return false;
         }
+
+        return true;
     }
 
     template <typename ApplyCommand>
     void drain(ApplyCommand&& apply)
     {
-        const auto scope = fifo.read(fifo.getNumReady());
+        drain(fifo.getNumReady(), std::forward<ApplyCommand>(apply));
+    }
+
+    template <typename ApplyCommand>
+    void drain(int count, ApplyCommand&& apply)
+    {
+        const auto scope = fifo.read(count);
 
         for (int i = 0; i < scope.blockSize1; ++i) {
             apply(buffer[static_cast<size_t>(scope.startIndex1 + i)]);
@@ -39,70 +61,450 @@ public:
     }
 
     bool hasPending() const { return fifo.getNumReady() > 0; }
+    int  numReady  () const { return fifo.getNumReady(); }
+    int  freeSpace () const { return fifo.getFreeSpace(); }
+
+    std::uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
 
 private:
 
     juce::AbstractFifo             fifo { Capacity };
     std::array<Command, Capacity>  buffer {};
+    std::atomic<std::uint64_t>     dropped { 0 };
+};
+
+template <typename State>
+class SeqlockCell
+{
+public:
+
+    static_assert(std::is_trivially_copyable_v<State>);
+
+    std::uint32_t version() const { return sequence.load(std::memory_order_acquire); }
+
+    State peek() const
+    {
+        std::array<std::uint32_t, wordCount> raw {};
+
+        for (int word = 0; word < wordCount; ++word) {
+            raw[static_cast<std::size_t>(word)] = words[static_cast<std::size_t>(word)].load(std::memory_order_relaxed);
+        }
+
+        State state;
+        std::memcpy(static_cast<void*>(&state), raw.data(), sizeof(State));
+
+        return state;
+    }
+
+    void store(const State& state)
+    {
+        std::array<std::uint32_t, wordCount> raw {};
+        std::memcpy(raw.data(), &state, sizeof(State));
+
+        const std::uint32_t current = sequence.load(std::memory_order_relaxed);
+
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (int word = 0; word < wordCount; ++word) {
+            words[static_cast<std::size_t>(word)].store(raw[static_cast<std::size_t>(word)], std::memory_order_relaxed);
+        }
+
+        sequence.store(current + 2, std::memory_order_release);
+    }
+
+    bool tryLoad(State& state, std::uint32_t& loadedVersion) const
+    {
+        const std::uint32_t before = sequence.load(std::memory_order_acquire);
+
+        if ((before & 1u) != 0) {
+            return false;
+        }
+
+        const State candidate = peek();
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (sequence.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+
+        state         = candidate;
+        loadedVersion = before;
+
+        return true;
+    }
+
+private:
+
+    static constexpr int wordCount = static_cast<int>((sizeof(State) + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t));
+
+    std::atomic<std::uint32_t>                        sequence { 0 };
+    std::array<std::atomic<std::uint32_t>, wordCount> words {};
+};
+
+template <typename State, int Capacity>
+class LatestStateTable
+{
+public:
+
+    static_assert((Capacity & (Capacity - 1)) == 0);
+
+    static constexpr int maxProbe = 32;
+
+    LatestStateTable() : slots(Capacity), order(Capacity, -1) {}
+
+    template <typename Change>
+    bool update(std::int64_t key, Change&& change)
+    {
+        bool      reclaimed = false;
+        const int slotIndex = claim(key, reclaimed);
+
+        if (slotIndex == -1) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        SeqlockCell<Entry>& cell = slots[static_cast<std::size_t>(slotIndex)].cell;
+
+        Entry entry = reclaimed ? Entry { key, State {} } : cell.peek();
+        change(entry.state);
+        cell.store(entry);
+
+        return true;
+    }
+
+    template <typename Change>
+    void updateAll(Change&& change)
+    {
+        const int count = entryCount.load(std::memory_order_relaxed);
+
+        for (int index = 0; index < count; ++index) {
+            SeqlockCell<Entry>& cell = slots[static_cast<std::size_t>(order[static_cast<std::size_t>(index)])].cell;
+
+            Entry entry = cell.peek();
+
+            if (change(entry.state)) {
+                cell.store(entry);
+            }
+        }
+    }
+
+    template <typename Visit>
+    void collectChanges(std::vector<std::uint32_t>& seenVersions, Visit&& visit)
+    {
+        const int count = entryCount.load(std::memory_order_acquire);
+
+        if (seenVersions.size() < static_cast<std::size_t>(count)) {
+            seenVersions.resize(static_cast<std::size_t>(count), 0);
+        }
+
+        for (int index = 0; index < count; ++index) {
+            Slot&          slot = slots[static_cast<std::size_t>(order[static_cast<std::size_t>(index)])];
+            std::uint32_t& seen = seenVersions[static_cast<std::size_t>(index)];
+
+            if (slot.cell.version() == seen) {
+                continue;
+            }
+
+            Entry         entry;
+            std::uint32_t version = 0;
+
+            if (!slot.cell.tryLoad(entry, version) || version == seen) {
+                continue;
+            }
+
+            seen = version;
+            visit(index, entry.key, entry.state);
+
+            slot.consumed.store(version, std::memory_order_release);
+        }
+    }
+
+    std::uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+
+    struct Entry
+    {
+        std::int64_t key = 0;
+        State        state;
+    };
+
+    struct Slot
+    {
+        std::int64_t               key      = 0;
+        bool                       occupied = false;
+        std::atomic<std::uint32_t> consumed { 0 };
+        SeqlockCell<Entry>         cell;
+    };
+
+    static std::size_t homeOf(std::int64_t key)
+    {
+        const auto hashed = static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15ull;
+
+        return static_cast<std::size_t>(hashed >> 32) & (Capacity - 1);
+    }
+
+    static bool isReclaimable(const Slot& slot)
+    {
+        return slot.cell.version() == slot.consumed.load(std::memory_order_acquire)
+            && slot.cell.peek().state.isIdle();
+    }
+
+    int claim(std::int64_t key, bool& reclaimed)
+    {
+        int candidate = -1;
+
+        for (int probe = 0; probe < maxProbe; ++probe) {
+            const std::size_t index = (homeOf(key) + static_cast<std::size_t>(probe)) & (Capacity - 1);
+            const Slot&       slot  = slots[index];
+
+            if (!slot.occupied) {
+                candidate = candidate == -1 ? static_cast<int>(index) : candidate;
+                break;
+            }
+
+            if (slot.key == key) {
+                return static_cast<int>(index);
+            }
+
+            if (candidate == -1 && isReclaimable(slot)) {
+                candidate = static_cast<int>(index);
+            }
+        }
+
+        if (candidate == -1) {
+            return -1;
+        }
+
+        Slot& slot = slots[static_cast<std::size_t>(candidate)];
+
+        if (!slot.occupied) {
+            const int count = entryCount.load(std::memory_order_relaxed);
+
+            slot.occupied = true;
+
+            order[static_cast<std::size_t>(count)] = candidate;
+            entryCount.store(count + 1, std::memory_order_release);
+        }
+
+        slot.key  = key;
+        reclaimed = true;
+
+        return candidate;
+    }
+
+    std::vector<Slot> slots;
+    std::vector<int>  order;
+
+    std::atomic<int>           entryCount { 0 };
+    std::atomic<std::uint64_t> dropped    { 0 };
 };
 
 class AudioUIBridge
 {
 public:
 
-    struct HighlightCommand
+    static constexpr int minMaskedTraversalId = -1;
+    static constexpr int maxMaskedTraversalId = 62;
+
+    struct AudioClock
     {
-        int  nodeId          = 0;
-        bool shouldHighlight = false;
-        int  traversalId     = -1;
+        std::int64_t blockStartSample = 0;
+        double       blockStartMs     = 0.0;
+        double       sampleRate       = 44100.0;
+        int          latencySamples   = 0;
     };
 
-    struct ProgressCommand
+    struct NodeVisualState
     {
-        int  parentNodeId = 0;
-        int  childNodeId  = 0;
-        int  durationMs   = 0;
-        int  graphId      = 0;
-        int  traversalId  = -1;
-        bool isConnection = false;
+        std::uint64_t highlightMask    = 0;
+        std::uint32_t pulseCount       = 0;
+        int           pulseTraversalId = -1;
+        int           currentCount     = 0;
+        int           countLimit       = 1;
+        bool          hasCount         = false;
+        std::int64_t  changedSample    = 0;
+
+        int           unmaskedTraversalId = -1;
+        int           unmaskedCount       = 0;
+
+        bool isIdle() const { return highlightMask == 0 && unmaskedCount == 0; }
     };
 
-    struct CountCommand
+    struct ArrowVisualState
     {
-        int nodeId       = 0;
-        int currentCount = 0;
-        int countLimit   = 1;
+        int           traversalId  = -1;
+        int           durationMs   = 0;
+        int           graphId      = 0;
+        bool          isConnection = false;
+        std::uint32_t stamp        = 0;
+        std::int64_t  startSample  = 0;
+
+        bool isIdle() const { return true; }
     };
 
     struct ResetCommand
     {
-        int rootId        = 0;
-        int traversalId   = -1;
+        int           rootId         = 0;
+        int           traversalId    = -1;
+        std::uint32_t stamp          = 0;
+        std::int64_t  samplePosition = 0;
+    };
+
+    struct LossCounters
+    {
+        std::uint64_t nodeVisualsDropped  = 0;
+        std::uint64_t arrowVisualsDropped = 0;
+        std::uint64_t resetsDropped       = 0;
     };
 
-    CommandFifo<HighlightCommand> highlights;
-    CommandFifo<ProgressCommand>  progress;
-    CommandFifo<ResetCommand>     arrowResets;
-    CommandFifo<CountCommand>     counts;
+    using NodeVisualTable  = LatestStateTable<NodeVisualState,  8192>;
+    using ArrowVisualTable = LatestStateTable<ArrowVisualState, 16384>;
+
+    NodeVisualTable           nodeVisuals;
+    ArrowVisualTable          arrowVisuals;
+    CommandFifo<ResetCommand> arrowResets;
+
+    static std::uint64_t traversalBit(int traversalId)
+    {
+        return std::uint64_t { 1 } << (traversalId - minMaskedTraversalId);
+    }
+
+    static std::int64_t arrowKey(int parentNodeId, int childNodeId)
+    {
+        return (static_cast<std::int64_t>(parentNodeId) << 32) ^ static_cast<std::uint32_t>(childNodeId);
+    }
+
+    static bool isStampAfter(std::uint32_t stamp, std::uint32_t reference)
+    {
+        return static_cast<std::int32_t>(stamp - reference) > 0;
+    }
+
+    static double wallClockMsAt(const AudioClock& clock, std::int64_t samplePosition)
+    {
+        const auto samplesFromBlock = static_cast<double>(samplePosition - clock.blockStartSample + clock.latencySamples);
+
+        return clock.blockStartMs + samplesFromBlock * 1000.0 / clock.sampleRate;
+    }
+
+    void beginBlock(double sampleRate, int latencySamples)
+    {
+        const double blockSampleMs = static_cast<double>(blockStartSample) * 1000.0 / sampleRate;
+        const double measuredDrift = juce::Time::getMillisecondCounterHiRes() - blockSampleMs;
+
+        if (!clockStarted || sampleRate != clockSampleRate || std::abs(measuredDrift - clockDriftMs) > clockResyncMs) {
+            clockDriftMs = measuredDrift;
+        }
+        else {
+            clockDriftMs += (measuredDrift - clockDriftMs) * clockSmoothing;
+        }
+
+        clockStarted    = true;
+        clockSampleRate = sampleRate;
+        eventOffset     = 0;
+
+        audioClock.store({ blockStartSample, blockSampleMs + clockDriftMs, sampleRate, latencySamples });
+    }
+
+    void endBlock(int numSamples)
+    {
+        blockStartSample += numSamples;
+    }
+
+    void setEventOffset(int sampleInBlock)
+    {
+        eventOffset = sampleInBlock;
+    }
+
+    bool readAudioClock(AudioClock& clock) const
+    {
+        std::uint32_t version = 0;
+
+        for (int attempt = 0; attempt < clockReadAttempts; ++attempt) {
+            if (audioClock.tryLoad(clock, version)) {
+                return version != 0;
+            }
+        }
+
+        return false;
+    }
 
     bool hasPendingCommands() const
     {
-        return highlights.hasPending()
-            || progress.hasPending()
-            || arrowResets.hasPending()
-            || counts.hasPending();
+        return visualsChanged.load(std::memory_order_relaxed)
+            || arrowResets.hasPending();
     }
 
-    static constexpr int allNodes = -1;
+    bool takeVisualChanges()
+    {
+        return visualsChanged.exchange(false, std::memory_order_acquire);
+    }
+
+    void discardPendingCommands()
+    {
+        visualsChanged.store(false, std::memory_order_relaxed);
+        arrowResets.drain([](const ResetCommand&) {});
+    }
+
+    LossCounters lossCounters() const
+    {
+        return { nodeVisuals.droppedCount(), arrowVisuals.droppedCount(), arrowResets.droppedCount() };
+    }
+
+    static bool isMaskedTraversal(int traversalId)
+    {
+        return traversalId >= minMaskedTraversalId && traversalId <= maxMaskedTraversalId;
+    }
 
     void highlightNode(int nodeId, bool shouldHighlight, int traversalId = -1)
     {
-        highlights.push({ nodeId, shouldHighlight, traversalId });
+        nodeVisuals.update(nodeId, [&](NodeVisualState& state) {
+            state.changedSample = eventPosition();
+
+            if (!isMaskedTraversal(traversalId)) {
+                if (shouldHighlight) {
+                    state.unmaskedTraversalId = traversalId;
+                    ++state.unmaskedCount;
+                }
+                else if (state.unmaskedCount > 0) {
+                    --state.unmaskedCount;
+                }
+            }
+            else if (shouldHighlight) {
+                state.highlightMask   |= traversalBit(traversalId);
+                state.pulseTraversalId = traversalId;
+                ++state.pulseCount;
+            }
+            else if (traversalId == -1) {
+                state.highlightMask = 0;
+                state.unmaskedCount = 0;
+            }
+            else {
+                state.highlightMask &= ~traversalBit(traversalId);
+            }
+        });
+
+        markChanged();
     }
 
     void clearAllHighlights()
     {
-        highlightNode(allNodes, false);
+        const std::int64_t position = eventPosition();
+
+        nodeVisuals.updateAll([position](NodeVisualState& state) {
+            if (state.highlightMask == 0 && state.unmaskedCount == 0) {
+                return false;
+            }
+
+            state.highlightMask = 0;
+            state.unmaskedCount = 0;
+            state.changedSample = position;
+            return true;
+        });
+
+        markChanged();
     }
 
     void highlightNode(const RTNode& node, bool shouldHighlight, int traversalId = -1)
@@ -112,16 +514,53 @@ public:
 
     void pushProgress(int parentNodeId, int childNodeId, int durationMs, int graphId, int traversalId, bool isConnection = false)
     {
-        progress.push({ parentNodeId, childNodeId, durationMs, graphId, traversalId, isConnection });
+        const std::uint32_t stamp = ++nextStamp;
+
+        arrowVisuals.update(arrowKey(parentNodeId, childNodeId), [&](ArrowVisualState& state) {
+            state = { traversalId, durationMs, graphId, isConnection, stamp, eventPosition() };
+        });
+
+        markChanged();
     }
 
     void pushArrowReset(int rootId, int traversalId = -1)
     {
-        arrowResets.push({ rootId, traversalId });
+        arrowResets.push({ rootId, traversalId, ++nextStamp, eventPosition() });
     }
 
     void pushCount(int nodeId, int currentCount, int countLimit)
     {
-        counts.push({ nodeId, currentCount, countLimit });
+        nodeVisuals.update(nodeId, [&](NodeVisualState& state) {
+            state.currentCount  = currentCount;
+            state.countLimit    = countLimit;
+            state.hasCount      = true;
+            state.changedSample = eventPosition();
+        });
+
+        markChanged();
     }
+
+private:
+
+    static constexpr double clockSmoothing    = 0.05;
+    static constexpr double clockResyncMs     = 50.0;
+    static constexpr int    clockReadAttempts = 4;
+
+    void markChanged()
+    {
+        visualsChanged.store(true, std::memory_order_release);
+    }
+
+    std::int64_t eventPosition() const { return blockStartSample + eventOffset; }
+
+    std::atomic<bool> visualsChanged { false };
+    std::uint32_t     nextStamp      = 0;
+
+    SeqlockCell<AudioClock> audioClock;
+
+    std::int64_t blockStartSample = 0;
+    int          eventOffset      = 0;
+    bool         clockStarted     = false;
+    double       clockSampleRate  = 0.0;
+    double       clockDriftMs     = 0.0;
 };
@@ -1,13 +1,12 @@
 #include "EventManager.h"
-#include "../Plugin/PluginProcessor.h"
+#include "SequenceTreeEngine.h"
 
-EventManager::EventManager(SequenceTreeAudioProcessor* p)
-    : dispatcher(*p, scheduler, bridge)
+EventManager::EventManager(SequenceTreeEngine& engine)
+    : dispatcher(engine, scheduler, bridge)
 {
-    jassert(p != nullptr);
 }
 
-void EventManager::handleOrphanNotes(juce::MidiBuffer& midiMessages, const NodeMap& nodes, TraversalPool& traversalMap)
+void EventManager::handleOrphanNotes(juce::MidiBuffer& midiMessages, const RTNodeDirectory& nodes, TraversalPool& traversalMap)
 {
     auto& activeNotes = scheduler.activeNotes;
 
@@ -41,18 +40,30 @@ void EventManager::handleOrphanNotes(juce::MidiBuffer& midiMessages, const NodeM
             continue;
         }
 
-        traversal.primary.target = traversal.rootId;
-        traversal.state          = TraversalLogic::TraversalState::Active;
+        traversal.primary.target   = traversal.rootId;
+        traversal.primary.lastEdge = -1;
+        traversal.state            = TraversalLogic::TraversalState::Active;
         traversal.advanceAlternative(nodes, traversal.rootId);
         bridge.highlightNode(rootIt->second, true, traversal.traversal.traversalId);
         dispatcher.pushNote(rootIt->second, orphanedInstanceId, { nodes, traversalMap, midiMessages }, 0);
     }
 }
 
+void EventManager::beginBlock(double sampleRate, const TransportClock::HostPosition* host)
+{
+    scheduler.beginBlock(sampleRate, host);
+    dispatcher.beginBlock();
+    dispatcher.rebasePendingFlags();
+}
+
 void EventManager::processEvents(int numSamples, juce::MidiBuffer& midiMessages,
-                                   const NodeMap& nodes, TraversalPool& traversalMap)
+                                   const RTNodeDirectory& nodes, TraversalPool& traversalMap,
+                                   std::uint64_t snapshotGeneration)
 {
-    handleOrphanNotes(midiMessages, nodes, traversalMap);
+    if (snapshotGeneration != orphanCheckGeneration) {
+        handleOrphanNotes(midiMessages, nodes, traversalMap);
+        orphanCheckGeneration = snapshotGeneration;
+    }
 
     dispatcher.advancePendingFlags(numSamples, { nodes, traversalMap, midiMessages });
 
@@ -60,42 +71,39 @@ void EventManager::processEvents(int numSamples, juce::MidiBuffer& midiMessages,
 
     while (true)
     {
-        int smallestNoteIndex  = -1;
-        int smallestNoteSamples = numSamples + 1;
-
-        for (int i = 0; i < static_cast<int>(activeNotes.size()); ++i)
-        {
-            if (activeNotes[i].remainingSamples < smallestNoteSamples) {
-                smallestNoteSamples = activeNotes[i].remainingSamples;
-                smallestNoteIndex   = i;
-            }
-        }
+        const int earliestNoteIndex = scheduler.earliestNoteIndex();
 
-        if (smallestNoteIndex == -1 || smallestNoteSamples > numSamples) {
+        if (earliestNoteIndex == -1) {
             break;
         }
 
-        int priorityNoteDuration = smallestNoteSamples;
-        auto& activeNote = activeNotes[smallestNoteIndex];
+        auto& activeNote = activeNotes[static_cast<size_t>(earliestNoteIndex)];
+
+        const int priorityNoteDuration = juce::jmax(0, scheduler.samplesUntilExpiry(activeNote));
+
+        if (priorityNoteDuration >= numSamples) {
+            break;
+        }
 
         scheduler.sendNoteOff(activeNote, midiMessages, priorityNoteDuration);
+        bridge.setEventOffset(priorityNoteDuration);
 
         if (activeNote.instanceId == -1) {
             if (NoteScheduler::isNodeAudible(activeNote.nodeType)) {
                 bridge.highlightNode(activeNote.nodeId, false);
             }
-            scheduler.removeNote(smallestNoteIndex);
+            scheduler.removeNote(earliestNoteIndex);
             continue;
         }
 
         NoteScheduler::ActiveNote expiredNote = activeNote;
-        scheduler.removeNote(smallestNoteIndex);
+        scheduler.removeNote(earliestNoteIndex);
 
+        scheduler.beginChain(expiredNote);
         dispatcher.handleExpiredNote(expiredNote, priorityNoteDuration,
                                      { nodes, traversalMap, midiMessages });
+        scheduler.endChain();
     }
 
-    for (auto& note : activeNotes) {
-        note.remainingSamples -= numSamples;
-    }
+    scheduler.advanceClock(numSamples);
 }
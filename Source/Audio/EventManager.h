@@ -4,7 +4,7 @@
 #include "NoteScheduler.h"
 #include "TraversalDispatcher.h"
 
-class SequenceTreeAudioProcessor;
+class SequenceTreeEngine;
 
 class EventManager
 {
@@ -14,13 +14,18 @@ public:
     NoteScheduler       scheduler   { bridge };
     TraversalDispatcher dispatcher;
 
-    explicit EventManager(SequenceTreeAudioProcessor* p);
+    explicit EventManager(SequenceTreeEngine& engine);
+
+    void beginBlock(double sampleRate, const TransportClock::HostPosition* host);
 
     void processEvents(int numSamples, juce::MidiBuffer& midiMessages,
-                       const NodeMap& nodes, TraversalPool& traversalMap);
+                       const RTNodeDirectory& nodes, TraversalPool& traversalMap,
+                       std::uint64_t snapshotGeneration);
 
 private:
 
     void handleOrphanNotes(juce::MidiBuffer& midiMessages,
-                           const NodeMap& nodes, TraversalPool& traversalMap);
+                           const RTNodeDirectory& nodes, TraversalPool& traversalMap);
+
+    std::uint64_t orphanCheckGeneration = 0;
 };
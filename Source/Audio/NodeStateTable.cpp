@@ -1,13 +1,17 @@
 #include "NodeStateTable.h"
 
+#include "../Graph/RTNodeDirectory.h"
+
 #include <algorithm>
 #include <cassert>
+#include <utility>
 
 int NodeStateTable::defaultValue(NodeStateSlot slot)
 {
     switch (slot) {
         case NodeStateSlot::ActiveAlternative:
         case NodeStateSlot::LastNode:
+        case NodeStateSlot::LastEdge:
             return -1;
 
         default:
@@ -15,79 +19,148 @@ int NodeStateTable::defaultValue(NodeStateSlot slot)
     }
 }
 
-int NodeStateTable::indexOf(NodeStateSlot slot, int nodeId)
+int NodeStateTable::capacityFor(int stateSlotCount)
 {
-    return static_cast<int>(slot) * maxNodeIds + nodeId;
+    int capacity = defaultCapacity;
+
+    while (capacity < stateSlotCount) {
+        capacity *= 2;
+    }
+
+    return capacity;
 }
 
-void NodeStateTable::prepare()
+int NodeStateTable::coldIndexOf(NodeStateSlot slot)
 {
-    if (values.size() == static_cast<std::size_t>(slotCount) * maxNodeIds) {
-        return;
+    switch (slot) {
+        case NodeStateSlot::SwitchCount:     return 0;
+        case NodeStateSlot::SubRootCount:    return 1;
+        case NodeStateSlot::ModulatorCount:  return 2;
+        case NodeStateSlot::Trigger:         return 3;
+        case NodeStateSlot::Chord:           return 4;
+        case NodeStateSlot::CrossTree:       return 5;
+        case NodeStateSlot::CrossTreeSwitch: return 6;
+
+        default:
+            assert(false && "slot is stored in the hot state");
+            return 0;
     }
+}
 
-    values.assign(static_cast<std::size_t>(slotCount) * maxNodeIds, 0);
+template <typename Hot, typename Cold>
+auto& NodeStateTable::slotOf(Hot& hot, Cold& cold, NodeStateSlot slot)
+{
+    switch (slot) {
+        case NodeStateSlot::Count:             return hot.count;
+        case NodeStateSlot::LastNode:          return hot.lastNode;
+        case NodeStateSlot::LastEdge:          return hot.lastEdge;
+        case NodeStateSlot::ActiveAlternative: return hot.activeAlternative;
 
-    clear();
+        default:
+            return cold[static_cast<std::size_t>(coldIndexOf(slot))];
+    }
 }
 
-void NodeStateTable::clear()
+int NodeStateTable::indexOf(int nodeId) const
 {
-    if (values.empty()) {
+    const int index = directory != nullptr ? directory->stateIndexOf(nodeId) : -1;
+
+    return index < storage.capacity() ? index : -1;
+}
+
+void NodeStateTable::prepare(int nodeCapacity)
+{
+    if (storage.capacity() == nodeCapacity) {
         return;
     }
 
-    for (int slot = 0; slot < slotCount; ++slot) {
-        const auto begin = values.begin() + static_cast<std::ptrdiff_t>(slot) * maxNodeIds;
+    storage = NodeStateStorage(nodeCapacity);
+    epoch   = 1;
+}
+
+void NodeStateTable::clear()
+{
+    if (++epoch != 0) {
+        return;
+    }
 
-        std::fill(begin, begin + maxNodeIds, defaultValue(static_cast<NodeStateSlot>(slot)));
+    for (auto& hot : storage.hot) {
+        hot.epoch = 0;
     }
+
+    epoch = 1;
+}
+
+void NodeStateTable::adopt(NodeStateStorage& larger)
+{
+    assert(larger.capacity() >= storage.capacity());
+
+    std::copy(storage.hot .begin(), storage.hot .end(), larger.hot .begin());
+    std::copy(storage.cold.begin(), storage.cold.end(), larger.cold.begin());
+
+    std::swap(storage, larger);
 }
 
-bool NodeStateTable::isAddressable(int nodeId) const
+int* NodeStateTable::liveSlot(NodeStateSlot slot, int nodeId)
 {
-    if (values.empty()) {
-        return false;
+    if (nodeId < 0) {
+        return nullptr;
+    }
+
+    const int index = indexOf(nodeId);
+
+    if (index == -1) {
+        ++overflows;
+        return nullptr;
     }
 
-    assert(inRange(nodeId) && "node id exceeded NodeStateTable::maxNodeIds");
+    auto& hot  = storage.hot [static_cast<std::size_t>(index)];
+    auto& cold = storage.cold[static_cast<std::size_t>(index)];
 
-    return inRange(nodeId);
+    if (hot.epoch != epoch || hot.nodeId != nodeId) {
+        hot = { nodeId, epoch, 0, -1, -1, -1 };
+        cold.fill(0);
+    }
+
+    return &slotOf(hot, cold, slot);
 }
 
 int NodeStateTable::get(NodeStateSlot slot, int nodeId) const
 {
-    if (!isAddressable(nodeId)) {
+    const int index = indexOf(nodeId);
+
+    if (index == -1) {
         return defaultValue(slot);
     }
 
-    return values[static_cast<std::size_t>(indexOf(slot, nodeId))];
-}
+    const auto& hot = storage.hot[static_cast<std::size_t>(index)];
+
+    if (hot.epoch != epoch || hot.nodeId != nodeId) {
+        return defaultValue(slot);
+    }
 
+    return slotOf(hot, storage.cold[static_cast<std::size_t>(index)], slot);
+}
 void NodeStateTable::set(NodeStateSlot slot, int nodeId, int value)
 {
-    if (!isAddressable(nodeId)) {
-        return;
+    if (int* slotValue = liveSlot(slot, nodeId)) {
+        *slotValue = value;
     }
-
-    values[static_cast<std::size_t>(indexOf(slot, nodeId))] = value;
 }
 
 int NodeStateTable::increment(NodeStateSlot slot, int nodeId)
 {
-    if (!isAddressable(nodeId)) {
-        return defaultValue(slot);
-    }
+    int* value = liveSlot(slot, nodeId);
 
-    return ++values[static_cast<std::size_t>(indexOf(slot, nodeId))];
+    return value != nullptr ? ++*value : defaultValue(slot);
 }
 
 int& NodeStateTable::ref(NodeStateSlot slot, int nodeId)
 {
-    if (!isAddressable(nodeId)) {
-        outOfRangeSink = defaultValue(slot);
-        return outOfRangeSink;
+    if (int* value = liveSlot(slot, nodeId)) {
+        return *value;
     }
 
-    return values[static_cast<std::size_t>(indexOf(slot, nodeId))];
+    outOfRangeSink = defaultValue(slot);
+    return outOfRangeSink;
 }
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <vector>
 
+class RTNodeDirectory;
+
 enum class NodeStateSlot
 {
     Count,
@@ -13,19 +17,68 @@ enum class NodeStateSlot
     CrossTree,
     CrossTreeSwitch,
     ActiveAlternative,
-    LastNode
+    LastNode,
+    LastEdge
+};
+
+struct NodeStateStorage
+{
+    struct HotState
+    {
+        int           nodeId            = -1;
+        std::uint32_t epoch             = 0;
+        int           count             = 0;
+        int           lastNode          = -1;
+        int           lastEdge          = -1;
+        int           activeAlternative = -1;
+    };
+
+    static constexpr int coldSlotCount = 7;
+
+    using ColdState = std::array<int, coldSlotCount>;
+
+    NodeStateStorage() = default;
+
+    explicit NodeStateStorage(int capacity)
+        : hot (static_cast<std::size_t>(capacity)),
+          cold(static_cast<std::size_t>(capacity))
+    {}
+
+    int capacity() const { return static_cast<int>(hot.size()); }
+
+    std::vector<HotState>  hot;
+    std::vector<ColdState> cold;
+};
+
+struct NodeStateReserve
+{
+    NodeStateReserve(int nodeCapacity, int tableCount)
+        : capacity(nodeCapacity),
+          storages(static_cast<std::size_t>(tableCount), NodeStateStorage(nodeCapacity))
+    {}
+
+    const int                     capacity;
+    std::vector<NodeStateStorage> storages;
 };
 
 class NodeStateTable
 {
 public:
 
-    static constexpr int slotCount  = 10;
-    static constexpr int maxNodeIds = 1024;
+    static constexpr int slotCount       = 11;
+    static constexpr int defaultCapacity = 256;
 
-    void prepare();
+    void prepare(int nodeCapacity = defaultCapacity);
     void clear();
 
+    void adopt(NodeStateStorage& larger);
+
+    void bind(const RTNodeDirectory* nodeDirectory) { directory = nodeDirectory; }
+
+    int capacity() const { return storage.capacity(); }
+
+    std::uint64_t overflowCount() const { return overflows; }
+
     int  get      (NodeStateSlot slot, int nodeId) const;
     void set      (NodeStateSlot slot, int nodeId, int value);
     int  increment(NodeStateSlot slot, int nodeId);
@@ -33,14 +86,23 @@ public:
 
     static int defaultValue(NodeStateSlot slot);
 
+    static int capacityFor(int stateSlotCount);
+
 private:
 
-    static bool inRange(int nodeId) { return nodeId >= 0 && nodeId < maxNodeIds; }
-    static int  indexOf(NodeStateSlot slot, int nodeId);
+    template <typename Hot, typename Cold>
+    static auto& slotOf(Hot& hot, Cold& cold, NodeStateSlot slot);
+
+    static int coldIndexOf(NodeStateSlot slot);
+
+    int indexOf(int nodeId) const;
 
-    bool isAddressable(int nodeId) const;
+    int* liveSlot(NodeStateSlot slot, int nodeId);
 
-    std::vector<int> values;
+    NodeStateStorage       storage;
+    std::uint32_t          epoch     = 1;
+    const RTNodeDirectory* directory = nullptr;
+    std::uint64_t          overflows = 0;
 
     int outOfRangeSink = 0;
 };
@@ -5,6 +5,7 @@ NoteScheduler::NoteScheduler(AudioUIBridge& b)
     : bridge(b)
 {
     activeNotes.reserve(maxExpectedActiveNotes);
+    expiryHeap.reserve(maxExpectedActiveNotes);
 }
 
 bool NoteScheduler::isNodeAudible(RTNode::NodeType nodeType)
@@ -15,7 +16,7 @@ bool NoteScheduler::isNodeAudible(RTNode::NodeType nodeType)
 
 void NoteScheduler::scheduleNote(const RTNode& node, int instanceId, int sample,
                                  juce::MidiBuffer& midiMessages,
-                                 double sampleRate, double tempoMultiplier,
+                                 double tempoMultiplier,
                                  int duration, bool isConnectionTrigger, int channel, int transpose,
                                  double velocityMultiplier,
                                  int pitchOverride, int velocityOverride)
@@ -25,7 +26,8 @@ void NoteScheduler::scheduleNote(const RTNode& node, int instanceId, int sample,
     newNote.event.pitch         = 63;
     newNote.event.velocity      = 63;
     newNote.event.duration      = duration;
-    newNote.remainingSamples    = static_cast<int>((duration / 1000.0) * sampleRate / tempoMultiplier);
+    newNote.endTime             = positionAfter(sample, duration, tempoMultiplier);
+    newNote.sequence            = nextSequence++;
     newNote.nodeId              = node.nodeID;
     newNote.nodeType            = node.nodeType;
     newNote.isConnectionTrigger = isConnectionTrigger;
@@ -60,7 +62,11 @@ void NoteScheduler::scheduleNote(const RTNode& node, int instanceId, int sample,
         newNote.event.velocity = juce::jlimit(0, 127, juce::roundToInt(newNote.event.velocity * velocityMultiplier));
     }
 
+    const int noteIndex = static_cast<int>(activeNotes.size());
+
     activeNotes.push_back(newNote);
+    expiryHeap.push_back(noteIndex);
+    siftUp(static_cast<int>(expiryHeap.size()) - 1);
 
     if (!isConnectionTrigger && isNodeAudible(node.nodeType)) {
         midiMessages.addEvent(juce::MidiMessage::noteOn(newNote.event.midiChannel, newNote.event.pitch,
@@ -82,10 +88,141 @@ void NoteScheduler::sendNoteOff(const ActiveNote& note, juce::MidiBuffer& midiMe
 
 void NoteScheduler::removeNote(int index)
 {
-    activeNotes[index] = std::move(activeNotes.back());
+    removeFromHeap(activeNotes[static_cast<size_t>(index)].heapIndex);
+
+    const int lastIndex = static_cast<int>(activeNotes.size()) - 1;
+
+    if (index != lastIndex) {
+        activeNotes[static_cast<size_t>(index)] = std::move(activeNotes.back());
+        placeInHeap(activeNotes[static_cast<size_t>(index)].heapIndex, index);
+    }
+
     activeNotes.pop_back();
 }
 
+void NoteScheduler::clear()
+{
+    activeNotes.clear();
+    expiryHeap.clear();
+}
+
+void NoteScheduler::beginBlock(double sampleRate, const TransportClock::HostPosition* host)
+{
+    clock.beginBlock(sampleRate, host);
+
+    if (!clock.hasRebased()) {
+        return;
+    }
+
+    for (ActiveNote& note : activeNotes) {
+        note.endTime = clock.rebase(note.endTime);
+    }
+
+    rebuildHeap();
+}
+
+std::int64_t NoteScheduler::positionAfter(int sample, double durationMs, double tempoMultiplier) const
+{
+    const std::int64_t start = hasChainOrigin ? chainOrigin : clock.positionAt(sample);
+
+    return start + clock.durationFromMs(durationMs, tempoMultiplier);
+}
+
+bool NoteScheduler::expiresBefore(int leftNoteIndex, int rightNoteIndex) const
+{
+    const ActiveNote& left  = activeNotes[static_cast<size_t>(leftNoteIndex)];
+    const ActiveNote& right = activeNotes[static_cast<size_t>(rightNoteIndex)];
+
+    if (left.endTime != right.endTime) {
+        return left.endTime < right.endTime;
+    }
+
+    return left.sequence < right.sequence;
+}
+
+void NoteScheduler::placeInHeap(int heapIndex, int noteIndex)
+{
+    expiryHeap[static_cast<size_t>(heapIndex)]           = noteIndex;
+    activeNotes[static_cast<size_t>(noteIndex)].heapIndex = heapIndex;
+}
+
+void NoteScheduler::siftUp(int heapIndex)
+{
+    const int noteIndex = expiryHeap[static_cast<size_t>(heapIndex)];
+
+    while (heapIndex > 0) {
+        const int parentIndex = (heapIndex - 1) / 2;
+        const int parentNote  = expiryHeap[static_cast<size_t>(parentIndex)];
+
+        if (!expiresBefore(noteIndex, parentNote)) {
+            break;
+        }
+
+        placeInHeap(heapIndex, parentNote);
+        heapIndex = parentIndex;
+    }
+
+    placeInHeap(heapIndex, noteIndex);
+}
+
+void NoteScheduler::siftDown(int heapIndex)
+{
+    const int heapSize  = static_cast<int>(expiryHeap.size());
+    const int noteIndex = expiryHeap[static_cast<size_t>(heapIndex)];
+
+    while (true) {
+        int earliestChild = 2 * heapIndex + 1;
+
+        if (earliestChild >= heapSize) {
+            break;
+        }
+
+        const int rightChild = earliestChild + 1;
+
+        if (rightChild < heapSize
+            && expiresBefore(expiryHeap[static_cast<size_t>(rightChild)],
+                             expiryHeap[static_cast<size_t>(earliestChild)])) {
+            earliestChild = rightChild;
+        }
+
+        const int childNote = expiryHeap[static_cast<size_t>(earliestChild)];
+
+        if (!expiresBefore(childNote, noteIndex)) {
+            break;
+        }
+
+        placeInHeap(heapIndex, childNote);
+        heapIndex = earliestChild;
+    }
+
+    placeInHeap(heapIndex, noteIndex);
+}
+
+void NoteScheduler::removeFromHeap(int heapIndex)
+{
+    const int lastHeapIndex = static_cast<int>(expiryHeap.size()) - 1;
+
+    const int movedNote = expiryHeap.back();
+
+    expiryHeap.pop_back();
+
+    if (heapIndex == lastHeapIndex) {
+        return;
+    }
+
+    placeInHeap(heapIndex, movedNote);
+
+    siftDown(heapIndex);
+    siftUp(activeNotes[static_cast<size_t>(movedNote)].heapIndex);
+}
+
+void NoteScheduler::rebuildHeap()
+{
+    for (int heapIndex = static_cast<int>(expiryHeap.size()) / 2 - 1; heapIndex >= 0; --heapIndex) {
+        siftDown(heapIndex);
+    }
+}
+
 void NoteScheduler::handleOrphanNoteOff(const ActiveNote& note, juce::MidiBuffer& midiMessages)
 {
     if (isNoteSounding(note)) {
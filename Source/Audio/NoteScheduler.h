@@ -1,7 +1,9 @@
 #pragma once
 
-#include "../Util/PluginModules.h"
+#include "../Util/CoreModules.h"
 #include "../Graph/RTData.h"
+#include "TransportClock.h"
+#include <cstdint>
 #include <vector>
 
 class AudioUIBridge;
@@ -22,10 +24,13 @@ public:
     {
         MidiEvent        event;
         int              instanceId       = 0;
-        int              remainingSamples = 0;
+        std::int64_t     endTime          = 0;
         int              nodeId           = 0;
         RTNode::NodeType nodeType         = RTNode::NodeType::Node;
         bool             isConnectionTrigger = false;
+
+        std::uint64_t    sequence  = 0;
+        int              heapIndex = -1;
     };
 
     static constexpr int maxExpectedActiveNotes = 256;
@@ -34,9 +39,23 @@ public:
 
     explicit NoteScheduler(AudioUIBridge& bridge);
 
+    int  earliestNoteIndex() const { return expiryHeap.empty() ? -1 : expiryHeap.front(); }
+    int  samplesUntilExpiry(const ActiveNote& note) const { return clock.sampleOffset(note.endTime); }
+    void clear();
+
+    void beginBlock(double sampleRate, const TransportClock::HostPosition* host);
+    void advanceClock(int numSamples) { clock.endBlock(numSamples); }
+
+    const TransportClock& getClock() const { return clock; }
+
+    void beginChain(const ActiveNote& expiredNote) { chainOrigin = expiredNote.endTime; hasChainOrigin = true; }
+    void endChain() { hasChainOrigin = false; }
+
+    std::int64_t positionAfter(int sample, double durationMs, double tempoMultiplier) const;
+
     void scheduleNote(const RTNode& node, int instanceId, int sample,
                       juce::MidiBuffer& midiMessages,
-                      double sampleRate, double tempoMultiplier,
+                      double tempoMultiplier,
                       int duration, bool isConnectionTrigger = false, int channel = -1, int transpose = 0,
                       double velocityMultiplier = 1.0,
                       int pitchOverride = -1, int velocityOverride = -1);
@@ -51,5 +70,20 @@ public:
 
 private:
 
+    bool expiresBefore(int leftNoteIndex, int rightNoteIndex) const;
+
+    void placeInHeap(int heapIndex, int noteIndex);
+    void siftUp     (int heapIndex);
+    void siftDown   (int heapIndex);
+    void removeFromHeap(int heapIndex);
+    void rebuildHeap();
+
     AudioUIBridge& bridge;
+
+    std::vector<int> expiryHeap;
+
+    TransportClock clock;
+    std::uint64_t  nextSequence   = 0;
+    std::int64_t   chainOrigin    = 0;
+    bool           hasChainOrigin = false;
 };
@@ -0,0 +1,212 @@
+#include "OfflineRenderer.h"
+#include "RuleCompiler.h"
+#include "../Graph/ValueTreeIdentifiers.h"
+
+#include <algorithm>
+#include <limits>
+
+juce::Optional<juce::AudioPlayHead::PositionInfo> OfflineRenderer::BlockPlayHead::getPosition() const
+{
+    PositionInfo info;
+
+    info.setBpm(bpm);
+    info.setPpqPosition(ppq);
+    info.setIsPlaying(playing);
+
+    return info;
+}
+
+OfflineRenderer::OfflineRenderer(Settings newSettings)
+    : settings(newSettings)
+{
+    jassert(settings.sampleRate > 0.0 && settings.blockSize > 0 && settings.bpm > 0.0);
+}
+
+bool OfflineRenderer::loadState(const void* data, int sizeInBytes)
+{
+    return loadState(ValueTreeState::decodeStateBlob(data, sizeInBytes));
+}
+
+bool OfflineRenderer::loadState(const juce::ValueTree& state)
+{
+    if (!state.isValid()) {
+        return false;
+    }
+
+    hostSynced = settings.hostSynced.value_or(state.getProperty(ValueTreeIdentifiers::SyncToHost, false));
+
+    graphState.replaceState(state);
+    compileStoredRules();
+    rtGraphBuilder.rebuildAllGraphs();
+
+    return !rtGraphBuilder.rtGraphs.empty();
+}
+
+void OfflineRenderer::compileStoredRules()
+{
+    auto compileSource = [](const juce::ValueTree& data) -> std::shared_ptr<const ScriptTraversalRule::Program> {
+        if (!data.hasProperty(ValueTreeIdentifiers::SelectionRuleSource)) {
+            return nullptr;
+        }
+
+        const RuleCompileResult result = RuleCompiler::compile(data.getProperty(ValueTreeIdentifiers::SelectionRuleSource).toString());
+
+        return result.succeeded ? ScriptTraversalRule::compile(result.script) : nullptr;
+    };
+
+    engine.clearTraversalRules();
+    engine.setSelectionRule(compileSource(graphState.traversalMap));
+
+    for (int i = 0; i < graphState.traversalMap.getNumChildren(); ++i) {
+        const juce::ValueTree traversalData = graphState.traversalMap.getChild(i);
+
+        const int ruleIndex = traversalData.getProperty(ValueTreeIdentifiers::SelectionRuleIndex, -1);
+
+        if (ruleIndex < 0 || ruleIndex >= TraversalSession::maxTraversalRules) {
+            continue;
+        }
+
+        if (auto program = compileSource(traversalData)) {
+            engine.setTraversalRule(ruleIndex, std::move(program));
+        }
+    }
+}
+
+OfflineRenderer::Result OfflineRenderer::render(juce::MidiFile& midiFile)
+{
+    Result result;
+
+    engine.prepare(settings.sampleRate);
+    engine.syncToHost.store(hostSynced);
+    engine.isPlaying.store(true);
+
+    playHead.bpm = settings.bpm;
+
+    juce::MidiMessageSequence sequence;
+    sequence.addEvent(juce::MidiMessage::tempoMetaEvent(juce::roundToInt(60000000.0 / settings.bpm)), 0.0);
+
+    juce::MidiBuffer midiMessages;
+
+    auto appendEvents = [this, &sequence, &midiMessages, &result](std::int64_t blockStart) {
+        for (const auto metadata : midiMessages) {
+            const juce::MidiMessage message = metadata.getMessage();
+
+            if (message.isNoteOn()) {
+                ++result.noteCount;
+            }
+
+            sequence.addEvent(message, ticksAt(blockStart + metadata.samplePosition));
+        }
+    };
+
+    std::int64_t position = 0;
+
+    while (!isRenderComplete(position, result)) {
+        playHead.ppq = static_cast<double>(position) / settings.sampleRate * settings.bpm / 60.0;
+
+        engine.processBlock(hostSynced ? &playHead : nullptr, settings.blockSize, midiMessages);
+        engine.eventManager.bridge.discardPendingCommands();
+
+        appendEvents(position);
+
+        position += settings.blockSize;
+    }
+
+    midiMessages.clear();
+    engine.traversalSession.silenceAllNotes(midiMessages);
+    engine.eventManager.bridge.discardPendingCommands();
+    engine.isPlaying.store(false);
+
+    appendEvents(position);
+
+    sequence.updateMatchedPairs();
+
+    midiFile.clear();
+    midiFile.setTicksPerQuarterNote(TransportClock::ticksPerQuarter);
+    midiFile.addTrack(sequence);
+
+    result.renderedSamples = position;
+
+    return result;
+}
+
+OfflineRenderer::Result OfflineRenderer::renderToFile(const juce::File& destination)
+{
+    juce::MidiFile midiFile;
+
+    Result result = render(midiFile);
+
+    destination.deleteFile();
+
+    juce::FileOutputStream stream(destination);
+
+    if (stream.openedOk()) {
+        result.written = midiFile.writeTo(stream);
+    }
+
+    return result;
+}
+
+bool OfflineRenderer::isRenderComplete(std::int64_t renderedSamples, Result& result)
+{
+    const double renderedSeconds = static_cast<double>(renderedSamples) / settings.sampleRate;
+
+    if (renderedSeconds >= settings.maxSeconds) {
+        return true;
+    }
+
+    if (settings.seconds > 0.0 && renderedSeconds >= settings.seconds) {
+        result.finished = true;
+        return true;
+    }
+
+    if (settings.loops <= 0) {
+        return false;
+    }
+
+    countLoops();
+
+    int  fewestLoops = std::numeric_limits<int>::max();
+    bool allEnded    = true;
+    bool anyRunning  = false;
+
+    for (const auto& [instanceId, instance] : engine.traversalSession.getTraversals()) {
+        if (instance.runtime.isSpawned()) {
+            continue;
+        }
+
+        anyRunning  = true;
+        allEnded    = allEnded && instance.logic.state == TraversalLogic::TraversalState::End;
+        fewestLoops = std::min(fewestLoops, loopsByInstance[instanceId]);
+    }
+
+    if (!anyRunning) {
+        return false;
+    }
+
+    result.loopsCompleted = fewestLoops;
+    result.finished       = allEnded || fewestLoops >= settings.loops;
+
+    return result.finished;
+}
+
+void OfflineRenderer::countLoops()
+{
+    for (const auto& [instanceId, instance] : engine.traversalSession.getTraversals()) {
+        int& lastCount = lastLoopCounts[instanceId];
+
+        const int count = instance.logic.loop.count;
+
+        if (count > lastCount) {
+            loopsByInstance[instanceId] += count - lastCount;
+        }
+
+        lastCount = count;
+    }
+}
+
+double OfflineRenderer::ticksAt(std::int64_t sample) const
+{
+    return static_cast<double>(sample) / settings.sampleRate * settings.bpm / 60.0
+         * TransportClock::ticksPerQuarter;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../Util/CoreModules.h"
+#include "../Graph/ValueTreeState.h"
+#include "../Graph/RTGraphBuilder.h"
+#include "SequenceTreeEngine.h"
+
+#include <optional>
+#include <unordered_map>
+
+class OfflineRenderer
+{
+public:
+
+    struct Settings
+    {
+        double sampleRate = 48000.0;
+        int    blockSize  = 512;
+        double bpm        = 120.0;
+
+        std::optional<bool> hostSynced;
+
+        double seconds    = 0.0;
+        int    loops      = 0;
+        double maxSeconds = 600.0;
+    };
+
+    struct Result
+    {
+        std::int64_t renderedSamples = 0;
+        int          loopsCompleted  = 0;
+        int          noteCount       = 0;
+        bool         finished        = false;
+        bool         written         = false;
+    };
+
+    explicit OfflineRenderer(Settings settings);
+
+    bool loadState(const void* data, int sizeInBytes);
+    bool loadState(const juce::ValueTree& state);
+
+    Result render(juce::MidiFile& midiFile);
+    Result renderToFile(const juce::File& destination);
+
+private:
+
+    class BlockPlayHead : public juce::AudioPlayHead
+    {
+    public:
+
+        juce::Optional<PositionInfo> getPosition() const override;
+
+        double bpm     = 120.0;
+        double ppq     = 0.0;
+        bool   playing = true;
+    };
+
+    void compileStoredRules();
+
+    bool isRenderComplete(std::int64_t renderedSamples, Result& result);
+
+    void countLoops();
+
+    double ticksAt(std::int64_t sample) const;
+
+    Settings settings;
+
+    bool hostSynced = false;
+
+    ValueTreeState     graphState;
+    SequenceTreeEngine engine;
+    RTGraphBuilder     rtGraphBuilder { engine, graphState };
+
+    BlockPlayHead playHead;
+
+    std::unordered_map<int, int> lastLoopCounts;
+    std::unordered_map<int, int> loopsByInstance;
+};
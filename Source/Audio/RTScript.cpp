@@ -1,5 +1,215 @@
 #include "RTScript.h"
 
+#include <cstddef>
+
+namespace {
+
+struct StackEffect
+{
+    int pops   = 0;
+    int pushes = 0;
+};
+
+bool isKnownOpcode(ScriptOpcode opcode)
+{
+    return static_cast<int>(opcode) >= static_cast<int>(ScriptOpcode::Halt)
+        && static_cast<int>(opcode) <= static_cast<int>(ScriptOpcode::Return);
+}
+
+StackEffect stackEffectOf(ScriptOpcode opcode)
+{
+    switch (opcode) {
+        case ScriptOpcode::PushInt:
+        case ScriptOpcode::PushLocal:
+        case ScriptOpcode::PushField:
+            return { 0, 1 };
+
+        case ScriptOpcode::StoreLocal:
+        case ScriptOpcode::Pop:
+        case ScriptOpcode::LoadChild:
+        case ScriptOpcode::JumpIfFalse:
+        case ScriptOpcode::JumpIfTrue:
+        case ScriptOpcode::Return:
+            return { 1, 0 };
+
+        case ScriptOpcode::Negate:
+        case ScriptOpcode::LogicalNot:
+            return { 1, 1 };
+
+        case ScriptOpcode::Add:
+        case ScriptOpcode::Subtract:
+        case ScriptOpcode::Multiply:
+        case ScriptOpcode::Divide:
+        case ScriptOpcode::Modulo:
+        case ScriptOpcode::Equal:
+        case ScriptOpcode::NotEqual:
+        case ScriptOpcode::Less:
+        case ScriptOpcode::LessOrEqual:
+        case ScriptOpcode::Greater:
+        case ScriptOpcode::GreaterOrEqual:
+        case ScriptOpcode::LogicalAnd:
+        case ScriptOpcode::LogicalOr:
+            return { 2, 1 };
+
+        case ScriptOpcode::Halt:
+        case ScriptOpcode::Jump:
+            break;
+    }
+
+    return {};
+}
+
+bool isJump(ScriptOpcode opcode)
+{
+    return opcode == ScriptOpcode::Jump
+        || opcode == ScriptOpcode::JumpIfFalse
+        || opcode == ScriptOpcode::JumpIfTrue;
+}
+
+bool fallsThrough(ScriptOpcode opcode)
+{
+    return opcode != ScriptOpcode::Jump
+        && opcode != ScriptOpcode::Return
+        && opcode != ScriptOpcode::Halt;
+}
+
+bool hasValidOperand(const ScriptInstruction& instruction, int instructionCount)
+{
+    switch (instruction.opcode) {
+        case ScriptOpcode::PushLocal:
+        case ScriptOpcode::StoreLocal:
+            return instruction.operand >= 0 && instruction.operand < RTScript::maxLocals;
+
+        case ScriptOpcode::PushField:
+            return instruction.operand >= 0 && instruction.operand < static_cast<int>(ScriptField::FieldCount);
+
+        case ScriptOpcode::Jump:
+        case ScriptOpcode::JumpIfFalse:
+        case ScriptOpcode::JumpIfTrue:
+            return instruction.operand >= 0 && instruction.operand <= instructionCount;
+
+        default:
+            return true;
+    }
+}
+
+}
+
+ScriptVerification verifyScript(const RTScript& script)
+{
+    constexpr int unvisited = -1;
+
+    ScriptVerification result;
+
+    const int instructionCount = static_cast<int>(script.instructions.size());
+
+    std::vector<int>           depths  (static_cast<std::size_t>(instructionCount) + 1, unvisited);
+    std::vector<std::uint32_t> assigned(static_cast<std::size_t>(instructionCount) + 1, 0);
+    std::vector<int>           pending;
+
+    auto fail = [&result](int instruction) {
+        result.isValid           = false;
+        result.failedInstruction = instruction;
+        result.reachable.clear();
+        return result;
+    };
+
+    auto flowTo = [&](int target, int depth, std::uint32_t assignedLocals) {
+        const auto index = static_cast<std::size_t>(target);
+
+        if (depths[index] == unvisited) {
+            depths[index]   = depth;
+            assigned[index] = assignedLocals;
+            pending.push_back(target);
+            return true;
+        }
+
+        if (depths[index] != depth) {
+            return false;
+        }
+
+        if ((assigned[index] & assignedLocals) != assigned[index]) {
+            assigned[index] &= assignedLocals;
+            pending.push_back(target);
+        }
+
+        return true;
+    };
+
+    if (instructionCount == 0) {
+        return fail(0);
+    }
+
+    flowTo(0, 0, 0);
+
+    while (!pending.empty()) {
+        const int programCounter = pending.back();
+        pending.pop_back();
+
+        if (programCounter == instructionCount) {
+            continue;
+        }
+
+        const ScriptInstruction& instruction = script.instructions[static_cast<std::size_t>(programCounter)];
+
+        if (!isKnownOpcode(instruction.opcode) || !hasValidOperand(instruction, instructionCount)) {
+            return fail(programCounter);
+        }
+
+        const int           depth          = depths  [static_cast<std::size_t>(programCounter)];
+        std::uint32_t       assignedLocals = assigned[static_cast<std::size_t>(programCounter)];
+        const StackEffect   effect         = stackEffectOf(instruction.opcode);
+
+        if (depth < effect.pops) {
+            return fail(programCounter);
+        }
+
+        const int nextDepth = depth - effect.pops + effect.pushes;
+
+        if (nextDepth > RTScript::maxStack) {
+            return fail(programCounter);
+        }
+
+        if (nextDepth > result.maxStackDepth) {
+            result.maxStackDepth = nextDepth;
+        }
+
+        const std::uint32_t localBit = 1u << (instruction.operand & (RTScript::maxLocals - 1));
+
+        if (instruction.opcode == ScriptOpcode::PushLocal && (assignedLocals & localBit) == 0) {
+            result.uninitialisedLocals |= localBit;
+        }
+
+        if (instruction.opcode == ScriptOpcode::StoreLocal) {
+            assignedLocals |= localBit;
+        }
+
+        if (isJump(instruction.opcode)) {
+            if (instruction.operand <= programCounter) {
+                result.hasBackEdges = true;
+            }
+
+            if (!flowTo(instruction.operand, nextDepth, assignedLocals)) {
+                return fail(programCounter);
+            }
+        }
+
+        if (fallsThrough(instruction.opcode) && !flowTo(programCounter + 1, nextDepth, assignedLocals)) {
+            return fail(programCounter);
+        }
+    }
+
+    result.reachable.resize(static_cast<std::size_t>(instructionCount));
+
+    for (int index = 0; index < instructionCount; ++index) {
+        result.reachable[static_cast<std::size_t>(index)] = depths[static_cast<std::size_t>(index)] != unvisited ? 1 : 0;
+    }
+
+    result.isValid = true;
+
+    return result;
+}
+
 RTScript makeNativeSelectChildScript()
 {
     constexpr int chosenLocal   = 0;
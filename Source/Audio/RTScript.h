@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 enum class ScriptOpcode
@@ -57,7 +58,9 @@ enum class ScriptField
     ChildRepeatValue,
     ChildPitchOffset,
     ChildSwitchCountLimit,
-    ChildSubLoopCountLimit
+    ChildSubLoopCountLimit,
+
+    FieldCount
 };
 
 struct ScriptInstruction
@@ -77,6 +80,26 @@ struct ScriptInstruction
         : opcode(instructionOpcode), operand(static_cast<int>(field)) {}
 };
 
+struct ScriptArithmetic
+{
+    static int wrap(std::int64_t value) { return static_cast<int>(static_cast<std::uint32_t>(value)); }
+
+    static int add     (int left, int right) { return wrap(static_cast<std::int64_t>(left) + right); }
+    static int subtract(int left, int right) { return wrap(static_cast<std::int64_t>(left) - right); }
+    static int multiply(int left, int right) { return wrap(static_cast<std::int64_t>(left) * right); }
+    static int negate  (int value)           { return wrap(-static_cast<std::int64_t>(value)); }
+
+    static int divide(int left, int right)
+    {
+        return right == 0 ? 0 : right == -1 ? negate(left) : left / right;
+    }
+
+    static int modulo(int left, int right)
+    {
+        return right == 0 || right == -1 ? 0 : left % right;
+    }
+};
+
 struct RTScript
 {
     static constexpr int maxLocals  = 32;
@@ -91,4 +114,22 @@ struct RTScript
     bool isEmpty() const { return instructions.empty(); }
 };
 
+struct ScriptVerification
+{
+    bool isValid = false;
+
+    int failedInstruction = -1;
+
+    int  maxStackDepth = 0;
+    bool hasBackEdges  = false;
+
+    std::uint32_t uninitialisedLocals = 0;
+
+    std::vector<std::uint8_t> reachable;
+};
+
+static_assert(RTScript::maxLocals <= 32, "local definite-assignment masks are 32 bits wide");
+
+ScriptVerification verifyScript(const RTScript& script);
+
 RTScript makeNativeSelectChildScript();
@@ -0,0 +1,810 @@
+#include "RuleCompiler.h"
+#include "ScriptCostAnalysis.h"
+
+#include <cctype>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+enum class TokenType
+{
+    Identifier,
+    Number,
+    Symbol,
+    Invalid,
+    End
+};
+
+struct Token
+{
+    TokenType   type   = TokenType::End;
+    std::string text;
+    int         value  = 0;
+    int         line   = 1;
+    int         column = 1;
+
+    bool is(const char* symbol) const { return type != TokenType::Number && text == symbol; }
+};
+
+struct FieldName
+{
+    const char* name;
+    ScriptField field;
+};
+
+constexpr FieldName fieldNames[] = {
+    { "parent.id",              ScriptField::ParentId               },
+    { "parent.count",           ScriptField::ParentCount            },
+    { "parent.childCount",      ScriptField::ParentChildCount       },
+    { "parent.lastChosen",      ScriptField::ParentLastChosenChild  },
+    { "traversal.id",           ScriptField::TraversalId            },
+    { "child.id",               ScriptField::ChildId                },
+    { "child.eligible",         ScriptField::ChildIsEligible        },
+    { "child.countLimit",       ScriptField::ChildCountLimit        },
+    { "child.triggerLimit",     ScriptField::ChildTriggerLimit      },
+    { "child.triggerCount",     ScriptField::ChildTriggerCount      },
+    { "child.visits",           ScriptField::ChildVisitCount        },
+    { "child.repeat",           ScriptField::ChildRepeatValue       },
+    { "child.pitchOffset",      ScriptField::ChildPitchOffset       },
+    { "child.switchCountLimit", ScriptField::ChildSwitchCountLimit  },
+    { "child.subLoopLimit",     ScriptField::ChildSubLoopCountLimit },
+};
+
+const char* const keywords[] = { "let", "if", "else", "for", "return", "child", "true", "false" };
+
+bool isKeyword(const std::string& text)
+{
+    for (const char* keyword : keywords) {
+        if (text == keyword) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool isChildField(ScriptField field)
+{
+    return static_cast<int>(field) >= static_cast<int>(ScriptField::ChildId);
+}
+
+std::vector<Token> tokenise(const std::string& source)
+{
+    static const char* const twoCharacterSymbols[] = { "==", "!=", "<=", ">=", "&&", "||" };
+    static const std::string singleCharacterSymbols = "+-*/%<>!=(){};";
+
+    constexpr long long overflowValue = static_cast<long long>(std::numeric_limits<int>::max()) + 1;
+
+    std::vector<Token> tokens;
+
+    int line   = 1;
+    int column = 1;
+
+    std::size_t index = 0;
+
+    auto advance = [&](std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (source[index + i] == '\n') {
+                ++line;
+                column = 1;
+            }
+            else {
+                ++column;
+            }
+        }
+
+        index += count;
+    };
+
+    while (index < source.size()) {
+        const char character = source[index];
+
+        if (std::isspace(static_cast<unsigned char>(character))) {
+            advance(1);
+            continue;
+        }
+
+        if (source.compare(index, 2, "//") == 0) {
+            while (index < source.size() && source[index] != '\n') {
+                advance(1);
+            }
+            continue;
+        }
+
+        Token token;
+        token.line   = line;
+        token.column = column;
+
+        std::size_t length = 1;
+
+        if (std::isalpha(static_cast<unsigned char>(character)) || character == '_') {
+            while (index + length < source.size()
+                   && (std::isalnum(static_cast<unsigned char>(source[index + length]))
+                       || source[index + length] == '_' || source[index + length] == '.')) {
+                ++length;
+            }
+
+            token.type = TokenType::Identifier;
+        }
+        else if (std::isdigit(static_cast<unsigned char>(character))) {
+            while (index + length < source.size() && std::isdigit(static_cast<unsigned char>(source[index + length]))) {
+                ++length;
+            }
+
+            long long value = 0;
+
+            for (std::size_t digit = index; digit < index + length; ++digit) {
+                value = juce::jmin(value * 10 + (source[digit] - '0'), overflowValue);
+            }
+
+            token.type  = value == overflowValue ? TokenType::Invalid : TokenType::Number;
+            token.value = static_cast<int>(value);
+        }
+        else {
+            token.type = TokenType::Invalid;
+
+            for (const char* symbol : twoCharacterSymbols) {
+                if (source.compare(index, 2, symbol) == 0) {
+                    token.type = TokenType::Symbol;
+                    length     = 2;
+                    break;
+                }
+            }
+
+            if (token.type == TokenType::Invalid && singleCharacterSymbols.find(character) != std::string::npos) {
+                token.type = TokenType::Symbol;
+            }
+        }
+
+        token.text = source.substr(index, length);
+        tokens.push_back(token);
+
+        advance(length);
+    }
+
+    Token end;
+    end.line   = line;
+    end.column = column;
+    tokens.push_back(end);
+
+    return tokens;
+}
+
+struct Expr
+{
+    enum class Kind { Constant, Local, Field, Unary, Binary };
+
+    Kind         kind   = Kind::Constant;
+    ScriptOpcode opcode = ScriptOpcode::Halt;
+    int          value  = 0;
+
+    std::unique_ptr<Expr> left;
+    std::unique_ptr<Expr> right;
+};
+
+using ExprPtr = std::unique_ptr<Expr>;
+
+struct BinaryOperator
+{
+    const char*  symbol;
+    ScriptOpcode opcode;
+};
+
+const std::vector<std::vector<BinaryOperator>> precedenceLevels = {
+    { { "||", ScriptOpcode::LogicalOr } },
+    { { "&&", ScriptOpcode::LogicalAnd } },
+    { { "==", ScriptOpcode::Equal }, { "!=", ScriptOpcode::NotEqual } },
+    { { "<",  ScriptOpcode::Less }, { "<=", ScriptOpcode::LessOrEqual },
+      { ">",  ScriptOpcode::Greater }, { ">=", ScriptOpcode::GreaterOrEqual } },
+    { { "+",  ScriptOpcode::Add }, { "-", ScriptOpcode::Subtract } },
+    { { "*",  ScriptOpcode::Multiply }, { "/", ScriptOpcode::Divide }, { "%", ScriptOpcode::Modulo } },
+};
+
+class RuleParser
+{
+public:
+
+    RuleParser(std::vector<Token> sourceTokens, RuleCompileResult& compileResult)
+        : tokens(std::move(sourceTokens)), result(compileResult), code(compileResult.script.instructions)
+    {
+    }
+
+    void parseProgram()
+    {
+        while (ok() && peek().type != TokenType::End) {
+            endsInReturn = peek().is("return");
+            parseStatement();
+        }
+
+        if (!ok()) {
+            return;
+        }
+
+        if (!endsInReturn) {
+            emit({ ScriptOpcode::PushInt, -1 });
+            emit({ ScriptOpcode::Return });
+        }
+
+        result.script.localCount = slotsUsed;
+    }
+
+private:
+
+    bool ok() const { return result.error.isEmpty(); }
+
+    void fail(const Token& at, const juce::String& message)
+    {
+        if (!ok()) {
+            return;
+        }
+
+        result.error       = message;
+        result.errorLine   = at.line;
+        result.errorColumn = at.column;
+    }
+
+    const Token& peek() const { return tokens[position]; }
+
+    const Token& next()
+    {
+        const Token& token = tokens[position];
+
+        if (token.type != TokenType::End) {
+            ++position;
+        }
+
+        return token;
+    }
+
+    bool accept(const char* symbol)
+    {
+        if (!peek().is(symbol)) {
+            return false;
+        }
+
+        next();
+        return true;
+    }
+
+    bool expect(const char* symbol)
+    {
+        if (accept(symbol)) {
+            return true;
+        }
+
+        fail(peek(), juce::String("expected '") + symbol + "'" + describeFound());
+        return false;
+    }
+
+    juce::String describeFound() const
+    {
+        const Token& found = peek();
+
+        if (found.type == TokenType::End) {
+            return " but the rule ended";
+        }
+
+        return " but found '" + juce::String(found.text) + "'";
+    }
+
+    int emit(ScriptInstruction instruction)
+    {
+        code.push_back(instruction);
+
+        return static_cast<int>(code.size()) - 1;
+    }
+
+    void patchToHere(int instruction)
+    {
+        code[static_cast<std::size_t>(instruction)].operand = static_cast<int>(code.size());
+    }
+
+    int findLocal(const std::string& name) const
+    {
+        for (const auto& [localName, slot] : locals) {
+            if (localName == name) {
+                return slot;
+            }
+        }
+
+        return -1;
+    }
+
+    int allocateSlot(const Token& at)
+    {
+        if (slotsUsed >= RTScript::maxLocals) {
+            fail(at, "too many variables (at most " + juce::String(RTScript::maxLocals) + " including the child loop)");
+            return -1;
+        }
+
+        return slotsUsed++;
+    }
+
+    void parseStatement()
+    {
+        const Token& token = peek();
+
+        if (token.is("let")) {
+            next();
+            parseLet();
+        }
+        else if (token.is("if")) {
+            next();
+            parseIf();
+        }
+        else if (token.is("for")) {
+            next();
+            parseForChild(token);
+        }
+        else if (token.is("return")) {
+            next();
+            compileValue(parseExpression());
+
+            if (ok() && expect(";")) {
+                emit({ ScriptOpcode::Return });
+            }
+        }
+        else if (token.type == TokenType::Identifier && !isKeyword(token.text)) {
+            parseAssignment();
+        }
+        else {
+            fail(token, "expected a statement" + describeFound());
+        }
+    }
+
+    void parseLet()
+    {
+        const Token& name = next();
+
+        if (name.type != TokenType::Identifier || isKeyword(name.text) || name.text.find('.') != std::string::npos) {
+            fail(name, "expected a variable name after 'let'");
+            return;
+        }
+
+        if (findLocal(name.text) != -1) {
+            fail(name, "'" + juce::String(name.text) + "' is already declared");
+            return;
+        }
+
+        if (!expect("=")) {
+            return;
+        }
+
+        ExprPtr value = parseExpression();
+
+        if (!ok() || !expect(";")) {
+            return;
+        }
+
+        const int slot = allocateSlot(name);
+
+        if (slot == -1) {
+            return;
+        }
+
+        locals.emplace_back(name.text, slot);
+
+        compileValue(value);
+        emit({ ScriptOpcode::StoreLocal, slot });
+    }
+
+    void parseAssignment()
+    {
+        const Token& name = next();
+        const int    slot = findLocal(name.text);
+
+        if (slot == -1) {
+            fail(name, "unknown variable '" + juce::String(name.text) + "'");
+            return;
+        }
+
+        if (!expect("=")) {
+            return;
+        }
+
+        ExprPtr value = parseExpression();
+
+        if (!ok() || !expect(";")) {
+            return;
+        }
+
+        compileValue(value);
+        emit({ ScriptOpcode::StoreLocal, slot });
+    }
+
+    void parseIf()
+    {
+        ExprPtr condition = parseExpression();
+
+        if (!ok()) {
+            return;
+        }
+
+        std::vector<int> falseJumps;
+        compileCondition(*condition, falseJumps);
+
+        parseBlock();
+
+        if (!ok() || !accept("else")) {
+            for (const int jump : falseJumps) {
+                patchToHere(jump);
+            }
+            return;
+        }
+
+        const int endJump = emit({ ScriptOpcode::Jump, 0 });
+
+        for (const int jump : falseJumps) {
+            patchToHere(jump);
+        }
+
+        if (accept("if")) {
+            parseIf();
+        }
+        else {
+            parseBlock();
+        }
+
+        patchToHere(endJump);
+    }
+
+    void parseForChild(const Token& forToken)
+    {
+        if (!peek().is("child")) {
+            fail(peek(), "expected 'child' after 'for'");
+            return;
+        }
+
+        next();
+
+        if (inChildLoop) {
+            fail(forToken, "nested 'for child' loops are not supported");
+            return;
+        }
+
+        if (loopIndexLocal == -1) {
+            loopIndexLocal = allocateSlot(forToken);
+
+            if (loopIndexLocal == -1) {
+                return;
+            }
+        }
+
+        emit({ ScriptOpcode::PushInt, 0 });
+        emit({ ScriptOpcode::StoreLocal, loopIndexLocal });
+
+        const int loopTop = static_cast<int>(code.size());
+
+        emit({ ScriptOpcode::PushLocal, loopIndexLocal });
+        emit({ ScriptOpcode::PushField, ScriptField::ParentChildCount });
+        emit({ ScriptOpcode::Less });
+
+        const int exitJump = emit({ ScriptOpcode::JumpIfFalse, 0 });
+
+        emit({ ScriptOpcode::PushLocal, loopIndexLocal });
+        emit({ ScriptOpcode::LoadChild });
+
+        inChildLoop = true;
+        parseBlock();
+        inChildLoop = false;
+
+        emit({ ScriptOpcode::PushLocal, loopIndexLocal });
+        emit({ ScriptOpcode::PushInt, 1 });
+        emit({ ScriptOpcode::Add });
+        emit({ ScriptOpcode::StoreLocal, loopIndexLocal });
+        emit({ ScriptOpcode::Jump, loopTop });
+
+        patchToHere(exitJump);
+    }
+
+    bool enterNesting(const Token& at)
+    {
+        if (++nestingDepth > maxNestingDepth) {
+            fail(at, "the rule is nested too deeply");
+            return false;
+        }
+
+        return true;
+    }
+
+    void parseBlock()
+    {
+        if (!expect("{")) {
+            return;
+        }
+
+        if (enterNesting(peek())) {
+            while (ok() && !accept("}")) {
+                if (peek().type == TokenType::End) {
+                    fail(peek(), "expected '}' but the rule ended");
+                    break;
+                }
+
+                parseStatement();
+            }
+        }
+
+        --nestingDepth;
+    }
+
+    ExprPtr parseExpression()
+    {
+        operatorCount = 0;
+        return parseBinary(0);
+    }
+
+    ExprPtr parseBinary(std::size_t level)
+    {
+        if (level == precedenceLevels.size()) {
+            return parseUnary();
+        }
+
+        ExprPtr left = parseBinary(level + 1);
+
+        while (ok()) {
+            const BinaryOperator* matched = nullptr;
+
+            for (const BinaryOperator& candidate : precedenceLevels[level]) {
+                if (peek().is(candidate.symbol)) {
+                    matched = &candidate;
+                    break;
+                }
+            }
+
+            if (matched == nullptr) {
+                break;
+            }
+
+            if (++operatorCount > maxExpressionOperators) {
+                fail(peek(), "the expression is too long (at most " + juce::String(maxExpressionOperators) + " operators)");
+                break;
+            }
+
+            next();
+
+            auto binary = std::make_unique<Expr>();
+
+            binary->kind   = Expr::Kind::Binary;
+            binary->opcode = matched->opcode;
+            binary->left   = std::move(left);
+            binary->right  = parseBinary(level + 1);
+
+            left = std::move(binary);
+        }
+
+        return left;
+    }
+
+    ExprPtr parseUnary()
+    {
+        if (!enterNesting(peek())) {
+            --nestingDepth;
+            return nullptr;
+        }
+
+        ExprPtr operand = parseSignedOperand();
+
+        --nestingDepth;
+        return operand;
+    }
+
+    ExprPtr parseSignedOperand()
+    {
+        if (peek().is("-") || peek().is("!")) {
+            const bool negate = next().is("-");
+
+            ExprPtr operand = parseUnary();
+
+            if (!ok()) {
+                return nullptr;
+            }
+
+            if (negate && operand->kind == Expr::Kind::Constant && operand->value != std::numeric_limits<int>::min()) {
+                operand->value = -operand->value;
+                return operand;
+            }
+
+            auto unary = std::make_unique<Expr>();
+
+            unary->kind   = Expr::Kind::Unary;
+            unary->opcode = negate ? ScriptOpcode::Negate : ScriptOpcode::LogicalNot;
+            unary->left   = std::move(operand);
+
+            return unary;
+        }
+
+        return parsePrimary();
+    }
+
+    ExprPtr parsePrimary()
+    {
+        const Token& token = next();
+
+        auto expr = std::make_unique<Expr>();
+
+        if (token.type == TokenType::Number) {
+            expr->value = token.value;
+            return expr;
+        }
+
+        if (token.is("true") || token.is("false")) {
+            expr->value = token.is("true") ? 1 : 0;
+            return expr;
+        }
+
+        if (token.is("(")) {
+            ExprPtr inner = parseBinary(0);
+
+            if (!ok() || !expect(")")) {
+                return nullptr;
+            }
+
+            return inner;
+        }
+
+        if (token.type == TokenType::Identifier && !isKeyword(token.text)) {
+            for (const FieldName& fieldName : fieldNames) {
+                if (token.text == fieldName.name) {
+                    if (isChildField(fieldName.field) && !inChildLoop) {
+                        fail(token, "'" + juce::String(token.text) + "' is only available inside 'for child'");
+                        return nullptr;
+                    }
+
+                    expr->kind  = Expr::Kind::Field;
+                    expr->value = static_cast<int>(fieldName.field);
+                    return expr;
+                }
+            }
+
+            const int slot = findLocal(token.text);
+
+            if (slot == -1) {
+                fail(token, token.text.find('.') != std::string::npos
+                                ? "unknown field '" + juce::String(token.text) + "'"
+                                : "unknown variable '" + juce::String(token.text) + "'");
+                return nullptr;
+            }
+
+            expr->kind  = Expr::Kind::Local;
+            expr->value = slot;
+            return expr;
+        }
+
+        if (token.type == TokenType::Invalid) {
+            fail(token, token.text.empty() || !std::isdigit(static_cast<unsigned char>(token.text[0]))
+                            ? "unexpected character '" + juce::String(token.text) + "'"
+                            : "number '" + juce::String(token.text) + "' is too large");
+            return nullptr;
+        }
+
+        fail(token, token.type == TokenType::End ? juce::String("expected a value but the rule ended")
+                                                 : "expected a value but found '" + juce::String(token.text) + "'");
+        return nullptr;
+    }
+
+    void compileValue(const ExprPtr& expr)
+    {
+        if (ok() && expr != nullptr) {
+            compileValue(*expr);
+        }
+    }
+
+    void compileValue(const Expr& expr)
+    {
+        switch (expr.kind) {
+            case Expr::Kind::Constant:
+                emit({ ScriptOpcode::PushInt, expr.value });
+                break;
+
+            case Expr::Kind::Local:
+                emit({ ScriptOpcode::PushLocal, expr.value });
+                break;
+
+            case Expr::Kind::Field:
+                emit({ ScriptOpcode::PushField, expr.value });
+                break;
+
+            case Expr::Kind::Unary:
+                compileValue(*expr.left);
+                emit({ expr.opcode });
+                break;
+
+            case Expr::Kind::Binary:
+                compileValue(*expr.left);
+                compileValue(*expr.right);
+                emit({ expr.opcode });
+                break;
+        }
+    }
+
+    void compileCondition(const Expr& expr, std::vector<int>& falseJumps)
+    {
+        if (expr.kind == Expr::Kind::Binary && expr.opcode == ScriptOpcode::LogicalAnd) {
+            compileCondition(*expr.left,  falseJumps);
+            compileCondition(*expr.right, falseJumps);
+            return;
+        }
+
+        compileValue(expr);
+        falseJumps.push_back(emit({ ScriptOpcode::JumpIfFalse, 0 }));
+    }
+
+    std::vector<Token>               tokens;
+    std::size_t                      position = 0;
+    RuleCompileResult&               result;
+    std::vector<ScriptInstruction>&  code;
+
+    std::vector<std::pair<std::string, int>> locals;
+
+    static constexpr int maxNestingDepth        = RTScript::maxStack;
+    static constexpr int maxExpressionOperators = 1024;
+
+    int  nestingDepth   = 0;
+    int  operatorCount  = 0;
+    int  slotsUsed      = 0;
+    int  loopIndexLocal = -1;
+    bool endsInReturn   = false;
+    bool inChildLoop    = false;
+};
+
+}
+
+int RuleCompileResult::maxChildrenWithinBudget() const
+{
+    if (stepsPerChild <= 0) {
+        return std::numeric_limits<int>::max();
+    }
+
+    return juce::jmax(0, (script.stepBudget - fixedSteps) / stepsPerChild);
+}
+
+RuleCompileResult RuleCompiler::compile(const juce::String& source)
+{
+    RuleCompileResult result;
+
+    RuleParser parser(tokenise(source.toStdString()), result);
+    parser.parseProgram();
+
+    if (result.error.isEmpty() && !verifyScript(result.script).isValid) {
+        result.error       = "the rule needs more stack than a script may use";
+        result.errorLine   = 1;
+        result.errorColumn = 1;
+    }
+
+    if (result.error.isNotEmpty()) {
+        result.script        = {};
+        result.fixedSteps    = 0;
+        result.stepsPerChild = 0;
+        return result;
+    }
+
+    const ScriptCostBound cost = analyseScriptCost(result.script);
+
+    result.fixedSteps    = cost.fixedSteps;
+    result.stepsPerChild = cost.stepsPerChild;
+    result.succeeded     = true;
+
+    return result;
+}
+
+const char* RuleCompiler::builtInRuleSource()
+{
+    return "// Picks the eligible child with the largest count limit that\n"
+           "// divides the parent's visit count.\n"
+           "let chosen = -1;\n"
+           "let best = 0;\n"
+           "\n"
+           "for child {\n"
+           "    if child.eligible && parent.count % child.countLimit == 0 && child.countLimit > best {\n"
+           "        chosen = child.id;\n"
+           "        best = child.countLimit;\n"
+           "    }\n"
+           "}\n"
+           "\n"
+           "return chosen;\n";
+}
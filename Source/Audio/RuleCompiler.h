@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../Util/CoreModules.h"
+#include "RTScript.h"
+
+struct RuleCompileResult
+{
+    RTScript script;
+
+    bool         succeeded   = false;
+    juce::String error;
+    int          errorLine   = 0;
+    int          errorColumn = 0;
+
+    int fixedSteps    = 0;
+    int stepsPerChild = 0;
+
+    int maxChildrenWithinBudget() const;
+};
+
+class RuleCompiler
+{
+public:
+
+    static RuleCompileResult compile(const juce::String& source);
+
+    static const char* builtInRuleSource();
+};
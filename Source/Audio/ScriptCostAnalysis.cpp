@@ -0,0 +1,323 @@
+#include "ScriptCostAnalysis.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace {
+
+struct CountedLoop
+{
+    int header   = -1;
+    int backEdge = -1;
+    int exit     = -1;
+};
+
+struct PathCost
+{
+    long long fixed    = -1;
+    long long perChild = 0;
+
+    bool reachesEnd() const { return fixed >= 0; }
+};
+
+PathCost longer(const PathCost& a, const PathCost& b)
+{
+    if (!a.reachesEnd()) {
+        return b;
+    }
+
+    if (!b.reachesEnd()) {
+        return a;
+    }
+
+    return { std::max(a.fixed, b.fixed), std::max(a.perChild, b.perChild) };
+}
+
+PathCost plusSteps(const PathCost& cost, long long steps)
+{
+    return cost.reachesEnd() ? PathCost { cost.fixed + steps, cost.perChild } : cost;
+}
+
+bool isJump(ScriptOpcode opcode)
+{
+    return opcode == ScriptOpcode::Jump || opcode == ScriptOpcode::JumpIfFalse || opcode == ScriptOpcode::JumpIfTrue;
+}
+
+bool isTerminal(ScriptOpcode opcode)
+{
+    return opcode == ScriptOpcode::Return || opcode == ScriptOpcode::Halt;
+}
+
+bool fallsThrough(ScriptOpcode opcode)
+{
+    return opcode != ScriptOpcode::Jump && !isTerminal(opcode);
+}
+
+class CostAnalyser
+{
+public:
+
+    CostAnalyser(const RTScript& analysed, const ScriptVerification& verified)
+        : script(analysed), verification(verified), code(analysed.instructions),
+          instructionCount(static_cast<int>(analysed.instructions.size()))
+    {
+    }
+
+    ScriptCostBound analyse()
+    {
+        ScriptCostBound bound;
+
+        bound.budgetCap = script.stepBudget + instructionCount;
+
+        loopAtHeader.assign(static_cast<std::size_t>(instructionCount) + 1, -1);
+        insideLoop  .assign(static_cast<std::size_t>(instructionCount) + 1, 0);
+
+        for (int pc = 0; pc < instructionCount; ++pc) {
+            const ScriptInstruction& instruction = at(pc);
+
+            if (!isReachable(pc) || !isJump(instruction.opcode) || instruction.operand > pc) {
+                continue;
+            }
+
+            CountedLoop loop;
+
+            if (!matchCountedLoop(instruction.operand, pc, loop)) {
+                return bound;
+            }
+
+            loopAtHeader[static_cast<std::size_t>(loop.header)] = static_cast<int>(loops.size());
+
+            for (int inside = loop.header + 1; inside <= loop.backEdge; ++inside) {
+                insideLoop[static_cast<std::size_t>(inside)] = 1;
+            }
+
+            loops.push_back(loop);
+        }
+
+        const PathCost total = longestPaths();
+
+        const long long intMax = std::numeric_limits<int>::max();
+
+        bound.isBounded     = true;
+        bound.fixedSteps    = static_cast<int>(std::min(std::max(total.fixed, 0LL), intMax));
+        bound.stepsPerChild = static_cast<int>(std::min(total.perChild, intMax));
+
+        return bound;
+    }
+
+private:
+
+    const ScriptInstruction& at(int pc) const { return code[static_cast<std::size_t>(pc)]; }
+
+    bool isReachable(int pc) const { return verification.reachable[static_cast<std::size_t>(pc)] != 0; }
+
+    bool opcodeAt(int pc, ScriptOpcode opcode) const
+    {
+        return pc >= 0 && pc < instructionCount && at(pc).opcode == opcode;
+    }
+
+    bool matchCountedLoop(int header, int backEdge, CountedLoop& loop) const
+    {
+        const int increment = backEdge - 4;
+
+        if (!opcodeAt(backEdge, ScriptOpcode::Jump)
+            || !opcodeAt(header - 2, ScriptOpcode::PushInt)
+            || !opcodeAt(header - 1, ScriptOpcode::StoreLocal)
+            || !opcodeAt(header,     ScriptOpcode::PushLocal)
+            || !opcodeAt(header + 1, ScriptOpcode::PushField)
+            || !opcodeAt(header + 2, ScriptOpcode::Less)
+            || !opcodeAt(header + 3, ScriptOpcode::JumpIfFalse)
+            || increment <= header + 3
+            || !opcodeAt(increment,     ScriptOpcode::PushLocal)
+            || !opcodeAt(increment + 1, ScriptOpcode::PushInt)
+            || !opcodeAt(increment + 2, ScriptOpcode::Add)
+            || !opcodeAt(increment + 3, ScriptOpcode::StoreLocal)) {
+            return false;
+        }
+
+        const int indexLocal = at(header).operand;
+        const int exit       = at(header + 3).operand;
+
+        if (at(header + 1).operand != static_cast<int>(ScriptField::ParentChildCount)
+            || at(header - 2).operand < 0
+            || at(header - 1).operand != indexLocal
+            || at(increment).operand != indexLocal
+            || at(increment + 1).operand < 1
+            || at(increment + 3).operand != indexLocal
+            || exit <= backEdge) {
+            return false;
+        }
+
+        for (int pc = 0; pc < instructionCount; ++pc) {
+            if (!isReachable(pc)) {
+                continue;
+            }
+
+            const ScriptInstruction& instruction = at(pc);
+            const bool               inBody      = pc > header && pc < backEdge;
+
+            if (inBody && instruction.opcode == ScriptOpcode::StoreLocal
+                && instruction.operand == indexLocal && pc != increment + 3) {
+                return false;
+            }
+
+            if (!isJump(instruction.opcode) || pc == backEdge || pc == header + 3) {
+                continue;
+            }
+
+            const int target = instruction.operand;
+
+            if (inBody ? (target <= pc || target > increment) : (target >= header - 1 && target <= backEdge)) {
+                return false;
+            }
+        }
+
+        loop = { header, backEdge, exit };
+        return true;
+    }
+
+    PathCost loopCost(const CountedLoop& loop, const PathCost& afterExit) const
+    {
+        constexpr long long headerSteps = 4;
+
+        const int bodyStart = loop.header + 4;
+        const int bodySize  = loop.backEdge - bodyStart + 1;
+
+        std::vector<long long> toBackEdge(static_cast<std::size_t>(bodySize), -1);
+        std::vector<long long> toTerminal(static_cast<std::size_t>(bodySize), -1);
+
+        const auto slot = [bodyStart](int pc) { return static_cast<std::size_t>(pc - bodyStart); };
+
+        toBackEdge[slot(loop.backEdge)] = 1;
+
+        for (int pc = loop.backEdge - 1; pc >= bodyStart; --pc) {
+            const ScriptInstruction& instruction = at(pc);
+
+            if (isTerminal(instruction.opcode)) {
+                toTerminal[slot(pc)] = 1;
+                continue;
+            }
+
+            const auto follow = [&](int successor) {
+                if (toBackEdge[slot(successor)] >= 0) {
+                    toBackEdge[slot(pc)] = std::max(toBackEdge[slot(pc)], toBackEdge[slot(successor)] + 1);
+                }
+
+                if (toTerminal[slot(successor)] >= 0) {
+                    toTerminal[slot(pc)] = std::max(toTerminal[slot(pc)], toTerminal[slot(successor)] + 1);
+                }
+            };
+
+            if (fallsThrough(instruction.opcode)) {
+                follow(pc + 1);
+            }
+
+            if (isJump(instruction.opcode)) {
+                follow(instruction.operand);
+            }
+        }
+
+        const long long iteration = toBackEdge[0] >= 0 ? headerSteps + toBackEdge[0] : 0;
+
+        PathCost cost = plusSteps(afterExit, headerSteps);
+
+        if (toTerminal[0] >= 0) {
+            cost.fixed = std::max(cost.fixed, headerSteps + toTerminal[0]);
+        }
+
+        cost.perChild += iteration;
+
+        return cost;
+    }
+
+    PathCost longestPaths() const
+    {
+        std::vector<PathCost> fromPc(static_cast<std::size_t>(instructionCount) + 1);
+
+        fromPc[static_cast<std::size_t>(instructionCount)] = { 0, 0 };
+
+        for (int pc = instructionCount - 1; pc >= 0; --pc) {
+            if (!isReachable(pc) || insideLoop[static_cast<std::size_t>(pc)] != 0) {
+                continue;
+            }
+
+            if (const int loopIndex = loopAtHeader[static_cast<std::size_t>(pc)]; loopIndex != -1) {
+                const CountedLoop& loop = loops[static_cast<std::size_t>(loopIndex)];
+
+                fromPc[static_cast<std::size_t>(pc)] = loopCost(loop, fromPc[static_cast<std::size_t>(loop.exit)]);
+                continue;
+            }
+
+            const ScriptInstruction& instruction = at(pc);
+
+            PathCost cost;
+
+            if (isTerminal(instruction.opcode)) {
+                cost = { 0, 0 };
+            }
+
+            if (fallsThrough(instruction.opcode)) {
+                cost = longer(cost, fromPc[static_cast<std::size_t>(pc) + 1]);
+            }
+
+            if (isJump(instruction.opcode)) {
+                cost = longer(cost, fromPc[static_cast<std::size_t>(instruction.operand)]);
+            }
+
+            fromPc[static_cast<std::size_t>(pc)] = plusSteps(cost, 1);
+        }
+
+        return fromPc[0];
+    }
+
+    const RTScript&                       script;
+    const ScriptVerification&             verification;
+    const std::vector<ScriptInstruction>& code;
+    const int                             instructionCount;
+
+    std::vector<int>          loopAtHeader;
+    std::vector<std::uint8_t> insideLoop;
+    std::vector<CountedLoop>  loops;
+};
+
+}
+
+int ScriptCostBound::worstCaseSteps(int childCount) const
+{
+    if (!isBounded) {
+        return budgetCap;
+    }
+
+    const long long steps = static_cast<long long>(fixedSteps)
+                          + static_cast<long long>(stepsPerChild) * std::max(childCount, 0);
+
+    return static_cast<int>(std::min(steps, static_cast<long long>(budgetCap)));
+}
+
+int ScriptCostBound::maxChildrenWithin(int stepLimit) const
+{
+    if (!isBounded || fixedSteps > stepLimit) {
+        return 0;
+    }
+
+    if (stepsPerChild == 0) {
+        return std::numeric_limits<int>::max();
+    }
+
+    return (stepLimit - fixedSteps) / stepsPerChild;
+}
+
+ScriptCostBound analyseScriptCost(const RTScript& script)
+{
+    const ScriptVerification verification = verifyScript(script);
+
+    if (!verification.isValid) {
+        ScriptCostBound rejected;
+        rejected.isBounded = true;
+        return rejected;
+    }
+
+    return CostAnalyser(script, verification).analyse();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "RTScript.h"
+
+struct ScriptCostBound
+{
+    bool isBounded     = false;
+    int  fixedSteps    = 0;
+    int  stepsPerChild = 0;
+    int  budgetCap     = 0;
+
+    int worstCaseSteps(int childCount) const;
+
+    int maxChildrenWithin(int stepLimit) const;
+};
+
+ScriptCostBound analyseScriptCost(const RTScript& script);
@@ -0,0 +1,352 @@
+#include "ScriptOptimiser.h"
+
+#include <cstddef>
+
+namespace {
+
+constexpr int maxOptimisationPasses = 8;
+
+using Flags = std::vector<std::uint8_t>;
+
+std::size_t at(int index)
+{
+    return static_cast<std::size_t>(index);
+}
+
+bool isJump(ScriptOpcode opcode)
+{
+    return opcode == ScriptOpcode::Jump
+        || opcode == ScriptOpcode::JumpIfFalse
+        || opcode == ScriptOpcode::JumpIfTrue;
+}
+
+bool fallsThrough(ScriptOpcode opcode)
+{
+    return opcode != ScriptOpcode::Jump
+        && opcode != ScriptOpcode::Return
+        && opcode != ScriptOpcode::Halt;
+}
+
+bool isPurePush(ScriptOpcode opcode)
+{
+    return opcode == ScriptOpcode::PushInt
+        || opcode == ScriptOpcode::PushLocal
+        || opcode == ScriptOpcode::PushField;
+}
+
+bool isBinary(ScriptOpcode opcode)
+{
+    return static_cast<int>(opcode) >= static_cast<int>(ScriptOpcode::Add)
+        && static_cast<int>(opcode) <= static_cast<int>(ScriptOpcode::LogicalOr)
+        && opcode != ScriptOpcode::Negate
+        && opcode != ScriptOpcode::LogicalNot;
+}
+
+int evaluateBinary(ScriptOpcode opcode, int left, int right)
+{
+    switch (opcode) {
+        case ScriptOpcode::Add:            return ScriptArithmetic::add     (left, right);
+        case ScriptOpcode::Subtract:       return ScriptArithmetic::subtract(left, right);
+        case ScriptOpcode::Multiply:       return ScriptArithmetic::multiply(left, right);
+        case ScriptOpcode::Divide:         return ScriptArithmetic::divide  (left, right);
+        case ScriptOpcode::Modulo:         return ScriptArithmetic::modulo  (left, right);
+        case ScriptOpcode::Equal:          return left == right ? 1 : 0;
+        case ScriptOpcode::NotEqual:       return left != right ? 1 : 0;
+        case ScriptOpcode::Less:           return left <  right ? 1 : 0;
+        case ScriptOpcode::LessOrEqual:    return left <= right ? 1 : 0;
+        case ScriptOpcode::Greater:        return left >  right ? 1 : 0;
+        case ScriptOpcode::GreaterOrEqual: return left >= right ? 1 : 0;
+        case ScriptOpcode::LogicalAnd:     return (left != 0 && right != 0) ? 1 : 0;
+        case ScriptOpcode::LogicalOr:      return (left != 0 || right != 0) ? 1 : 0;
+        default:                           return 0;
+    }
+}
+
+Flags jumpTargetsOf(const RTScript& script)
+{
+    Flags targets(script.instructions.size() + 1, 0);
+
+    for (const ScriptInstruction& instruction : script.instructions) {
+        if (isJump(instruction.opcode)) {
+            targets[at(instruction.operand)] = 1;
+        }
+    }
+
+    return targets;
+}
+
+bool compact(RTScript& script, const Flags& removed)
+{
+    const int instructionCount = static_cast<int>(script.instructions.size());
+
+    std::vector<int> newIndices(at(instructionCount) + 1, 0);
+    int              kept = 0;
+
+    for (int pc = 0; pc < instructionCount; ++pc) {
+        newIndices[at(pc)] = kept;
+
+        if (removed[at(pc)] == 0) {
+            ++kept;
+        }
+    }
+
+    newIndices[at(instructionCount)] = kept;
+
+    if (kept == instructionCount) {
+        return false;
+    }
+
+    std::vector<ScriptInstruction> instructions;
+    instructions.reserve(at(kept));
+
+    for (int pc = 0; pc < instructionCount; ++pc) {
+        if (removed[at(pc)] != 0) {
+            continue;
+        }
+
+        ScriptInstruction instruction = script.instructions[at(pc)];
+
+        if (isJump(instruction.opcode)) {
+            instruction.operand = newIndices[at(instruction.operand)];
+        }
+
+        instructions.push_back(instruction);
+    }
+
+    script.instructions = std::move(instructions);
+
+    return true;
+}
+
+bool removeUnreachable(RTScript& script, const ScriptVerification& verification)
+{
+    Flags removed(script.instructions.size(), 0);
+
+    for (std::size_t pc = 0; pc < removed.size(); ++pc) {
+        removed[pc] = verification.reachable[pc] == 0 ? 1 : 0;
+    }
+
+    return compact(script, removed);
+}
+
+bool foldConstants(RTScript& script)
+{
+    std::vector<ScriptInstruction>& code = script.instructions;
+
+    const int   instructionCount = static_cast<int>(code.size());
+    const Flags targets          = jumpTargetsOf(script);
+
+    Flags removed(code.size(), 0);
+    bool  changed = false;
+
+    auto opcodeAt = [&](int pc) {
+        return pc < instructionCount ? code[at(pc)].opcode : ScriptOpcode::Halt;
+    };
+
+    auto isInterior = [&](int pc) {
+        return pc < instructionCount && targets[at(pc)] == 0;
+    };
+
+    for (int pc = 0; pc < instructionCount; ++pc) {
+        const ScriptInstruction& first = code[at(pc)];
+
+        if (first.opcode == ScriptOpcode::PushInt && opcodeAt(pc + 1) == ScriptOpcode::PushInt
+            && isBinary(opcodeAt(pc + 2)) && isInterior(pc + 1) && isInterior(pc + 2)) {
+
+            const int left  = first.operand;
+            const int right = code[at(pc + 1)].operand;
+
+            code[at(pc)]        = { ScriptOpcode::PushInt, evaluateBinary(opcodeAt(pc + 2), left, right) };
+            removed[at(pc + 1)] = 1;
+            removed[at(pc + 2)] = 1;
+            changed             = true;
+            pc += 2;
+            continue;
+        }
+
+        if (first.opcode == ScriptOpcode::PushInt && isInterior(pc + 1)
+            && (opcodeAt(pc + 1) == ScriptOpcode::Negate || opcodeAt(pc + 1) == ScriptOpcode::LogicalNot)) {
+
+            const int value = opcodeAt(pc + 1) == ScriptOpcode::Negate ? ScriptArithmetic::negate(first.operand)
+                                                                       : (first.operand == 0 ? 1 : 0);
+
+            code[at(pc)]        = { ScriptOpcode::PushInt, value };
+            removed[at(pc + 1)] = 1;
+            changed             = true;
+            pc += 1;
+            continue;
+        }
+
+        if (first.opcode == ScriptOpcode::PushInt && isInterior(pc + 1)
+            && (opcodeAt(pc + 1) == ScriptOpcode::JumpIfFalse || opcodeAt(pc + 1) == ScriptOpcode::JumpIfTrue)) {
+
+            const bool jumpsWhenZero = opcodeAt(pc + 1) == ScriptOpcode::JumpIfFalse;
+
+            if ((first.operand == 0) == jumpsWhenZero) {
+                code[at(pc)] = { ScriptOpcode::Jump, code[at(pc + 1)].operand };
+            }
+            else {
+                removed[at(pc)] = 1;
+            }
+
+            removed[at(pc + 1)] = 1;
+            changed             = true;
+            pc += 1;
+            continue;
+        }
+
+        if (isPurePush(first.opcode) && opcodeAt(pc + 1) == ScriptOpcode::Pop && isInterior(pc + 1)) {
+            removed[at(pc)]     = 1;
+            removed[at(pc + 1)] = 1;
+            changed             = true;
+            pc += 1;
+            continue;
+        }
+    }
+
+    if (!changed) {
+        return false;
+    }
+
+    compact(script, removed);
+
+    return true;
+}
+
+bool removeDeadStores(RTScript& script)
+{
+    std::vector<ScriptInstruction>& code = script.instructions;
+
+    const int instructionCount = static_cast<int>(code.size());
+
+    std::vector<std::uint32_t> liveOut(code.size(), 0);
+    std::vector<std::uint32_t> liveIn (code.size() + 1, 0);
+
+    for (bool changed = true; changed; ) {
+        changed = false;
+
+        for (int pc = instructionCount - 1; pc >= 0; --pc) {
+            const ScriptInstruction& instruction = code[at(pc)];
+
+            std::uint32_t out = 0;
+
+            if (fallsThrough(instruction.opcode)) {
+                out |= liveIn[at(pc + 1)];
+            }
+
+            if (isJump(instruction.opcode)) {
+                out |= liveIn[at(instruction.operand)];
+            }
+
+            std::uint32_t in = out;
+
+            if (instruction.opcode == ScriptOpcode::StoreLocal) {
+                in &= ~(1u << instruction.operand);
+            }
+
+            if (instruction.opcode == ScriptOpcode::PushLocal) {
+                in |= 1u << instruction.operand;
+            }
+
+            if (out != liveOut[at(pc)] || in != liveIn[at(pc)]) {
+                liveOut[at(pc)] = out;
+                liveIn [at(pc)] = in;
+                changed         = true;
+            }
+        }
+    }
+
+    bool removedStore = false;
+
+    for (int pc = 0; pc < instructionCount; ++pc) {
+        ScriptInstruction& instruction = code[at(pc)];
+
+        if (instruction.opcode == ScriptOpcode::StoreLocal && (liveOut[at(pc)] & (1u << instruction.operand)) == 0) {
+            instruction  = { ScriptOpcode::Pop };
+            removedStore = true;
+        }
+    }
+
+    return removedStore;
+}
+
+bool removeRedundantJumps(RTScript& script)
+{
+    std::vector<ScriptInstruction>& code = script.instructions;
+
+    const int instructionCount = static_cast<int>(code.size());
+
+    Flags removed(code.size(), 0);
+    bool  changed = false;
+
+    for (int pc = 0; pc < instructionCount; ++pc) {
+        ScriptInstruction& instruction = code[at(pc)];
+
+        if (!isJump(instruction.opcode)) {
+            continue;
+        }
+
+        for (int hops = 0; hops < instructionCount && instruction.operand < instructionCount; ++hops) {
+            const ScriptInstruction& target = code[at(instruction.operand)];
+
+            if (target.opcode != ScriptOpcode::Jump || target.operand == instruction.operand) {
+                break;
+            }
+
+            instruction.operand = target.operand;
+            changed             = true;
+        }
+
+        if (instruction.operand != pc + 1) {
+            continue;
+        }
+
+        if (instruction.opcode == ScriptOpcode::Jump) {
+            removed[at(pc)] = 1;
+        }
+        else {
+            instruction = { ScriptOpcode::Pop };
+        }
+
+        changed = true;
+    }
+
+    if (!changed) {
+        return false;
+    }
+
+    compact(script, removed);
+
+    return true;
+}
+
+}
+
+RTScript optimiseScript(const RTScript& script)
+{
+    RTScript optimised = script;
+
+    for (int pass = 0; pass < maxOptimisationPasses; ++pass) {
+        const ScriptVerification verification = verifyScript(optimised);
+
+        if (!verification.isValid) {
+            return script;
+        }
+
+        bool changed = removeUnreachable(optimised, verification);
+
+        changed = foldConstants       (optimised) || changed;
+        changed = removeDeadStores    (optimised) || changed;
+        changed = removeRedundantJumps(optimised) || changed;
+
+        if (!changed) {
+            break;
+        }
+    }
+
+    if (optimised.isEmpty() || !verifyScript(optimised).isValid) {
+        return script;
+    }
+
+    return optimised;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "RTScript.h"
+
+RTScript optimiseScript(const RTScript& script);
@@ -1,279 +1,726 @@
 #include "ScriptTraversalRule.h"
+#include "ScriptOptimiser.h"
 
+#include <bit>
 #include <cstddef>
+#include <initializer_list>
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define SEQUENCETREE_THREADED_SCRIPT_DISPATCH 1
+#else
+    #define SEQUENCETREE_THREADED_SCRIPT_DISPATCH 0
+#endif
 
 namespace {
 
-int readScriptField(const RuleContext& context, ScriptField field,
-                    const RTNode* currentChild, int currentChildId)
+using DecodedOp          = ScriptTraversalRule::DecodedOp;
+using DecodedInstruction = ScriptTraversalRule::DecodedInstruction;
+
+DecodedOp decodedFieldOp(ScriptField field)
 {
     switch (field) {
-        case ScriptField::ParentId:
-            return context.parent.nodeID;
-
-        case ScriptField::ParentCount:
-            return context.parentCount;
-
-        case ScriptField::ParentChildCount:
-            return static_cast<int>(context.parent.children.size());
+        case ScriptField::ParentId:               return DecodedOp::PushParentId;
+        case ScriptField::ParentCount:            return DecodedOp::PushParentCount;
+        case ScriptField::ParentChildCount:       return DecodedOp::PushParentChildCount;
+        case ScriptField::ParentLastChosenChild:  return DecodedOp::PushParentLastChosenChild;
+        case ScriptField::TraversalId:            return DecodedOp::PushTraversalId;
+        case ScriptField::ChildId:                return DecodedOp::PushChildId;
+        case ScriptField::ChildIsEligible:        return DecodedOp::PushChildIsEligible;
+        case ScriptField::ChildCountLimit:        return DecodedOp::PushChildCountLimit;
+        case ScriptField::ChildTriggerLimit:      return DecodedOp::PushChildTriggerLimit;
+        case ScriptField::ChildTriggerCount:      return DecodedOp::PushChildTriggerCount;
+        case ScriptField::ChildVisitCount:        return DecodedOp::PushChildVisitCount;
+        case ScriptField::ChildRepeatValue:       return DecodedOp::PushChildRepeatValue;
+        case ScriptField::ChildPitchOffset:       return DecodedOp::PushChildPitchOffset;
+        case ScriptField::ChildSwitchCountLimit:  return DecodedOp::PushChildSwitchCountLimit;
+        case ScriptField::ChildSubLoopCountLimit: return DecodedOp::PushChildSubLoopCountLimit;
+        case ScriptField::FieldCount:             break;
+    }
 
-        case ScriptField::ParentLastChosenChild:
-            return context.nodeState.get(NodeStateSlot::LastNode, context.parent.nodeID);
+    return DecodedOp::Halt;
+}
 
-        case ScriptField::TraversalId:
-            return context.traversalId;
+DecodedOp decodedOp(const ScriptInstruction& instruction)
+{
+    switch (instruction.opcode) {
+        case ScriptOpcode::Halt:           return DecodedOp::Halt;
+        case ScriptOpcode::PushInt:        return DecodedOp::PushInt;
+        case ScriptOpcode::PushLocal:      return DecodedOp::PushLocal;
+        case ScriptOpcode::PushField:      return decodedFieldOp(static_cast<ScriptField>(instruction.operand));
+        case ScriptOpcode::StoreLocal:     return DecodedOp::StoreLocal;
+        case ScriptOpcode::Pop:            return DecodedOp::Pop;
+        case ScriptOpcode::LoadChild:      return DecodedOp::LoadChild;
+        case ScriptOpcode::Add:            return DecodedOp::Add;
+        case ScriptOpcode::Subtract:       return DecodedOp::Subtract;
+        case ScriptOpcode::Multiply:       return DecodedOp::Multiply;
+        case ScriptOpcode::Divide:         return DecodedOp::Divide;
+        case ScriptOpcode::Modulo:         return DecodedOp::Modulo;
+        case ScriptOpcode::Negate:         return DecodedOp::Negate;
+        case ScriptOpcode::Equal:          return DecodedOp::Equal;
+        case ScriptOpcode::NotEqual:       return DecodedOp::NotEqual;
+        case ScriptOpcode::Less:           return DecodedOp::Less;
+        case ScriptOpcode::LessOrEqual:    return DecodedOp::LessOrEqual;
+        case ScriptOpcode::Greater:        return DecodedOp::Greater;
+        case ScriptOpcode::GreaterOrEqual: return DecodedOp::GreaterOrEqual;
+        case ScriptOpcode::LogicalAnd:     return DecodedOp::LogicalAnd;
+        case ScriptOpcode::LogicalOr:      return DecodedOp::LogicalOr;
+        case ScriptOpcode::LogicalNot:     return DecodedOp::LogicalNot;
+        case ScriptOpcode::Jump:           return DecodedOp::Jump;
+        case ScriptOpcode::JumpIfFalse:    return DecodedOp::JumpIfFalse;
+        case ScriptOpcode::JumpIfTrue:     return DecodedOp::JumpIfTrue;
+        case ScriptOpcode::Return:         return DecodedOp::Return;
+    }
 
-        case ScriptField::ChildIsEligible:
-            return currentChild != nullptr ? 1 : 0;
+    return DecodedOp::Halt;
+}
 
-        default:
-            break;
+int readField(int field, const RuleContext& context, const RTNodeRef& child)
+{
+    switch (static_cast<ScriptField>(field)) {
+        case ScriptField::ParentId:              return context.parent.nodeID;
+        case ScriptField::ParentCount:           return context.parentCount;
+        case ScriptField::ParentChildCount:      return context.childCount();
+        case ScriptField::ParentLastChosenChild: return context.nodeState.get(NodeStateSlot::LastNode, context.parent.nodeID);
+        case ScriptField::TraversalId:           return context.traversalId;
+        case ScriptField::ChildIsEligible:       return child ? 1 : 0;
+        default:                                 break;
     }
 
-    if (currentChild == nullptr) {
-        return field == ScriptField::ChildId ? -1 : 0;
+    if (!child) {
+        return field == static_cast<int>(ScriptField::ChildId) ? -1 : 0;
     }
 
-    switch (field) {
-        case ScriptField::ChildId:
-            return currentChildId;
+    switch (static_cast<ScriptField>(field)) {
+        case ScriptField::ChildId:                return child.id();
+        case ScriptField::ChildCountLimit:        return child.countLimit();
+        case ScriptField::ChildTriggerLimit:      return child.triggerLimit();
+        case ScriptField::ChildTriggerCount:      return context.nodeState.get(NodeStateSlot::Trigger, child.id());
+        case ScriptField::ChildVisitCount:        return context.nodeState.get(NodeStateSlot::Count, child.id());
+        case ScriptField::ChildRepeatValue:       return child.node().repeatValue;
+        case ScriptField::ChildPitchOffset:       return child.node().pitchOffset;
+        case ScriptField::ChildSwitchCountLimit:  return child.node().switchCountLimit;
+        case ScriptField::ChildSubLoopCountLimit: return child.node().subLoopCountLimit;
+        default:                                  return 0;
+    }
+}
 
-        case ScriptField::ChildCountLimit:
-            return currentChild->countLimit;
+bool isJumpOp(DecodedOp op)
+{
+    return op == DecodedOp::Jump
+        || op == DecodedOp::JumpIfFalse
+        || op == DecodedOp::JumpIfTrue
+        || op == DecodedOp::JumpIfFieldFalse
+        || op == DecodedOp::FieldModEqZeroJump
+        || op == DecodedOp::FieldGreaterLocalJump
+        || op == DecodedOp::ForEachChild;
+}
 
-        case ScriptField::ChildTriggerLimit:
-            return currentChild->triggerLimit;
+bool endsBlock(ScriptOpcode opcode)
+{
+    return opcode == ScriptOpcode::Jump
+        || opcode == ScriptOpcode::JumpIfFalse
+        || opcode == ScriptOpcode::JumpIfTrue
+        || opcode == ScriptOpcode::Return
+        || opcode == ScriptOpcode::Halt;
+}
 
-        case ScriptField::ChildTriggerCount:
-            return context.nodeState.get(NodeStateSlot::Trigger, currentChildId);
+using Flags = std::vector<std::uint8_t>;
 
-        case ScriptField::ChildVisitCount:
-            return context.nodeState.get(NodeStateSlot::Count, currentChildId);
+const ScriptInstruction* instructionAt(const RTScript& source, int pc)
+{
+    return pc < static_cast<int>(source.instructions.size()) ? &source.instructions[static_cast<std::size_t>(pc)]
+                                                             : nullptr;
+}
 
-        case ScriptField::ChildRepeatValue:
-            return currentChild->repeatValue;
+bool matches(const RTScript& source, const Flags& jumpTargets, int pc,
+             std::initializer_list<ScriptOpcode> opcodes)
+{
+    int offset = 0;
 
-        case ScriptField::ChildPitchOffset:
-            return currentChild->pitchOffset;
+    for (const ScriptOpcode opcode : opcodes) {
+        const ScriptInstruction* instruction = instructionAt(source, pc + offset);
 
-        case ScriptField::ChildSwitchCountLimit:
-            return currentChild->switchCountLimit;
+        if (instruction == nullptr || instruction->opcode != opcode) {
+            return false;
+        }
 
-        case ScriptField::ChildSubLoopCountLimit:
-            return currentChild->subLoopCountLimit;
+        if (offset > 0 && jumpTargets[static_cast<std::size_t>(pc + offset)] != 0) {
+            return false;
+        }
 
-        default:
-            return 0;
+        ++offset;
     }
+
+    return true;
 }
 
+int fuseSuperinstruction(const RTScript& source, const Flags& jumpTargets, int pc, DecodedInstruction& fused)
+{
+    const auto operandAt = [&source, pc](int offset) {
+        return source.instructions[static_cast<std::size_t>(pc + offset)].operand;
+    };
+
+    if (matches(source, jumpTargets, pc, { ScriptOpcode::PushLocal, ScriptOpcode::PushField, ScriptOpcode::Less,
+                                           ScriptOpcode::JumpIfFalse, ScriptOpcode::PushLocal, ScriptOpcode::LoadChild })
+        && operandAt(1) == static_cast<int>(ScriptField::ParentChildCount)
+        && operandAt(0) == operandAt(4)) {
+        fused = { nullptr, DecodedOp::ForEachChild, operandAt(3), operandAt(0), 0 };
+        return 6;
+    }
+
+    if (matches(source, jumpTargets, pc, { ScriptOpcode::PushField, ScriptOpcode::PushField, ScriptOpcode::Modulo,
+                                           ScriptOpcode::PushInt, ScriptOpcode::Equal, ScriptOpcode::JumpIfFalse })
+        && operandAt(3) == 0) {
+        fused = { nullptr, DecodedOp::FieldModEqZeroJump, operandAt(5), operandAt(0), operandAt(1) };
+        return 6;
+    }
+
+    if (matches(source, jumpTargets, pc, { ScriptOpcode::PushField, ScriptOpcode::PushLocal, ScriptOpcode::Greater,
+                                           ScriptOpcode::JumpIfFalse })) {
+        fused = { nullptr, DecodedOp::FieldGreaterLocalJump, operandAt(3), operandAt(0), operandAt(1) };
+        return 4;
+    }
+
+    if (matches(source, jumpTargets, pc, { ScriptOpcode::PushLocal, ScriptOpcode::PushInt, ScriptOpcode::Add,
+                                           ScriptOpcode::StoreLocal })
+        && operandAt(0) == operandAt(3)) {
+        fused = { nullptr, DecodedOp::IncrementLocal, operandAt(0), operandAt(1), 0 };
+        return 4;
+    }
+
+    if (matches(source, jumpTargets, pc, { ScriptOpcode::PushLocal, ScriptOpcode::PushInt, ScriptOpcode::Subtract,
+                                           ScriptOpcode::StoreLocal })
+        && operandAt(0) == operandAt(3)) {
+        fused = { nullptr, DecodedOp::IncrementLocal, operandAt(0), ScriptArithmetic::negate(operandAt(1)), 0 };
+        return 4;
+    }
+
+    if (matches(source, jumpTargets, pc, { ScriptOpcode::PushField, ScriptOpcode::JumpIfFalse })) {
+        fused = { nullptr, DecodedOp::JumpIfFieldFalse, operandAt(1), operandAt(0), 0 };
+        return 2;
+    }
+
+    if (matches(source, jumpTargets, pc, { ScriptOpcode::PushField, ScriptOpcode::StoreLocal })) {
+        fused = { nullptr, DecodedOp::StoreFieldToLocal, operandAt(1), operandAt(0), 0 };
+        return 2;
+    }
+
+    return 0;
 }
 
-int ScriptTraversalRule::selectChild(const RuleContext& context) const
+#if SEQUENCETREE_THREADED_SCRIPT_DISPATCH
+    #define SCRIPT_HANDLER(name) name##Handler:
+    #define SCRIPT_NEXT()        goto *ip->handler
+#else
+    #define SCRIPT_HANDLER(name) case DecodedOp::name:
+    #define SCRIPT_NEXT()        continue
+#endif
+
+#define SCRIPT_BINARY_HANDLER(name, expression)  \
+    SCRIPT_HANDLER(name) {                       \
+        const int right = *--top;                \
+        const int left  = top[-1];               \
+        top[-1] = (expression);                  \
+        ++ip;                                    \
+        SCRIPT_NEXT();                           \
+    }
+
+#define SCRIPT_FINISH(result)                              \
+    {                                                      \
+        if (stepsUsed != nullptr) {                        \
+            *stepsUsed = stepBudget - stepsRemaining;      \
+        }                                                  \
+        return result;                                     \
+    }
+
+int runProgram(const DecodedInstruction* code, const RuleContext* context, std::uint32_t uninitialisedLocals,
+               int stepBudget, int* stepsUsed, const void* const** handlerTable)
 {
-    if (script == nullptr || script->isEmpty()) {
+#if SEQUENCETREE_THREADED_SCRIPT_DISPATCH
+    static const void* const handlers[] = {
+        &&HaltHandler,
+        &&ChargeHandler,
+        &&PushIntHandler,
+        &&PushLocalHandler,
+        &&StoreLocalHandler,
+        &&PopHandler,
+        &&PushParentIdHandler,
+        &&PushParentCountHandler,
+        &&PushParentChildCountHandler,
+        &&PushParentLastChosenChildHandler,
+        &&PushTraversalIdHandler,
+        &&PushChildIdHandler,
+        &&PushChildIsEligibleHandler,
+        &&PushChildCountLimitHandler,
+        &&PushChildTriggerLimitHandler,
+        &&PushChildTriggerCountHandler,
+        &&PushChildVisitCountHandler,
+        &&PushChildRepeatValueHandler,
+        &&PushChildPitchOffsetHandler,
+        &&PushChildSwitchCountLimitHandler,
+        &&PushChildSubLoopCountLimitHandler,
+        &&LoadChildHandler,
+        &&AddHandler,
+        &&SubtractHandler,
+        &&MultiplyHandler,
+        &&DivideHandler,
+        &&ModuloHandler,
+        &&NegateHandler,
+        &&EqualHandler,
+        &&NotEqualHandler,
+        &&LessHandler,
+        &&LessOrEqualHandler,
+        &&GreaterHandler,
+        &&GreaterOrEqualHandler,
+        &&LogicalAndHandler,
+        &&LogicalOrHandler,
+        &&LogicalNotHandler,
+        &&JumpHandler,
+        &&JumpIfFalseHandler,
+        &&JumpIfTrueHandler,
+        &&ReturnHandler,
+        &&IncrementLocalHandler,
+        &&StoreFieldToLocalHandler,
+        &&JumpIfFieldFalseHandler,
+        &&FieldModEqZeroJumpHandler,
+        &&FieldGreaterLocalJumpHandler,
+        &&ForEachChildHandler,
+    };
+
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<std::size_t>(DecodedOp::OpCount));
+
+    if (handlerTable != nullptr) {
+        *handlerTable = handlers;
+        return -1;
+    }
+#else
+    if (handlerTable != nullptr) {
+        *handlerTable = nullptr;
         return -1;
     }
+#endif
 
-    int stack[RTScript::maxStack];
-    int stackTop = 0;
+    int  stack[RTScript::maxStack];
+    int* top = stack;
 
     int locals[RTScript::maxLocals];
 
-    for (int localIndex = 0; localIndex < RTScript::maxLocals; ++localIndex) {
-        locals[localIndex] = 0;
+    for (std::uint32_t pending = uninitialisedLocals; pending != 0; pending &= pending - 1) {
+        locals[std::countr_zero(pending)] = 0;
     }
 
-    const RTNode* currentChild   = nullptr;
-    int           currentChildId = -1;
+    RTNodeRef child;
 
-    const int instructionCount = static_cast<int>(script->instructions.size());
+    int stepsRemaining = stepBudget;
 
-    int programCounter = 0;
-    int stepsRemaining = script->stepBudget;
+    const DecodedInstruction* ip = code;
 
-    while (programCounter >= 0 && programCounter < instructionCount) {
+#if SEQUENCETREE_THREADED_SCRIPT_DISPATCH
+    SCRIPT_NEXT();
+#else
+    for (;;) switch (ip->op) {
+#endif
 
-        if (--stepsRemaining < 0) {
-            return -1;
+    SCRIPT_HANDLER(Halt) {
+        SCRIPT_FINISH(-1)
+    }
+
+    SCRIPT_HANDLER(Charge) {
+        stepsRemaining -= ip->operand;
+
+        if (stepsRemaining < 0) {
+            SCRIPT_FINISH(-1)
         }
 
-        const ScriptInstruction instruction = script->instructions[programCounter];
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-        ++programCounter;
+    SCRIPT_HANDLER(PushInt) {
+        *top++ = ip->operand;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-        switch (instruction.opcode) {
+    SCRIPT_HANDLER(PushLocal) {
+        *top++ = locals[ip->operand];
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::Halt: {
-                return -1;
-            }
+    SCRIPT_HANDLER(StoreLocal) {
+        locals[ip->operand] = *--top;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::PushInt: {
-                if (stackTop >= RTScript::maxStack) {
-                    return -1;
-                }
+    SCRIPT_HANDLER(Pop) {
+        --top;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                stack[stackTop++] = instruction.operand;
-                break;
-            }
+    SCRIPT_HANDLER(PushParentId) {
+        *top++ = context->parent.nodeID;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::PushLocal: {
-                if (stackTop >= RTScript::maxStack) {
-                    return -1;
-                }
+    SCRIPT_HANDLER(PushParentCount) {
+        *top++ = context->parentCount;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                if (instruction.operand < 0 || instruction.operand >= RTScript::maxLocals) {
-                    return -1;
-                }
+    SCRIPT_HANDLER(PushParentChildCount) {
+        *top++ = context->childCount();
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                stack[stackTop++] = locals[instruction.operand];
-                break;
-            }
+    SCRIPT_HANDLER(PushParentLastChosenChild) {
+        *top++ = context->nodeState.get(NodeStateSlot::LastNode, context->parent.nodeID);
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::PushField: {
-                if (stackTop >= RTScript::maxStack) {
-                    return -1;
-                }
+    SCRIPT_HANDLER(PushTraversalId) {
+        *top++ = context->traversalId;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                const ScriptField field = static_cast<ScriptField>(instruction.operand);
+    SCRIPT_HANDLER(PushChildId) {
+        *top++ = child ? child.id() : -1;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                stack[stackTop++] = readScriptField(context, field, currentChild, currentChildId);
-                break;
-            }
+    SCRIPT_HANDLER(PushChildIsEligible) {
+        *top++ = child ? 1 : 0;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::StoreLocal: {
-                if (stackTop < 1) {
-                    return -1;
-                }
+    SCRIPT_HANDLER(PushChildCountLimit) {
+        *top++ = child ? child.countLimit() : 0;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                if (instruction.operand < 0 || instruction.operand >= RTScript::maxLocals) {
-                    return -1;
-                }
+    SCRIPT_HANDLER(PushChildTriggerLimit) {
+        *top++ = child ? child.triggerLimit() : 0;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                locals[instruction.operand] = stack[--stackTop];
-                break;
-            }
+    SCRIPT_HANDLER(PushChildTriggerCount) {
+        *top++ = child ? context->nodeState.get(NodeStateSlot::Trigger, child.id()) : 0;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::Pop: {
-                if (stackTop < 1) {
-                    return -1;
-                }
+    SCRIPT_HANDLER(PushChildVisitCount) {
+        *top++ = child ? context->nodeState.get(NodeStateSlot::Count, child.id()) : 0;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                --stackTop;
-                break;
-            }
+    SCRIPT_HANDLER(PushChildRepeatValue) {
+        *top++ = child ? child.node().repeatValue : 0;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::LoadChild: {
-                if (stackTop < 1) {
-                    return -1;
-                }
+    SCRIPT_HANDLER(PushChildPitchOffset) {
+        *top++ = child ? child.node().pitchOffset : 0;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                const int childIndex = stack[--stackTop];
-                const int childCount = static_cast<int>(context.parent.children.size());
+    SCRIPT_HANDLER(PushChildSwitchCountLimit) {
+        *top++ = child ? child.node().switchCountLimit : 0;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                if (childIndex < 0 || childIndex >= childCount) {
-                    currentChild   = nullptr;
-                    currentChildId = -1;
-                    break;
-                }
+    SCRIPT_HANDLER(PushChildSubLoopCountLimit) {
+        *top++ = child ? child.node().subLoopCountLimit : 0;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                currentChildId = context.parent.children[static_cast<std::size_t>(childIndex)];
-                currentChild   = context.eligibleChild(currentChildId);
-                break;
-            }
+    SCRIPT_HANDLER(LoadChild) {
+        const int childIndex = *--top;
 
-            case ScriptOpcode::Negate:
-            case ScriptOpcode::LogicalNot: {
-                if (stackTop < 1) {
-                    return -1;
-                }
+        if (static_cast<unsigned>(childIndex) < static_cast<unsigned>(context->childCount())) {
+            child = context->eligibleChildRef(context->firstEdge() + childIndex);
+        }
+        else {
+            child = {};
+        }
 
-                const int value = stack[stackTop - 1];
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-                stack[stackTop - 1] = instruction.opcode == ScriptOpcode::Negate ? -value
-                                                                                 : (value == 0 ? 1 : 0);
-                break;
-            }
+    SCRIPT_BINARY_HANDLER(Add,            ScriptArithmetic::add     (left, right))
+    SCRIPT_BINARY_HANDLER(Subtract,       ScriptArithmetic::subtract(left, right))
+    SCRIPT_BINARY_HANDLER(Multiply,       ScriptArithmetic::multiply(left, right))
+    SCRIPT_BINARY_HANDLER(Divide,         ScriptArithmetic::divide  (left, right))
+    SCRIPT_BINARY_HANDLER(Modulo,         ScriptArithmetic::modulo  (left, right))
+    SCRIPT_BINARY_HANDLER(Equal,          left == right ? 1 : 0)
+    SCRIPT_BINARY_HANDLER(NotEqual,       left != right ? 1 : 0)
+    SCRIPT_BINARY_HANDLER(Less,           left <  right ? 1 : 0)
+    SCRIPT_BINARY_HANDLER(LessOrEqual,    left <= right ? 1 : 0)
+    SCRIPT_BINARY_HANDLER(Greater,        left >  right ? 1 : 0)
+    SCRIPT_BINARY_HANDLER(GreaterOrEqual, left >= right ? 1 : 0)
+    SCRIPT_BINARY_HANDLER(LogicalAnd,     (left != 0 && right != 0) ? 1 : 0)
+    SCRIPT_BINARY_HANDLER(LogicalOr,      (left != 0 || right != 0) ? 1 : 0)
+
+    SCRIPT_HANDLER(Negate) {
+        top[-1] = ScriptArithmetic::negate(top[-1]);
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::Add:
-            case ScriptOpcode::Subtract:
-            case ScriptOpcode::Multiply:
-            case ScriptOpcode::Divide:
-            case ScriptOpcode::Modulo:
-            case ScriptOpcode::Equal:
-            case ScriptOpcode::NotEqual:
-            case ScriptOpcode::Less:
-            case ScriptOpcode::LessOrEqual:
-            case ScriptOpcode::Greater:
-            case ScriptOpcode::GreaterOrEqual:
-            case ScriptOpcode::LogicalAnd:
-            case ScriptOpcode::LogicalOr: {
-                if (stackTop < 2) {
-                    return -1;
-                }
-
-                const int right = stack[--stackTop];
-                const int left  = stack[--stackTop];
-
-                int result = 0;
-
-                switch (instruction.opcode) {
-                    case ScriptOpcode::Add:            result = left + right;                     break;
-                    case ScriptOpcode::Subtract:       result = left - right;                     break;
-                    case ScriptOpcode::Multiply:       result = left * right;                     break;
-                    case ScriptOpcode::Divide:         result = right != 0 ? left / right : 0;    break;
-                    case ScriptOpcode::Modulo:         result = right != 0 ? left % right : 0;    break;
-                    case ScriptOpcode::Equal:          result = left == right ? 1 : 0;            break;
-                    case ScriptOpcode::NotEqual:       result = left != right ? 1 : 0;            break;
-                    case ScriptOpcode::Less:           result = left <  right ? 1 : 0;            break;
-                    case ScriptOpcode::LessOrEqual:    result = left <= right ? 1 : 0;            break;
-                    case ScriptOpcode::Greater:        result = left >  right ? 1 : 0;            break;
-                    case ScriptOpcode::GreaterOrEqual: result = left >= right ? 1 : 0;            break;
-                    case ScriptOpcode::LogicalAnd:     result = (left != 0 && right != 0) ? 1 : 0; break;
-                    case ScriptOpcode::LogicalOr:      result = (left != 0 || right != 0) ? 1 : 0; break;
-                    default:                                                                      break;
-                }
-
-                stack[stackTop++] = result;
-                break;
-            }
+    SCRIPT_HANDLER(LogicalNot) {
+        top[-1] = top[-1] == 0 ? 1 : 0;
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::Jump: {
-                programCounter = instruction.operand;
-                break;
-            }
+    SCRIPT_HANDLER(Jump) {
+        ip = code + ip->operand;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::JumpIfFalse: {
-                if (stackTop < 1) {
-                    return -1;
-                }
+    SCRIPT_HANDLER(JumpIfFalse) {
+        ip = *--top == 0 ? code + ip->operand : ip + 1;
+        SCRIPT_NEXT();
+    }
 
-                if (stack[--stackTop] == 0) {
-                    programCounter = instruction.operand;
-                }
-                break;
-            }
+    SCRIPT_HANDLER(JumpIfTrue) {
+        ip = *--top != 0 ? code + ip->operand : ip + 1;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::JumpIfTrue: {
-                if (stackTop < 1) {
-                    return -1;
-                }
+    SCRIPT_HANDLER(Return) {
+        SCRIPT_FINISH(*--top)
+    }
 
-                if (stack[--stackTop] != 0) {
-                    programCounter = instruction.operand;
-                }
-                break;
-            }
+    SCRIPT_HANDLER(IncrementLocal) {
+        locals[ip->operand] = ScriptArithmetic::add(locals[ip->operand], ip->first);
+        ++ip;
+        SCRIPT_NEXT();
+    }
 
-            case ScriptOpcode::Return: {
-                if (stackTop < 1) {
-                    return -1;
-                }
+    SCRIPT_HANDLER(StoreFieldToLocal) {
+        locals[ip->operand] = readField(ip->first, *context, child);
+        ++ip;
+        SCRIPT_NEXT();
+    }
+
+    SCRIPT_HANDLER(JumpIfFieldFalse) {
+        ip = readField(ip->first, *context, child) == 0 ? code + ip->operand : ip + 1;
+        SCRIPT_NEXT();
+    }
+
+    SCRIPT_HANDLER(FieldModEqZeroJump) {
+        const int left  = readField(ip->first,  *context, child);
+        const int right = readField(ip->second, *context, child);
+
+        ip = ScriptArithmetic::modulo(left, right) != 0 ? code + ip->operand : ip + 1;
+        SCRIPT_NEXT();
+    }
+
+    SCRIPT_HANDLER(FieldGreaterLocalJump) {
+        ip = readField(ip->first, *context, child) > locals[ip->second] ? ip + 1 : code + ip->operand;
+        SCRIPT_NEXT();
+    }
+
+    SCRIPT_HANDLER(ForEachChild) {
+        const int childIndex = locals[ip->first];
+        const int childCount = context->childCount();
+
+        if (childIndex >= childCount) {
+            ip = code + ip->operand;
+            SCRIPT_NEXT();
+        }
+
+        stepsRemaining -= ip->second;
+
+        if (stepsRemaining < 0) {
+            SCRIPT_FINISH(-1)
+        }
+
+        child = childIndex >= 0 ? context->eligibleChildRef(context->firstEdge() + childIndex) : RTNodeRef {};
+
+        ++ip;
+        SCRIPT_NEXT();
+    }
+
+#if !SEQUENCETREE_THREADED_SCRIPT_DISPATCH
+    case DecodedOp::OpCount:
+        SCRIPT_FINISH(-1)
+    }
+#endif
+}
+
+#undef SCRIPT_FINISH
+#undef SCRIPT_BINARY_HANDLER
+#undef SCRIPT_NEXT
+#undef SCRIPT_HANDLER
+
+void decode(const RTScript& source, const ScriptVerification& verification,
+            ScriptTraversalRule::StepAccounting accounting, ScriptTraversalRule::Program& decoded)
+{
+    std::vector<DecodedInstruction>& program = decoded.instructions;
 
-                return stack[--stackTop];
+    const int instructionCount = static_cast<int>(source.instructions.size());
+
+    Flags isLeader   (static_cast<std::size_t>(instructionCount) + 1, 0);
+    Flags jumpTargets(static_cast<std::size_t>(instructionCount) + 1, 0);
+
+    isLeader[0] = 1;
+
+    for (int pc = 0; pc < instructionCount; ++pc) {
+        const ScriptInstruction& instruction = source.instructions[static_cast<std::size_t>(pc)];
+
+        if (verification.reachable[static_cast<std::size_t>(pc)] == 0) {
+            continue;
+        }
+
+        if (isJumpOp(decodedOp(instruction))) {
+            isLeader   [static_cast<std::size_t>(instruction.operand)] = 1;
+            jumpTargets[static_cast<std::size_t>(instruction.operand)] = 1;
+        }
+
+        if (endsBlock(instruction.opcode)) {
+            isLeader[static_cast<std::size_t>(pc) + 1] = 1;
+        }
+    }
+
+    const bool chargesSteps = accounting == ScriptTraversalRule::StepAccounting::Always
+                           || verification.hasBackEdges || instructionCount > source.stepBudget;
+
+    auto blockCost = [&](int leader) {
+        if (!chargesSteps) {
+            return 0;
+        }
+
+        int blockEnd = leader + 1;
+
+        while (blockEnd < instructionCount && isLeader[static_cast<std::size_t>(blockEnd)] == 0) {
+            ++blockEnd;
+        }
+
+        return blockEnd - leader;
+    };
+
+    std::vector<int> decodedIndices(static_cast<std::size_t>(instructionCount) + 1, 0);
+
+    program.reserve(static_cast<std::size_t>(instructionCount) * 2 + 1);
+
+    for (int pc = 0; pc <= instructionCount; ++pc) {
+        decodedIndices[static_cast<std::size_t>(pc)] = static_cast<int>(program.size());
+
+        if (pc == instructionCount || verification.reachable[static_cast<std::size_t>(pc)] == 0) {
+            program.push_back({ nullptr, DecodedOp::Halt, 0 });
+            continue;
+        }
+
+        if (chargesSteps && isLeader[static_cast<std::size_t>(pc)] != 0) {
+            program.push_back({ nullptr, DecodedOp::Charge, blockCost(pc) });
+        }
+
+        DecodedInstruction fused;
+
+        if (const int fusedLength = fuseSuperinstruction(source, jumpTargets, pc, fused); fusedLength > 0) {
+            if (fused.op == DecodedOp::ForEachChild) {
+                fused.second = blockCost(pc + 4);
             }
+
+            program.push_back(fused);
+            pc += fusedLength - 1;
+            continue;
+        }
+
+        const ScriptInstruction& instruction = source.instructions[static_cast<std::size_t>(pc)];
+
+        program.push_back({ nullptr, decodedOp(instruction), instruction.operand });
+    }
+
+    const void* const* handlers = nullptr;
+    runProgram(nullptr, nullptr, 0, 0, nullptr, &handlers);
+
+    for (DecodedInstruction& instruction : program) {
+        if (isJumpOp(instruction.op)) {
+            instruction.operand = decodedIndices[static_cast<std::size_t>(instruction.operand)];
         }
+
+        if (handlers != nullptr) {
+            instruction.handler = handlers[static_cast<std::size_t>(instruction.op)];
+        }
+    }
+
+    decoded.uninitialisedLocals = verification.uninitialisedLocals;
+    decoded.stepBudget          = source.stepBudget;
+    decoded.chargesSteps        = chargesSteps;
+}
+
+}
+
+std::shared_ptr<const ScriptTraversalRule::Program> ScriptTraversalRule::compile(const RTScript& source,
+                                                                               StepAccounting accounting)
+{
+    if (source.isEmpty() || !verifyScript(source).isValid) {
+        return nullptr;
+    }
+
+    auto compiled = std::make_shared<Program>();
+
+    compiled->optimisedScript = optimiseScript(source);
+
+    const ScriptVerification verification = verifyScript(compiled->optimisedScript);
+
+    if (!verification.isValid) {
+        return nullptr;
+    }
+
+    decode(compiled->optimisedScript, verification, accounting, *compiled);
+
+    return compiled;
+}
+
+bool ScriptTraversalRule::setScript(const RTScript* newScript)
+{
+    script = newScript;
+
+    ownedProgram = script != nullptr ? compile(*script) : nullptr;
+    program      = ownedProgram.get();
+
+    return program != nullptr;
+}
+
+int ScriptTraversalRule::selectChild(const RuleContext& context) const
+{
+    if (program == nullptr || program->instructions.empty()) {
+        return -1;
+    }
+
+    return runProgram(program->instructions.data(), &context, program->uninitialisedLocals, program->stepBudget,
+                      nullptr, nullptr);
+}
+
+int ScriptTraversalRule::selectChild(const RuleContext& context, int& stepsUsed) const
+{
+    stepsUsed = 0;
+
+    if (program == nullptr || program->instructions.empty()) {
+        return -1;
     }
 
-    return -1;
+    return runProgram(program->instructions.data(), &context, program->uninitialisedLocals, program->stepBudget,
+                      &stepsUsed, nullptr);
 }
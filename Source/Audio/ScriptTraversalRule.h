@@ -3,17 +3,121 @@
 #include "RTScript.h"
 #include "TraversalRule.h"
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 class ScriptTraversalRule : public TraversalRule
 {
 public:
 
-    void setScript(const RTScript* newScript) { script = newScript; }
+    enum class DecodedOp
+    {
+        Halt,
+        Charge,
+
+        PushInt,
+        PushLocal,
+        StoreLocal,
+        Pop,
+
+        PushParentId,
+        PushParentCount,
+        PushParentChildCount,
+        PushParentLastChosenChild,
+        PushTraversalId,
+        PushChildId,
+        PushChildIsEligible,
+        PushChildCountLimit,
+        PushChildTriggerLimit,
+        PushChildTriggerCount,
+        PushChildVisitCount,
+        PushChildRepeatValue,
+        PushChildPitchOffset,
+        PushChildSwitchCountLimit,
+        PushChildSubLoopCountLimit,
+
+        LoadChild,
+
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Modulo,
+        Negate,
+
+        Equal,
+        NotEqual,
+        Less,
+        LessOrEqual,
+        Greater,
+        GreaterOrEqual,
+
+        LogicalAnd,
+        LogicalOr,
+        LogicalNot,
+
+        Jump,
+        JumpIfFalse,
+        JumpIfTrue,
+
+        Return,
+
+        IncrementLocal,
+        StoreFieldToLocal,
+        JumpIfFieldFalse,
+        FieldModEqZeroJump,
+        FieldGreaterLocalJump,
+        ForEachChild,
+
+        OpCount
+    };
+
+    struct DecodedInstruction
+    {
+        const void* handler = nullptr;
+        DecodedOp   op      = DecodedOp::Halt;
+        int         operand = 0;
+        int         first   = 0;
+        int         second  = 0;
+    };
+
+    enum class StepAccounting
+    {
+        WhenNeeded,
+        Always
+    };
+
+    struct Program
+    {
+        RTScript optimisedScript;
+
+        std::vector<DecodedInstruction> instructions;
+
+        std::uint32_t uninitialisedLocals = 0;
+        int           stepBudget          = 0;
+        bool          chargesSteps        = false;
+    };
+
+    static std::shared_ptr<const Program> compile(const RTScript& source,
+                                                  StepAccounting accounting = StepAccounting::WhenNeeded);
+
+    bool setScript(const RTScript* newScript);
+
+    void setProgram(const Program* newProgram) { program = newProgram; }
+
+    const Program* getProgram() const { return program; }
 
     const RTScript* getScript() const { return script; }
 
     int selectChild(const RuleContext& context) const override;
 
+    int selectChild(const RuleContext& context, int& stepsUsed) const;
+
 private:
 
-    const RTScript* script = nullptr;
+    const RTScript* script  = nullptr;
+    const Program*  program = nullptr;
+
+    std::shared_ptr<const Program> ownedProgram;
 };
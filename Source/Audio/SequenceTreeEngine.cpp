@@ -0,0 +1,256 @@
+#include "SequenceTreeEngine.h"
+#include <algorithm>
+
+void SequenceTreeEngine::prepare(double sampleRate, int bufferLatencySamples)
+{
+    tempoInfo.currentSampleRate    = sampleRate;
+    tempoInfo.bufferLatencySamples = bufferLatencySamples;
+    traversalSession.prepare(nodeStateCapacity);
+}
+
+void SequenceTreeEngine::releaseResources()
+{
+    retiredSnapshots.clear();
+}
+
+void SequenceTreeEngine::processBlock(const juce::AudioPlayHead* playHead, int numSamples, juce::MidiBuffer& midiMessages)
+{
+    struct BlockScope
+    {
+        std::atomic<std::uint64_t>& counter;
+        AudioUIBridge&              bridge;
+        int                         numSamples;
+
+        ~BlockScope()
+        {
+            bridge.endBlock(numSamples);
+            counter.fetch_add(1, std::memory_order_release);
+        }
+    };
+
+    eventManager.bridge.beginBlock(tempoInfo.currentSampleRate, tempoInfo.bufferLatencySamples);
+
+    const BlockScope blockScope { blocksCompleted, eventManager.bridge, numSamples };
+
+    midiMessages.clear();
+
+    const bool resetHit = resetRequested.exchange(false);
+
+    if (resetHit) {
+        traversalSession.silenceAllNotes(midiMessages);
+    }
+
+    TransportClock::HostPosition hostPosition;
+
+    const bool hostSynced = syncToHost.load()
+                         && TransportClock::readHostPosition(playHead, hostPosition);
+
+    const bool playing   = isPlaying.load() && (!hostSynced || hostPosition.isPlaying);
+    const bool suspended = wasPlaying && !playing;
+
+    if (suspended) {
+        traversalSession.suspendActiveNotes(midiMessages);
+    }
+
+    wasPlaying = playing;
+
+    const int readyPatches = durationPatches.numReady();
+
+    AudioSnapshot* snap = currentSnapshot.load(std::memory_order_acquire);
+
+    durationPatches.drain(readyPatches, [snap](const DurationPatch& patch) {
+        if (snap != nullptr) {
+            snap->nodes.applyDurationPatch(patch);
+        }
+    });
+
+    TraversalPool& traversals = traversalSession.getTraversals();
+
+    if (snap != nullptr && snap->nodeStates != nullptr) {
+        traversals.adoptNodeStates(*snap->nodeStates);
+    }
+
+    traversals.bindNodeDirectory(snap != nullptr ? &snap->nodes : nullptr);
+
+    nodeStateOverflows.store(traversals.nodeStateOverflowCount(), std::memory_order_relaxed);
+
+    traversalSession.adoptSelectionRules(snap != nullptr ? snap->selectionRule.get() : nullptr,
+                                         snap != nullptr ? &snap->traversalRules : nullptr);
+
+    if (!playing || !snap || !snap->rtGraphs) {
+        if (resetHit) {
+            traversalSession.clearTraversals();
+        }
+
+        if ((resetHit || suspended) && notifyUi) {
+            notifyUi();
+        }
+        return;
+    }
+
+    const RTNodeDirectory& nodes    = snap->nodes;
+    RTGraphs&              rtGraphs = *snap->rtGraphs;
+
+    eventManager.beginBlock(tempoInfo.currentSampleRate, hostSynced ? &hostPosition : nullptr);
+
+    if (resetHit) {
+        traversalSession.restartActiveTraversals(nodes, rtGraphs, midiMessages);
+
+        if (notifyUi) {
+            notifyUi();
+        }
+    }
+
+    traversalSession.syncWithGraph(nodes, rtGraphs, midiMessages, snap->generation);
+
+    if (traversalSession.isIdle()
+        && !traversalSession.startTraversalsFromFirstRoot(nodes, rtGraphs, midiMessages)) {
+        return;
+    }
+
+    eventManager.processEvents(numSamples, midiMessages, nodes, traversalSession.getTraversals(), snap->generation);
+
+    if (notifyUi && hasPendingUiCommands()) {
+        notifyUi();
+    }
+}
+
+bool SequenceTreeEngine::hasPendingUiCommands() const
+{
+    return eventManager.bridge.hasPendingCommands();
+}
+
+void SequenceTreeEngine::setNewGraph(std::shared_ptr<RTGraph> graph)
+{
+    auto compiled = std::make_shared<RTCompiledGraph>(RTCompiledGraph::compile(graph->nodeMap, graph->graphID));
+    compiled->revision = ++graphRevision;
+
+    publishGraph(std::move(graph), std::move(compiled));
+}
+
+void SequenceTreeEngine::publishGraph(std::shared_ptr<RTGraph> graph, std::shared_ptr<RTCompiledGraph> compiled)
+{
+    const AudioSnapshot* oldSnap = publishedSnapshot.get();
+
+    auto newSnap = std::make_shared<AudioSnapshot>();
+
+    if (oldSnap && oldSnap->rtGraphs) {
+        newSnap->rtGraphs = std::make_shared<RTGraphs>(*oldSnap->rtGraphs);
+    } else {
+        newSnap->rtGraphs = std::make_shared<RTGraphs>();
+    }
+
+    (*newSnap->rtGraphs)[graph->graphID] = graph;
+
+    newSnap->nodes = oldSnap ? oldSnap->nodes.withGraph(std::move(compiled))
+                             : RTNodeDirectory().withGraph(std::move(compiled));
+
+    newSnap->nodeStates = reserveNodeStates(oldSnap, NodeStateTable::capacityFor(newSnap->nodes.stateSlotCount()));
+
+    if (oldSnap) {
+        newSnap->selectionRule  = oldSnap->selectionRule;
+        newSnap->traversalRules = oldSnap->traversalRules;
+    }
+
+    publishAudioSnapshot(newSnap);
+}
+
+void SequenceTreeEngine::setSelectionRule(std::shared_ptr<const ScriptTraversalRule::Program> rule)
+{
+    const AudioSnapshot* oldSnap = publishedSnapshot.get();
+
+    auto newSnap = oldSnap ? std::make_shared<AudioSnapshot>(*oldSnap) : std::make_shared<AudioSnapshot>();
+
+    newSnap->selectionRule = std::move(rule);
+
+    publishAudioSnapshot(newSnap);
+}
+
+void SequenceTreeEngine::setTraversalRule(int ruleIndex, std::shared_ptr<const ScriptTraversalRule::Program> rule)
+{
+    if (ruleIndex < 0 || ruleIndex >= TraversalSession::maxTraversalRules) {
+        jassertfalse;
+        return;
+    }
+
+    const AudioSnapshot* oldSnap = publishedSnapshot.get();
+
+    auto newSnap = oldSnap ? std::make_shared<AudioSnapshot>(*oldSnap) : std::make_shared<AudioSnapshot>();
+
+    newSnap->traversalRules[static_cast<std::size_t>(ruleIndex)] = std::move(rule);
+
+    publishAudioSnapshot(newSnap);
+}
+
+void SequenceTreeEngine::clearTraversalRules()
+{
+    const AudioSnapshot* oldSnap = publishedSnapshot.get();
+
+    auto newSnap = oldSnap ? std::make_shared<AudioSnapshot>(*oldSnap) : std::make_shared<AudioSnapshot>();
+
+    newSnap->traversalRules = {};
+
+    publishAudioSnapshot(newSnap);
+}
+
+void SequenceTreeEngine::publishAudioSnapshot(std::shared_ptr<AudioSnapshot> snapshot)
+{
+    static_assert(std::atomic<AudioSnapshot*>::is_always_lock_free,
+                  "the audio thread must be able to read the snapshot without a lock");
+
+    snapshot->generation = ++snapshotGeneration;
+
+    AudioSnapshot* raw = snapshot.get();
+
+    auto retired      = std::move(publishedSnapshot);
+    publishedSnapshot = std::move(snapshot);
+
+    currentSnapshot.store(raw, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (retired != nullptr) {
+        retiredSnapshots.push_back({ std::move(retired),
+                                     blocksCompleted.load(std::memory_order_acquire) });
+    }
+
+    collectRetiredSnapshots();
+}
+
+bool SequenceTreeEngine::pushDurationPatches(const std::vector<DurationPatch>& patches)
+{
+    if (durationPatches.freeSpace() < static_cast<int>(patches.size())) {
+        return false;
+    }
+
+    for (const DurationPatch& patch : patches) {
+        durationPatches.tryPush(patch);
+    }
+
+    return true;
+}
+
+std::shared_ptr<NodeStateReserve> SequenceTreeEngine::reserveNodeStates(const AudioSnapshot* previous, int requiredCapacity)
+{
+    if (requiredCapacity <= nodeStateCapacity) {
+        return previous ? previous->nodeStates : nullptr;
+    }
+
+    nodeStateCapacity = requiredCapacity;
+
+    return std::make_shared<NodeStateReserve>(nodeStateCapacity, TraversalSession::maxConcurrentTraversals);
+}
+
+void SequenceTreeEngine::collectRetiredSnapshots()
+{
+    const std::uint64_t completed = blocksCompleted.load(std::memory_order_acquire);
+
+    auto isUnreachableByAudioThread = [completed](const RetiredSnapshot& entry) {
+        return completed > entry.retiredAtBlock;
+    };
+
+    retiredSnapshots.erase(std::remove_if(retiredSnapshots.begin(),
+                                          retiredSnapshots.end(),
+                                          isUnreachableByAudioThread),
+                           retiredSnapshots.end());
+}
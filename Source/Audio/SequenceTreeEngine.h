@@ -0,0 +1,99 @@
+#pragma once
+
+#include "../Util/CoreModules.h"
+#include <memory>
+#include <atomic>
+#include <functional>
+#include "../Graph/RTData.h"
+#include "../Graph/RTNodeDirectory.h"
+#include "AudioUIBridge.h"
+#include "EventManager.h"
+#include "TraversalSession.h"
+
+class SequenceTreeEngine
+{
+public:
+
+    SequenceTreeEngine() = default;
+
+    void prepare(double sampleRate, int bufferLatencySamples = 0);
+    void releaseResources();
+
+    void processBlock(const juce::AudioPlayHead* playHead, int numSamples, juce::MidiBuffer& midiMessages);
+
+    void setNewGraph(std::shared_ptr<RTGraph> graph);
+
+    void setSelectionRule(std::shared_ptr<const ScriptTraversalRule::Program> rule);
+    void setTraversalRule(int ruleIndex, std::shared_ptr<const ScriptTraversalRule::Program> rule);
+    void clearTraversalRules();
+
+    std::function<void()> notifyUi;
+
+    struct AudioSnapshot
+    {
+        std::shared_ptr<RTGraphs>         rtGraphs;
+        RTNodeDirectory                   nodes;
+        std::shared_ptr<NodeStateReserve> nodeStates;
+        std::uint64_t                     generation = 0;
+
+        std::shared_ptr<const ScriptTraversalRule::Program> selectionRule;
+        TraversalSession::TraversalRulePrograms             traversalRules;
+    };
+
+    std::atomic<AudioSnapshot*> currentSnapshot { nullptr };
+    std::atomic<std::uint64_t>  blocksCompleted { 0 };
+
+    void publishAudioSnapshot(std::shared_ptr<AudioSnapshot> snapshot);
+
+    bool pushDurationPatches(const std::vector<DurationPatch>& patches);
+
+    std::atomic<bool>   isPlaying       = false;
+    std::atomic<bool>   resetRequested  = false;
+    bool                wasPlaying      = false;
+    std::atomic<double> tempoMultiplier { 1.0 };
+    std::atomic<bool>   syncToHost      { false };
+
+    struct TempoInfo
+    {
+        double currentSampleRate    = 44100.0;
+        int    bufferLatencySamples = 0;
+    };
+
+    TempoInfo tempoInfo;
+
+    EventManager     eventManager     { *this };
+    TraversalSession traversalSession { eventManager };
+
+    bool hasPendingUiCommands() const;
+
+    const AudioSnapshot* getPublishedSnapshot() const { return publishedSnapshot.get(); }
+
+    int getNodeStateCapacity() const { return nodeStateCapacity; }
+
+    std::uint64_t getNodeStateOverflowCount() const { return nodeStateOverflows.load(std::memory_order_relaxed); }
+
+private:
+
+    struct RetiredSnapshot
+    {
+        std::shared_ptr<AudioSnapshot> snapshot;
+        std::uint64_t                  retiredAtBlock = 0;
+    };
+
+    void publishGraph(std::shared_ptr<RTGraph> graph, std::shared_ptr<RTCompiledGraph> compiled);
+    void collectRetiredSnapshots();
+
+    std::shared_ptr<NodeStateReserve> reserveNodeStates(const AudioSnapshot* previous, int requiredCapacity);
+
+    std::shared_ptr<AudioSnapshot> publishedSnapshot;
+    std::vector<RetiredSnapshot>   retiredSnapshots;
+    std::uint64_t                  graphRevision = 0;
+    std::uint64_t                  snapshotGeneration = 0;
+    int                            nodeStateCapacity = NodeStateTable::defaultCapacity;
+
+    std::atomic<std::uint64_t> nodeStateOverflows { 0 };
+
+    CommandFifo<DurationPatch, 1024> durationPatches;
+
+    JUCE_DECLARE_NON_COPYABLE (SequenceTreeEngine)
+};
@@ -0,0 +1,96 @@
+#include "TransportClock.h"
+
+#include <cmath>
+#include <limits>
+
+bool TransportClock::readHostPosition(const juce::AudioPlayHead* playHead, HostPosition& position)
+{
+    if (playHead == nullptr) {
+        return false;
+    }
+
+    const auto info = playHead->getPosition();
+    if (!info) {
+        return false;
+    }
+
+    const auto ppq = info->getPpqPosition();
+    const auto bpm = info->getBpm();
+
+    if (!ppq || !bpm || *bpm <= 0.0) {
+        return false;
+    }
+
+    position.ppq       = *ppq;
+    position.bpm       = *bpm;
+    position.isPlaying = info->getIsPlaying();
+
+    return true;
+}
+
+void TransportClock::beginBlock(double newSampleRate, const HostPosition* host)
+{
+    const bool wasSynced = hostSynced;
+
+    previousBlockStart     = blockStart;
+    previousSamplesPerUnit = samplesPerUnit;
+
+    sampleRate   = newSampleRate;
+    hostSynced   = host != nullptr;
+    unitsChanged = hostSynced != wasSynced;
+    jumpDelta    = 0;
+
+    if (!hostSynced) {
+        samplesPerUnit = 1.0;
+        unitsPerMs     = sampleRate / 1000.0;
+
+        if (unitsChanged) {
+            blockStart = 0.0;
+        }
+        return;
+    }
+
+    samplesPerUnit = sampleRate * 60.0 / (host->bpm * ticksPerQuarter);
+    unitsPerMs     = ticksPerQuarter / msPerQuarter;
+
+    const double hostStart = host->ppq * ticksPerQuarter;
+
+    if (!unitsChanged && std::abs(hostStart - previousBlockStart) > jumpToleranceTicks) {
+        jumpDelta = std::llround(hostStart - previousBlockStart);
+    }
+
+    blockStart = hostStart;
+}
+
+void TransportClock::endBlock(int numSamples)
+{
+    blockStart += numSamples / samplesPerUnit;
+}
+
+std::int64_t TransportClock::durationFromMs(double durationMs, double tempoMultiplier) const
+{
+    return std::llround(durationMs * unitsPerMs / tempoMultiplier);
+}
+
+std::int64_t TransportClock::positionAt(int sample) const
+{
+    return std::llround(blockStart + sample / samplesPerUnit);
+}
+
+int TransportClock::sampleOffset(std::int64_t position) const
+{
+    const double offset = std::round((static_cast<double>(position) - blockStart) * samplesPerUnit);
+
+    return static_cast<int>(juce::jlimit<double>(std::numeric_limits<int>::min(),
+                                                 std::numeric_limits<int>::max(), offset));
+}
+
+std::int64_t TransportClock::rebase(std::int64_t position) const
+{
+    if (unitsChanged) {
+        const double remainingSamples = (static_cast<double>(position) - previousBlockStart) * previousSamplesPerUnit;
+        return std::llround(blockStart + remainingSamples / samplesPerUnit);
+    }
+
+    return position + jumpDelta;
+}
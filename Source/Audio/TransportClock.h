@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../Util/CoreModules.h"
+#include <cstdint>
+
+class TransportClock
+{
+public:
+
+    static constexpr int    ticksPerQuarter    = 960;
+    static constexpr double msPerQuarter       = 500.0;
+    static constexpr double jumpToleranceTicks = ticksPerQuarter / 4.0;
+
+    struct HostPosition
+    {
+        double ppq       = 0.0;
+        double bpm       = 120.0;
+        bool   isPlaying = false;
+    };
+
+    static bool readHostPosition(const juce::AudioPlayHead* playHead, HostPosition& position);
+
+    void beginBlock(double sampleRate, const HostPosition* host);
+    void endBlock(int numSamples);
+
+    bool isHostSynced() const { return hostSynced; }
+
+    std::int64_t durationFromMs(double durationMs, double tempoMultiplier) const;
+    std::int64_t positionAt    (int sample) const;
+    int          sampleOffset  (std::int64_t position) const;
+    std::int64_t rebase        (std::int64_t position) const;
+
+    bool hasRebased() const { return unitsChanged || jumpDelta != 0; }
+
+private:
+
+    double sampleRate     = 44100.0;
+    bool   hostSynced     = false;
+    double blockStart     = 0.0;
+    double samplesPerUnit = 1.0;
+    double unitsPerMs     = 44.1;
+
+    bool         unitsChanged           = false;
+    double       previousBlockStart     = 0.0;
+    double       previousSamplesPerUnit = 1.0;
+    std::int64_t jumpDelta              = 0;
+};
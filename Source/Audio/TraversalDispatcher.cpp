@@ -1,20 +1,20 @@
 #include "TraversalDispatcher.h"
 #include "AudioUIBridge.h"
-#include "../Plugin/PluginProcessor.h"
+#include "SequenceTreeEngine.h"
 #include <unordered_set>
 #include <functional>
 
-TraversalDispatcher::TraversalDispatcher(SequenceTreeAudioProcessor& p,
+TraversalDispatcher::TraversalDispatcher(SequenceTreeEngine& e,
                                          NoteScheduler& s,
                                          AudioUIBridge& b)
-    : processor(p), scheduler(s), bridge(b)
+    : engine(e), scheduler(s), bridge(b)
 {
     chordVisited.reserve(scratchCapacity);
     chordFrontier.reserve(scratchCapacity);
     crossTreeScratch.reserve(scratchCapacity);
 }
 
-void TraversalDispatcher::applyStepResult(const TraversalLogic::StepResult& step, const NodeMap& nodes, int traversalId)
+void TraversalDispatcher::applyStepResult(const TraversalLogic::StepResult& step, const RTNodeDirectory& nodes, int traversalId)
 {
     auto highlight = [&](int nodeId, bool on) {
         auto it = nodes.find(nodeId);
@@ -53,13 +53,18 @@ void TraversalDispatcher::applyStepResult(const TraversalLogic::StepResult& step
         auto it = nodes.find(step.countSourceNodeId);
 
         if (it != nodes.end()) {
-            for (int childId : it->second.children) {
-                auto childIt = nodes.find(childId);
-                if (childIt == nodes.end()) {
+            const RTCompiledGraph& graph       = nodes.graphOf(it->second);
+            const int              sourceIndex = it->second.denseIndex;
+
+            for (int edge = graph.firstEdge(sourceIndex); edge < graph.edgeEnd(sourceIndex); ++edge) {
+                const RTNodeRef child = nodes.child(graph, edge);
+                if (!child) {
                     continue;
                 }
 
-                int limit = childIt->second.countLimit;
+                const int childId = child.id();
+
+                int limit = child.countLimit();
                 if (limit <= 0) {
                     continue;
                 }
@@ -91,20 +96,19 @@ void TraversalDispatcher::applyTreeJump(const TraversalLogic::StepResult& step,
     applyGraphLoopLimit(traversal, traversal.rootId);
 }
 
-static bool isChordMember(const RTNode& node)
+static bool isChordMember(RTNode::NodeType nodeType)
 {
-    return NoteScheduler::isNodeAudible(node.nodeType)
-        && node.nodeType != RTNode::NodeType::RootNode;
+    return NoteScheduler::isNodeAudible(nodeType)
+        && nodeType != RTNode::NodeType::RootNode;
 }
 
-static bool isDanglingTraversalDisabled(const RTNode& node, int traversalId)
+static int danglingDuration(const RTNodeDirectory& nodes, const RTNode& node, int traversalId)
 {
-    auto it = node.disabledTraversalsByChild.find(node.nodeID);
-    return it != node.disabledTraversalsByChild.end() && it->second.count(traversalId) > 0;
+    return nodes.graphOf(node).danglingDuration(node.denseIndex, traversalId);
 }
 
-int TraversalDispatcher::resolveDuration(const RTNode& node, const RTNode* nextTarget,
-                                          int lastTargetId, const NodeMap& nodes, int traversalId)
+int TraversalDispatcher::resolveDuration(const RTNode& node, const RTNode* nextTarget, int nextEdge,
+                                          const TraversalLogic::Walker& walker, const RTNodeDirectory& nodes, int traversalId)
 {
     int duration = 1000;
 
@@ -112,56 +116,72 @@ int TraversalDispatcher::resolveDuration(const RTNode& node, const RTNode* nextT
         duration = static_cast<int>(node.notes[0].duration);
     }
 
-    if (nextTarget != nullptr) {
-
-        std::unordered_map<int, int>::const_iterator it = node.durationMap.end();
+    const RTCompiledGraph& graph = nodes.graphOf(node);
 
-        if (node.isAlternativeNode) {
-            it = node.durationMap.find(node.parentId);
-        }
-        else {
-            if (nextTarget->nodeType != RTNode::NodeType::TraversalFlagData) {
-                it = node.durationMap.find(nextTarget->nodeID);
-            }
-        }
+    int resolved = graph.alternativeDuration(node.denseIndex);
 
+    if (resolved == RTCompiledGraph::noDuration && nextTarget != nullptr) {
+        resolved = graph.edgeDuration(node.denseIndex, nextEdge, nextTarget->nodeID);
+    }
+    else if (resolved == RTCompiledGraph::noDuration) {
+        resolved = graph.danglingDuration(node.denseIndex, traversalId);
 
-        if (it != node.durationMap.end() && it->second > 0) {
-            duration = it->second;
+        if (resolved <= 0) {
+            resolved = nodes.edgeDuration(walker.last, walker.lastEdge, node.nodeID);
         }
     }
-    else if (node.isAlternativeNode) {
-        auto it = node.durationMap.find(node.parentId);
-        if (it != node.durationMap.end() && it->second > 0) {
-            duration = it->second;
-        }
+
+    if (resolved > 0) {
+        duration = resolved;
     }
-    else {
-        auto danglingIt = node.durationMap.find(node.nodeID);
-        if (danglingIt != node.durationMap.end() && danglingIt->second > 0
-            && !isDanglingTraversalDisabled(node, traversalId)) {
-            duration = danglingIt->second;
-        }
-        else {
-            auto parentIt = nodes.find(lastTargetId);
-            if (parentIt != nodes.end()) {
-                auto durIt = parentIt->second.durationMap.find(node.nodeID);
-
-                if (durIt != parentIt->second.durationMap.end() && durIt->second > 0) {
-                    duration = durIt->second;
-                }
+
+    return duration;
+}
+
+void TraversalDispatcher::beginBlock()
+{
+    ++blockIndex;
+    blockTempoMultiplier = engine.tempoMultiplier.load();
+}
+
+const TraversalLogic::BlockParams& TraversalDispatcher::blockParamsFor(TraversalLogic& traversalLogic,
+                                                                       const RTNodeDirectory& nodes) const
+{
+    TraversalLogic::BlockParams& params = traversalLogic.params;
+
+    if (params.block == blockIndex && params.rootId == traversalLogic.rootId) {
+        return params;
+    }
+
+    const RTtraversal* assigned = &traversalLogic.traversal;
+
+    auto rootIt = nodes.find(traversalLogic.rootId);
+    if (rootIt != nodes.end()) {
+        for (const RTtraversal& t : rootIt->second.traversals) {
+            if (t.traversalId == traversalLogic.traversal.traversalId) {
+                assigned = &t;
+                break;
             }
         }
     }
 
-    return duration;
+    const double traversalMultiplier = assigned->tempoMultiplier > 0.0 ? assigned->tempoMultiplier : 1.0;
+
+    params.block              = blockIndex;
+    params.rootId             = traversalLogic.rootId;
+    params.tempoMultiplier    = blockTempoMultiplier * traversalMultiplier;
+    params.channel            = traversalLogic.traversal.channel;
+    params.transpose          = traversalLogic.traversal.transpose;
+    params.velocityMultiplier = traversalLogic.traversal.velocityMultiplier;
+
+    return params;
 }
 
 void TraversalDispatcher::pushNote(const RTNode& node, int instanceId,
                                    const DispatchContext& context, int sample,
                                    bool isPrimaryRepeat)
 {
-    const NodeMap& nodes = context.nodes;
+    const RTNodeDirectory& nodes = context.nodes;
 
     auto traversalIterator = context.traversalMap.find(instanceId);
     jassert(traversalIterator != context.traversalMap.end());
@@ -173,26 +193,14 @@ void TraversalDispatcher::pushNote(const RTNode& node, int instanceId,
 
     dispatchModulator(node, context, traversalLogic, modulatorNode, isPrimaryRepeat);
 
-    const RTNode* nextTarget = traversalLogic.peekNextTarget(nodes);
+    int nextEdge          = -1;
+    int nextModulatorEdge = -1;
 
-    const double sampleRate = processor.tempoInfo.currentSampleRate;
+    const RTNode* nextTarget = traversalLogic.peekNextTarget(nodes, nextEdge);
 
-    double traversalMultiplier = traversalLogic.traversal.tempoMultiplier;
-    auto rootIt = nodes.find(traversalLogic.rootId);
-    if (rootIt != nodes.end()) {
-        for (const RTtraversal& t : rootIt->second.traversals) {
-            if (t.traversalId == traversalLogic.traversal.traversalId) {
-                traversalMultiplier = t.tempoMultiplier;
-                break;
-            }
-        }
-    }
-    if (traversalMultiplier <= 0.0) {
-        traversalMultiplier = 1.0;
-    }
+    const TraversalLogic::BlockParams& params = blockParamsFor(traversalLogic, nodes);
 
-    const double tempoMultiplier = processor.tempoMultiplier.load() * traversalMultiplier;
-    jassert(sampleRate > 0.0);
+    const double tempoMultiplier = params.tempoMultiplier;
     jassert(tempoMultiplier > 0.0);
 
     int duration;
@@ -216,27 +224,27 @@ void TraversalDispatcher::pushNote(const RTNode& node, int instanceId,
     const int activeTraversalId = traversalLogic.traversal.traversalId;
 
     if (alternativeNode != nullptr) {
-        duration = resolveDuration(*alternativeNode, nextTarget, traversalLogic.primary.last, nodes, activeTraversalId);
+        duration = resolveDuration(*alternativeNode, nextTarget, nextEdge, traversalLogic.primary, nodes, activeTraversalId);
     }
     else {
-        duration = resolveDuration(node, nextTarget, traversalLogic.primary.last, nodes, activeTraversalId);
+        duration = resolveDuration(node, nextTarget, nextEdge, traversalLogic.primary, nodes, activeTraversalId);
     }
 
-    int transpose = traversalLogic.traversal.transpose;
+    int transpose = params.transpose;
 
     if (modulatorNode != nullptr && traversalLogic.mod.walker.target != -1) {
-        nextModulatorTarget = traversalLogic.peekModulators(nodes);
-        int modulatorDuration = resolveDuration(*modulatorNode, nextModulatorTarget, traversalLogic.mod.walker.last, nodes, activeTraversalId);
+        nextModulatorTarget = traversalLogic.peekModulators(nodes, nextModulatorEdge);
+        int modulatorDuration = resolveDuration(*modulatorNode, nextModulatorTarget, nextModulatorEdge, traversalLogic.mod.walker, nodes, activeTraversalId);
         duration = static_cast<int>(duration * (0.001 * modulatorDuration));
 
         transpose += modulatorNode->pitchOffset;
     }
 
 
-    scheduler.scheduleNote(node, instanceId, sample, context.midiMessages, sampleRate, tempoMultiplier, duration, false, traversalLogic.traversal.channel, transpose, traversalLogic.traversal.velocityMultiplier, pitchOverride, velocityOverride);
+    scheduler.scheduleNote(node, instanceId, sample, context.midiMessages, tempoMultiplier, duration, false, params.channel, transpose, params.velocityMultiplier, pitchOverride, velocityOverride);
 
     int chordParentCount = traversalLogic.nodeState.get(NodeStateSlot::Count, node.nodeID) + 1;
-    pushChordNotes(node, sample, duration, sampleRate, tempoMultiplier, context, chordParentCount, traversalLogic, transpose);
+    pushChordNotes(node, sample, duration, tempoMultiplier, context, chordParentCount, traversalLogic, transpose);
 
     const int wallClockMs = static_cast<int>(duration / tempoMultiplier);
 
@@ -246,27 +254,25 @@ void TraversalDispatcher::pushNote(const RTNode& node, int instanceId,
 
         if (alternativeNodeParentIterator != nodes.end()) {
             const RTNode* alternativeNodeParent = &alternativeNodeParentIterator->second;
-            dispatchPrimaryArrow(*alternativeNode, alternativeNodeParent, traversalLogic.rootId, wallClockMs, traversalLogic.traversal.traversalId);
+            dispatchPrimaryArrow(*alternativeNode, alternativeNodeParent, nodes, traversalLogic.rootId, wallClockMs, traversalLogic.traversal.traversalId);
         }
     }
 
-    dispatchPrimaryArrow(node, nextTarget, traversalLogic.rootId, wallClockMs, traversalLogic.traversal.traversalId);
+    dispatchPrimaryArrow(node, nextTarget, nodes, traversalLogic.rootId, wallClockMs, traversalLogic.traversal.traversalId);
     dispatchModulatorArrow(modulatorNode, nextModulatorTarget, traversalLogic.mod.gate.activeRootId, traversalLogic.rootId, wallClockMs, traversalLogic.traversal.traversalId);
-    dispatchCrossTree(node, instanceId, sample, traversalLogic.rootId, sampleRate, tempoMultiplier, context, traversalLogic);
+    dispatchCrossTree(node, instanceId, sample, traversalLogic.rootId, tempoMultiplier, context, traversalLogic);
     dispatchFlag(node, instanceId, traversalLogic.traversal.traversalId, chordParentCount, sample,
-                 sampleRate, tempoMultiplier, context);
+                 tempoMultiplier, context);
 }
 
 void TraversalDispatcher::dispatchPrimaryArrow(const RTNode& node, const RTNode* nextTarget,
-                                                int rootId, int wallClockMs, int colourTraversalId)
+                                                const RTNodeDirectory& nodes, int rootId, int wallClockMs, int colourTraversalId)
 {
     if (nextTarget != nullptr) {
         bridge.pushProgress(node.nodeID, nextTarget->nodeID, wallClockMs, rootId, colourTraversalId);
     }
     else {
-        auto danglingIt = node.durationMap.find(node.nodeID);
-        if (danglingIt != node.durationMap.end() && danglingIt->second > 0
-            && !isDanglingTraversalDisabled(node, colourTraversalId)) {
+        if (danglingDuration(nodes, node, colourTraversalId) > 0) {
             bridge.pushProgress(node.nodeID, node.nodeID, wallClockMs, rootId, colourTraversalId);
         }
     }
@@ -290,20 +296,20 @@ void TraversalDispatcher::dispatchModulatorArrow(const RTNode* modulatorNode,
 }
 
 void TraversalDispatcher::dispatchCrossTree(const RTNode& node, int sourceInstanceId, int sample, int rootId,
-                                             double sampleRate, double tempoMultiplier,
+                                             double tempoMultiplier,
                                              const DispatchContext& context, TraversalLogic& traversal)
 {
     if (node.nodeType != RTNode::NodeType::Node && node.nodeType != RTNode::NodeType::RootNode) {
         return;
     }
 
-    const NodeMap& nodes = context.nodes;
+    const RTNodeDirectory& nodes = context.nodes;
 
     traversal.peekCrossTreeNode(nodes, crossTreeScratch);
 
-    for (int crossTreeRootId : crossTreeScratch)
+    for (const TraversalLogic::CrossTreeTarget& crossTreeTarget : crossTreeScratch)
     {
-        auto crossTreeIt = nodes.find(crossTreeRootId);
+        auto crossTreeIt = nodes.find(crossTreeTarget.rootId);
         if (crossTreeIt == nodes.end()) {
             continue;
         }
@@ -316,58 +322,35 @@ void TraversalDispatcher::dispatchCrossTree(const RTNode& node, int sourceInstan
 
         bridge.highlightNode(crossTreeRoot, true, traversal.traversal.traversalId);
 
-        int connectionDuration = 1000;
-        int progressSourceId = node.nodeID;
-
-        auto durIt = node.durationMap.find(crossTreeRootId);
-        if (durIt != node.durationMap.end()) {
-            connectionDuration = durIt->second;
-        }
-        else if (traversal.nodeState.get(NodeStateSlot::ActiveAlternative, node.nodeID) != -1) {
-            auto altIt = nodes.find(traversal.nodeState.get(NodeStateSlot::ActiveAlternative, node.nodeID));
-            if (altIt != nodes.end()) {
-                auto altDurIt = altIt->second.durationMap.find(crossTreeRootId);
-                if (altDurIt != altIt->second.durationMap.end()) {
-                    connectionDuration = altDurIt->second;
-                    progressSourceId = traversal.nodeState.get(NodeStateSlot::ActiveAlternative, node.nodeID);
-                }
-            }
-        }
+        const int connectionDuration = crossTreeTarget.durationMs != RTCompiledGraph::noDuration ? crossTreeTarget.durationMs : 1000;
 
         scheduler.scheduleNote(crossTreeRoot, sourceInstanceId, sample, context.midiMessages,
-                               sampleRate, tempoMultiplier, connectionDuration, true, traversal.traversal.channel, traversal.traversal.transpose, traversal.traversal.velocityMultiplier);
+                               tempoMultiplier, connectionDuration, true, traversal.params.channel, traversal.params.transpose, traversal.params.velocityMultiplier);
 
         const int wallClockMs = static_cast<int>(connectionDuration / tempoMultiplier);
-        bridge.pushProgress(progressSourceId, crossTreeRootId, wallClockMs, rootId, traversal.traversal.traversalId, true);
+        bridge.pushProgress(crossTreeTarget.sourceId, crossTreeTarget.rootId, wallClockMs, rootId, traversal.traversal.traversalId, true);
     }
 }
 
-static int flagStartDelayMs(const RTNode& hostNode, const RTNode& flagNode)
-{
-    auto it = hostNode.durationMap.find(flagNode.nodeID);
-
-    if (it == hostNode.durationMap.end()) {
-        return 0;
-    }
-
-    return it->second;
-}
-
 void TraversalDispatcher::dispatchFlag(const RTNode& node, int hostInstanceId, int hostTypeId,
-                                       int parentCount, int sample, double sampleRate,
+                                       int parentCount, int sample,
                                        double tempoMultiplier, const DispatchContext& context)
 {
-    for (int childId : node.children) {
-        auto childIt = context.nodes.find(childId);
-        if (childIt == context.nodes.end()) {
+    const RTNodeDirectory& nodes = context.nodes;
+    const RTCompiledGraph& graph = nodes.graphOf(node);
+
+    for (int edge = graph.firstEdge(node.denseIndex); edge < graph.edgeEnd(node.denseIndex); ++edge) {
+        const RTNodeRef child = nodes.child(graph, edge);
+        if (!child) {
             continue;
         }
 
-        const RTNode& flagNode = childIt->second;
-        if (flagNode.nodeType != RTNode::NodeType::TraversalFlagData) {
+        if (child.type() != RTNode::NodeType::TraversalFlagData) {
             continue;
         }
 
+        const RTNode& flagNode = child.node();
+
         if (flagNode.countLimit <= 0 || parentCount % flagNode.countLimit != 0) {
             continue;
         }
@@ -377,23 +360,21 @@ void TraversalDispatcher::dispatchFlag(const RTNode& node, int hostInstanceId, i
             continue;
         }
 
-        const int delayMs = flagStartDelayMs(node, flagNode);
+        const int delayMs = graph.edgeDurations[static_cast<std::size_t>(edge)];
 
         if (delayMs <= 0) {
             startFlagTraversal(flagNode, hostTypeId, sample, context);
             continue;
         }
 
-        queueFlagStart(flagNode, hostTypeId, delayMs, sample, sampleRate, tempoMultiplier, context);
+        queueFlagStart(flagNode, hostTypeId, delayMs, sample, tempoMultiplier, context);
     }
 }
 
 void TraversalDispatcher::queueFlagStart(const RTNode& flagNode, int hostTypeId,
-                                         int delayMs, int sample, double sampleRate,
+                                         int delayMs, int sample,
                                          double tempoMultiplier, const DispatchContext& context)
 {
-    const int delaySamples = static_cast<int>((delayMs / 1000.0) * sampleRate / tempoMultiplier);
-
     PendingFlagStart* slot = nullptr;
 
     for (PendingFlagStart& pending : pendingFlagStarts) {
@@ -409,10 +390,25 @@ void TraversalDispatcher::queueFlagStart(const RTNode& flagNode, int hostTypeId,
         return;
     }
 
-    slot->flagNodeId       = flagNode.nodeID;
-    slot->hostTypeId       = hostTypeId;
-    slot->remainingSamples = delaySamples + sample;
-    slot->active           = true;
+    slot->flagNodeId = flagNode.nodeID;
+    slot->hostTypeId = hostTypeId;
+    slot->startTime  = scheduler.positionAfter(sample, delayMs, tempoMultiplier);
+    slot->active     = true;
+}
+
+void TraversalDispatcher::rebasePendingFlags()
+{
+    const TransportClock& clock = scheduler.getClock();
+
+    if (!clock.hasRebased()) {
+        return;
+    }
+
+    for (PendingFlagStart& pending : pendingFlagStarts) {
+        if (pending.active) {
+            pending.startTime = clock.rebase(pending.startTime);
+        }
+    }
 }
 
 void TraversalDispatcher::advancePendingFlags(int numSamples, const DispatchContext& context)
@@ -424,8 +420,7 @@ void TraversalDispatcher::advancePendingFlags(int numSamples, const DispatchCont
             continue;
         }
 
-        if (pending.remainingSamples > numSamples) {
-            pending.remainingSamples -= numSamples;
+        if (scheduler.getClock().sampleOffset(pending.startTime) >= numSamples) {
             continue;
         }
 
@@ -447,7 +442,10 @@ void TraversalDispatcher::advancePendingFlags(int numSamples, const DispatchCont
             continue;
         }
 
-        startFlagTraversal(flagNode, due.hostTypeId, juce::jmax(0, due.remainingSamples), context);
+        const int startOffset = juce::jmax(0, scheduler.getClock().sampleOffset(due.startTime));
+
+        bridge.setEventOffset(startOffset);
+        startFlagTraversal(flagNode, due.hostTypeId, startOffset, context);
     }
 }
 
@@ -499,15 +497,15 @@ void TraversalDispatcher::startFlagTraversal(const RTNode& flagNode, int hostTyp
     const RTNode& startNode = startIt->second;
     const int rootId = startNode.graphID;
 
-    int instanceId = findTraversalInstance(rootId, spawnTypeId, context.traversalMap);
+    const TraversalPool::Handle existing = context.traversalMap.findOnRoot(rootId, spawnTypeId);
 
-    if (instanceId == -1) {
-        instanceId = processor.traversalSession.nextTraversalInstanceId();
-    }
-    else if (context.traversalMap.find(instanceId)->second.logic.shouldTraverse()) {
+    if (existing && context.traversalMap.get(existing)->logic.shouldTraverse()) {
         return;
     }
 
+    const int instanceId = existing ? context.traversalMap.idOf(existing)
+                                    : engine.traversalSession.nextTraversalInstanceId();
+
     TraversalPool::Instance* instance = prepareTraversal(instanceId, rootId, startNode.nodeID,
                                                         flagNode.flagTraversal, context);
 
@@ -523,60 +521,74 @@ void TraversalDispatcher::startFlagTraversal(const RTNode& flagNode, int hostTyp
 }
 
 void TraversalDispatcher::pushChordNotes(const RTNode& node, int sample, int duration,
-                                          double sampleRate, double tempoMultiplier,
+                                          double tempoMultiplier,
                                           const DispatchContext& context, int parentCount,
                                           TraversalLogic& traversalLogic, int transpose)
 {
-    const NodeMap& nodes = context.nodes;
+    const RTNodeDirectory& nodes = context.nodes;
+
+    const RTNodeRef startRef = nodes.ref(node.nodeID);
+    if (!startRef) {
+        return;
+    }
+
+    const bool tracksVisited = startRef.graph->chordListsStale
+                            || startRef.graph->chordClosureIsTree[static_cast<std::size_t>(startRef.index)] == 0;
 
     chordVisited.clear();
     chordFrontier.clear();
 
-    chordFrontier.push_back({ node.nodeID, parentCount });
+    chordFrontier.push_back({ startRef, parentCount });
 
-    while (!chordFrontier.empty())
-    {
-        const auto [chainNodeId, chainCount] = chordFrontier.back();
-        chordFrontier.pop_back();
+    auto visitMember = [&](int memberId, const RTNodeRef& memberRef, int chainCount) {
+        if (tracksVisited && !chordVisited.insert(memberId).second) {
+            return;
+        }
 
-        auto chainIt = nodes.find(chainNodeId);
-        if (chainIt == nodes.end()) {
-            continue;
+        if (!memberRef || !isChordMember(memberRef.type())) {
+            return;
         }
 
-        for (const auto& [childId, connDuration] : chainIt->second.durationMap)
-        {
-            if (connDuration != 0) {
-                continue;
-            }
+        const int countLimit = memberRef.countLimit();
 
-            if (!chordVisited.insert(childId).second) {
-                continue;
-            }
+        if (countLimit <= 0 || chainCount % countLimit != 0) {
+            return;
+        }
 
-            auto childIt = nodes.find(childId);
+        const RTNode& chordNode = memberRef.node();
 
-            if (childIt == nodes.end()) {
-                continue;
-            }
+        scheduler.scheduleNote(chordNode, -1, sample, context.midiMessages,
+                               tempoMultiplier, duration, false, traversalLogic.params.channel, transpose, traversalLogic.params.velocityMultiplier);
 
-            const RTNode& chordNode = childIt->second;
+        bridge.highlightNode(chordNode, true, traversalLogic.traversal.traversalId);
 
-            if (!isChordMember(chordNode)) {
-                continue;
-            }
+        int chordPlayCount = traversalLogic.nodeState.increment(NodeStateSlot::Chord, chordNode.nodeID);
+        chordFrontier.push_back({ memberRef, chordPlayCount });
+    };
 
-            if (chordNode.countLimit <= 0 || chainCount % chordNode.countLimit != 0) {
-                continue;
-            }
+    while (!chordFrontier.empty())
+    {
+        const auto [chainRef, chainCount] = chordFrontier.back();
+        chordFrontier.pop_back();
+
+        const RTCompiledGraph& chainGraph = *chainRef.graph;
 
-            scheduler.scheduleNote(chordNode, -1, sample, context.midiMessages,
-                                   sampleRate, tempoMultiplier, duration, false, traversalLogic.traversal.channel, transpose, traversalLogic.traversal.velocityMultiplier);
+        if (chainGraph.chordListsStale) {
+            for (const auto& [childId, connDuration] : chainRef.node().durationMap)
+            {
+                if (connDuration == 0) {
+                    visitMember(childId, nodes.ref(childId), chainCount);
+                }
+            }
+            continue;
+        }
 
-            bridge.highlightNode(chordNode, true, traversalLogic.traversal.traversalId);
+        for (const auto& member : chainGraph.chordMembersOf(chainRef.index))
+        {
+            const RTNodeRef memberRef = member.nodeIndex != -1 ? RTNodeRef { &chainGraph, member.nodeIndex }
+                                                               : nodes.ref(member.nodeId);
 
-            int chordPlayCount = traversalLogic.nodeState.increment(NodeStateSlot::Chord, chordNode.nodeID);
-            chordFrontier.push_back({ chordNode.nodeID, chordPlayCount });
+            visitMember(member.nodeId, memberRef, chainCount);
         }
     }
 }
@@ -585,7 +597,7 @@ void TraversalDispatcher::dispatchModulator(const RTNode& node, const DispatchCo
                                             TraversalLogic& traversalLogic, const RTNode*& modulatorNode,
                                             bool isPrimaryRepeat)
 {
-    const NodeMap& nodes    = context.nodes;
+    const RTNodeDirectory& nodes    = context.nodes;
     auto&          mod      = traversalLogic.mod;
     const int      colourId = traversalLogic.traversal.traversalId;
 
@@ -603,7 +615,7 @@ void TraversalDispatcher::dispatchModulator(const RTNode& node, const DispatchCo
     }
     else if (mod.isActive()) {
         bool isHost       = (node.nodeID == mod.gate.hostId);
-        bool isDescendant = TraversalLogic::isDescendantOf(nodes, node.nodeID, mod.gate.hostId);
+        bool isDescendant = nodes.isDescendantOf(node.nodeID, mod.gate.hostId);
 
         if (!isHost && !isDescendant) {
             auto targetIt = nodes.find(mod.walker.target);
@@ -655,7 +667,7 @@ void TraversalDispatcher::handleExpiredNote(const NoteScheduler::ActiveNote& exp
                                             int priorityNoteDuration,
                                             const DispatchContext& context)
 {
-    const NodeMap& nodes = context.nodes;
+    const RTNodeDirectory& nodes = context.nodes;
 
     int instanceId = expiredNote.instanceId;
 
@@ -720,6 +732,10 @@ void TraversalDispatcher::handleExpiredNote(const NoteScheduler::ActiveNote& exp
             applyStepResult(step, nodes, traversal.traversal.traversalId);
             applyTreeJump(step, traversal, runtime);
 
+            if (step.kind == TraversalLogic::StepResult::Kind::JumpedToTree) {
+                context.traversalMap.reindex(instanceId);
+            }
+
             if (traversal.shouldTraverse() && nodes.find(traversal.primary.target) != nodes.end()) {
                 pushNote(traversal.getTargetNode(nodes), instanceId, context, priorityNoteDuration);
             }
@@ -747,13 +763,9 @@ void TraversalDispatcher::pushRootNodeConnection(int rootNodeId, const DispatchC
 
 bool TraversalDispatcher::hasActiveTraversalOnTree(int treeRootId, const TraversalPool& traversalMap) const
 {
-    for (const auto& [traversalId, instance] : traversalMap) {
-        if (instance.logic.rootId == treeRootId && instance.logic.shouldTraverse()) {
-            return true;
-        }
-    }
-
-    return false;
+    return traversalMap.anyOnRoot(treeRootId, [](const TraversalPool::Instance& instance) {
+        return instance.logic.shouldTraverse();
+    });
 }
 
 void TraversalDispatcher::startCrossTreeTraversal(const RTNode& targetRootNode, const RTtraversal& traversal,
@@ -765,7 +777,7 @@ void TraversalDispatcher::startCrossTreeTraversal(const RTNode& targetRootNode,
     int instanceId = findTraversalInstance(rootId, traversalId, context.traversalMap);
 
     if (instanceId == -1) {
-        instanceId = processor.traversalSession.nextTraversalInstanceId();
+        instanceId = engine.traversalSession.nextTraversalInstanceId();
     }
 
     TraversalPool::Instance* instance = prepareTraversal(instanceId, rootId, rootId, traversal, context);
@@ -782,18 +794,12 @@ void TraversalDispatcher::startCrossTreeTraversal(const RTNode& targetRootNode,
 
 int TraversalDispatcher::findTraversalInstance(int rootId, int typeId, const TraversalPool& traversalMap) const
 {
-    for (const auto& [instanceId, instance] : traversalMap) {
-        if (instance.logic.rootId == rootId && instance.logic.traversal.traversalId == typeId) {
-            return instanceId;
-        }
-    }
-
-    return -1;
+    return traversalMap.idOf(traversalMap.findOnRoot(rootId, typeId));
 }
 
 void TraversalDispatcher::applyGraphLoopLimit(TraversalLogic& traversalLogic, int rootId)
 {
-    const auto* snapshot = processor.currentSnapshot.load(std::memory_order_relaxed);
+    const auto* snapshot = engine.currentSnapshot.load(std::memory_order_relaxed);
 
     if (snapshot == nullptr || snapshot->rtGraphs == nullptr) {
         return;
@@ -815,6 +821,7 @@ TraversalPool::Instance* TraversalDispatcher::prepareTraversal(int instanceId, i
 
     if (existingIt != context.traversalMap.end()) {
         instance = &existingIt->second;
+        context.traversalMap.markRepurposed();
     } else {
         instance = context.traversalMap.acquire(instanceId, rootId, traversal);
     }
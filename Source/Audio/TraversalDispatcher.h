@@ -8,20 +8,20 @@
 #include <unordered_set>
 
 class AudioUIBridge;
-class SequenceTreeAudioProcessor;
+class SequenceTreeEngine;
 
 struct DispatchContext
 {
-    const NodeMap&    nodes;
-    TraversalPool&     traversalMap;
-    juce::MidiBuffer& midiMessages;
+    const RTNodeDirectory& nodes;
+    TraversalPool&         traversalMap;
+    juce::MidiBuffer&      midiMessages;
 };
 
 class TraversalDispatcher
 {
 public:
 
-    TraversalDispatcher(SequenceTreeAudioProcessor& processor,
+    TraversalDispatcher(SequenceTreeEngine& engine,
                         NoteScheduler& scheduler,
                         AudioUIBridge& bridge);
 
@@ -32,11 +32,15 @@ public:
                            int priorityNoteDuration,
                            const DispatchContext& context);
 
-    void applyStepResult(const TraversalLogic::StepResult& step, const NodeMap& nodes, int traversalId);
+    void applyStepResult(const TraversalLogic::StepResult& step, const RTNodeDirectory& nodes, int traversalId);
 
     void applyTreeJump(const TraversalLogic::StepResult& step, TraversalLogic& traversal,
                        TraversalRuntime& runtime);
 
+    void beginBlock();
+
+    void rebasePendingFlags();
+
     void advancePendingFlags(int numSamples, const DispatchContext& context);
 
     void clearPendingFlags();
@@ -45,35 +49,39 @@ private:
 
     struct PendingFlagStart
     {
-        int  flagNodeId       = -1;
-        int  hostTypeId       = 0;
-        int  remainingSamples = 0;
-        bool active           = false;
+        int          flagNodeId = -1;
+        int          hostTypeId = 0;
+        std::int64_t startTime  = 0;
+        bool         active     = false;
     };
 
+    const TraversalLogic::BlockParams& blockParamsFor(TraversalLogic& traversalLogic,
+                                                      const RTNodeDirectory& nodes) const;
+
     void pushRootNodeConnection(int rootNodeId, const DispatchContext& context, int sample);
 
-    int resolveDuration(const RTNode& node, const RTNode* nextTarget,
-                        int lastTargetId, const NodeMap& nodes, int traversalId);
+    int resolveDuration(const RTNode& node, const RTNode* nextTarget, int nextEdge,
+                        const TraversalLogic::Walker& walker, const RTNodeDirectory& nodes, int traversalId);
 
     void dispatchModulator(const RTNode& node, const DispatchContext& context,
                            TraversalLogic& traversalLogic, const RTNode*& modulatorNode,
                            bool isPrimaryRepeat);
 
     void pushChordNotes(const RTNode& node, int sample, int duration,
-                        double sampleRate, double tempoMultiplier,
+                        double tempoMultiplier,
                         const DispatchContext& context, int parentCount,
                         TraversalLogic& traversalLogic, int transpose);
 
     void dispatchPrimaryArrow(const RTNode& node, const RTNode* nextTarget,
-                              int rootId, int wallClockMs, int colourTraversalId);
+                              const RTNodeDirectory& nodes, int rootId,
+                              int wallClockMs, int colourTraversalId);
 
     void dispatchModulatorArrow(const RTNode* modulatorNode,const RTNode* nextModulatorTarget,
                                 int activeModulatorRootId, int rootId,
                                 int wallClockMs, int colourTraversalId);
 
     void dispatchCrossTree(const RTNode& node, int sourceInstanceId, int sample, int rootId,
-                           double sampleRate, double tempoMultiplier,
+                           double tempoMultiplier,
                            const DispatchContext& context, TraversalLogic& traversal);
 
     bool hasActiveTraversalOnTree(int treeRootId, const TraversalPool& traversalMap) const;
@@ -89,29 +97,32 @@ private:
                                  int sample, const DispatchContext& context);
 
     void dispatchFlag(const RTNode& node, int hostInstanceId, int hostTypeId,
-                      int parentCount, int sample, double sampleRate, double tempoMultiplier,
+                      int parentCount, int sample, double tempoMultiplier,
                       const DispatchContext& context);
 
     void startFlagTraversal(const RTNode& flagNode, int hostTypeId, int sample,
                             const DispatchContext& context);
 
     void queueFlagStart(const RTNode& flagNode, int hostTypeId, int delayMs,
-                        int sample, double sampleRate, double tempoMultiplier,
+                        int sample, double tempoMultiplier,
                         const DispatchContext& context);
 
     void queueFlagRemoval(const RTNode& flagNode, int hostInstanceId, int hostTypeId, TraversalPool& traversalMap);
 
 
-    SequenceTreeAudioProcessor& processor;
-    NoteScheduler&              scheduler;
-    AudioUIBridge&              bridge;
+    SequenceTreeEngine& engine;
+    NoteScheduler&      scheduler;
+    AudioUIBridge&      bridge;
+
+    std::uint64_t blockIndex           = 0;
+    double        blockTempoMultiplier = 1.0;
 
     static constexpr int scratchCapacity     = 256;
     static constexpr int maxPendingFlagStarts = 64;
 
-    std::unordered_set<int>            chordVisited;
-    std::vector<std::pair<int, int>>   chordFrontier;
-    std::vector<int>                   crossTreeScratch;
+    std::unordered_set<int>                chordVisited;
+    std::vector<std::pair<RTNodeRef, int>> chordFrontier;
+    std::vector<TraversalLogic::CrossTreeTarget> crossTreeScratch;
 
     std::array<PendingFlagStart, maxPendingFlagStarts> pendingFlagStarts {};
     std::array<PendingFlagStart, maxPendingFlagStarts> dueFlagStarts {};
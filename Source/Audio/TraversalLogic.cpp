@@ -26,8 +26,9 @@ bool isTreeJumpChild(RTNode::NodeType t) {
 
 static void resetWalker(TraversalLogic::Walker& walker)
 {
-    walker.target = 0;
-    walker.last   = 0;
+    walker.target   = 0;
+    walker.last     = 0;
+    walker.lastEdge = -1;
 
     walker.subRootNode = -1;
 
@@ -42,6 +43,7 @@ void TraversalLogic::reset(int root, const RTtraversal& newTraversal)
     nodeState.clear();
 
     traversal = newTraversal;
+    params    = {};
 
     mod  = {};
     loop = {};
@@ -50,60 +52,65 @@ void TraversalLogic::reset(int root, const RTtraversal& newTraversal)
     rootId              = root;
     referenceTargetId   = 0;
     pendingJumpTargetId = -1;
+    pendingJumpEdge     = -1;
 
     state = TraversalState::Start;
 }
 
-int TraversalLogic::selectNextChild(const NodeMap& nodes, int parentId, int parentCount,
-                                    ChildPredicate isEligible)
+ChildSelection TraversalLogic::selectNextChild(const RTNodeDirectory& nodes, int parentId, int parentCount,
+                                               ChildPredicate isEligible)
 {
     const auto parentIt = nodes.find(parentId);
     if (parentIt == nodes.end()) {
-        return -1;
+        return {};
     }
 
-    const RuleContext context { nodes, parentIt->second, parentCount,
+    const RuleContext context { nodes, nodes.graphOf(parentIt->second), parentIt->second, parentCount,
                                 traversal.traversalId, isEligible, nodeState };
 
-    const int chosen = rule->selectChild(context);
+    const ChildSelection chosen = rule->selectEdge(context);
 
-    nodeState.set(NodeStateSlot::LastNode, parentId, chosen);
+    nodeState.set(NodeStateSlot::LastNode, parentId, chosen.childId);
+    nodeState.set(NodeStateSlot::LastEdge, parentId, chosen.edge);
     return chosen;
 }
 
-int TraversalLogic::selectTreeJumpChild(const NodeMap& nodes, const RTNode& parent, int parentCount) const
+ChildSelection TraversalLogic::selectTreeJumpChild(const RTNodeDirectory& nodes, const RTNode& parent, int parentCount) const
 {
     if (parent.treeJumpChildren.empty()) {
-        return -1;
+        return {};
     }
 
-    const RuleContext context { nodes, parent, parentCount,
+    const RuleContext context { nodes, nodes.graphOf(parent), parent, parentCount,
                                 traversal.traversalId, &isTreeJumpChild, nodeState, true };
 
-    int chosen   = -1;
+    ChildSelection chosen;
+
     int maxLimit = 0;
 
-    for (const int childId : parent.children) {
-        if (parent.treeJumpChildren.count(childId) == 0) {
+    for (int edge = context.firstEdge(); edge < context.edgeEnd(); ++edge) {
+        if (context.graph.edgeIsTreeJump[static_cast<std::size_t>(edge)] == 0) {
             continue;
         }
 
-        const RTNode* child = context.eligibleChild(childId);
+        const RTNodeRef child = context.eligibleChildRef(edge);
 
-        if (child == nullptr) {
+        if (!child) {
             continue;
         }
 
-        if (parentCount % child->countLimit == 0 && child->countLimit > maxLimit) {
-            chosen   = childId;
-            maxLimit = child->countLimit;
+        const int countLimit = child.countLimit();
+
+        if (parentCount % countLimit == 0 && countLimit > maxLimit) {
+            chosen   = { child.id(), edge };
+            maxLimit = countLimit;
         }
     }
 
     return chosen;
 }
 
-void TraversalLogic::registerTrigger(const NodeMap& nodes, int nodeId)
+void TraversalLogic::registerTrigger(const RTNodeDirectory& nodes, int nodeId)
 {
     const auto nodeIterator = nodes.find(nodeId);
 
@@ -118,7 +125,7 @@ void TraversalLogic::registerTrigger(const NodeMap& nodes, int nodeId)
     nodeState.increment(NodeStateSlot::Trigger, nodeId);
 }
 
-bool TraversalLogic::ModulatorWalk::advance(const NodeMap& nodes, TraversalLogic& owner)
+bool TraversalLogic::ModulatorWalk::advance(const RTNodeDirectory& nodes, TraversalLogic& owner)
 {
     if (gate.activeRootId == -1 || walker.target == -1) {
         return false;
@@ -129,18 +136,22 @@ bool TraversalLogic::ModulatorWalk::advance(const NodeMap& nodes, TraversalLogic
         return false;
     }
 
-    walker.last = walker.target;
+    walker.last     = walker.target;
+    walker.lastEdge = -1;
     const int count   = owner.nodeState.increment(NodeStateSlot::ModulatorCount, walker.target);
 
-    const int chosen = owner.selectNextChild(nodes, walker.target, count, &isModulatorChild);
+    const ChildSelection chosen = owner.selectNextChild(nodes, walker.target, count, &isModulatorChild);
+
+    if (chosen.childId == -1) {
+        const RTCompiledGraph& graph       = nodes.graphOf(targetIt->second);
+        const int              targetIndex = targetIt->second.denseIndex;
 
-    if (chosen == -1) {
         bool hasModulatorChild = false;
-        for (const int childId : targetIt->second.children) {
-            const auto childIt = nodes.find(childId);
-            if (childIt != nodes.end()
-                && isModulatorChild(childIt->second.nodeType)
-                && childIt->second.countLimit > 0) {
+        for (int edge = graph.firstEdge(targetIndex); edge < graph.edgeEnd(targetIndex); ++edge) {
+            const RTNodeRef child = nodes.child(graph, edge);
+            if (child
+                && isModulatorChild(child.type())
+                && child.countLimit() > 0) {
                 hasModulatorChild = true;
                 break;
             }
@@ -155,18 +166,19 @@ bool TraversalLogic::ModulatorWalk::advance(const NodeMap& nodes, TraversalLogic
         return true;
     }
 
-    walker.target = chosen;
+    walker.target   = chosen.childId;
+    walker.lastEdge = chosen.edge;
     return false;
 }
 
-int TraversalLogic::advanceModulator(const NodeMap& nodes)
+int TraversalLogic::advanceModulator(const RTNodeDirectory& nodes)
 {
     const int activeRootId = mod.gate.activeRootId;
 
     return mod.advance(nodes, *this) ? activeRootId : -1;
 }
 
-void TraversalLogic::advanceAlternative(const NodeMap& nodes,int parentId) {
+void TraversalLogic::advanceAlternative(const RTNodeDirectory& nodes,int parentId) {
     const auto parentIt = nodes.find(parentId);
     if (parentIt == nodes.end()) {
         primary.alternativeTarget = -1;
@@ -213,7 +225,7 @@ void TraversalLogic::advanceAlternative(const NodeMap& nodes,int parentId) {
         count = nodeState.increment(NodeStateSlot::Count, currentAltId);
     }
 
-    const int chosen = selectNextChild(nodes,currentAltId, count, &isAlternativeChild);
+    const int chosen = selectNextChild(nodes,currentAltId, count, &isAlternativeChild).childId;
 
     if (chosen == -1) {
         nodeState.set(NodeStateSlot::ActiveAlternative, parentId, parentId);
@@ -224,7 +236,7 @@ void TraversalLogic::advanceAlternative(const NodeMap& nodes,int parentId) {
     }
 }
 
-void TraversalLogic::selectSwitchNode(const NodeMap& nodes,int targetId, int& chosenNodeId) {
+void TraversalLogic::selectSwitchNode(const RTNodeDirectory& nodes,int targetId, ChildSelection& chosen) {
     if (nodeState.get(NodeStateSlot::LastNode, targetId) != -1) {
 
         const int switchCount = nodeState.increment(NodeStateSlot::SwitchCount, targetId);
@@ -236,7 +248,7 @@ void TraversalLogic::selectSwitchNode(const NodeMap& nodes,int targetId, int& ch
             const int switchCountLimit = switchNode.switchCountLimit;
 
             if (switchCount < switchCountLimit && switchCountLimit > 1) {
-                chosenNodeId = switchNode.nodeID;
+                chosen = { switchNode.nodeID, nodeState.get(NodeStateSlot::LastEdge, targetId) };
             }
             else {
                 nodeState.set(NodeStateSlot::SwitchCount, targetId, 0);
@@ -245,13 +257,14 @@ void TraversalLogic::selectSwitchNode(const NodeMap& nodes,int targetId, int& ch
     }
 }
 
-void TraversalLogic::advance(const NodeMap& nodes)
+void TraversalLogic::advance(const RTNodeDirectory& nodes)
 {
-    const int targetId            = primary.target;
-    int chosenNodeId        = -1;
+    const int targetId = primary.target;
+    ChildSelection chosen;
 
     referenceTargetId       = primary.last;
     primary.last            = targetId;
+    primary.lastEdge        = -1;
     primary.alternativeLast = primary.alternativeTarget;
 
     const auto targetIterator = nodes.find(targetId);
@@ -261,37 +274,40 @@ void TraversalLogic::advance(const NodeMap& nodes)
         return;
     }
 
-    selectSwitchNode(nodes, targetId, chosenNodeId);
+    selectSwitchNode(nodes, targetId, chosen);
 
-    if (chosenNodeId == -1) {
+    if (chosen.childId == -1) {
         const int count = nodeState.increment(NodeStateSlot::Count, targetId);
 
-        const int jumpTargetId = selectTreeJumpChild(nodes, targetIterator->second, count);
+        const ChildSelection jumpTarget = selectTreeJumpChild(nodes, targetIterator->second, count);
 
-        if (jumpTargetId != -1) {
-            pendingJumpTargetId = jumpTargetId;
+        if (jumpTarget.childId != -1) {
+            pendingJumpTargetId = jumpTarget.childId;
+            pendingJumpEdge     = jumpTarget.edge;
             state               = TraversalState::Jump;
             return;
         }
 
-        chosenNodeId = selectNextChild(nodes,targetId, count, &isAdvanceableChild);
+        chosen = selectNextChild(nodes,targetId, count, &isAdvanceableChild);
 
-        if (chosenNodeId != -1) {
-            registerTrigger(nodes, chosenNodeId);
+        if (chosen.childId != -1) {
+            registerTrigger(nodes, chosen.childId);
         }
     }
 
-    if (chosenNodeId  != -1) {
-        const auto nextTargetIt = nodes.find(chosenNodeId);
+    if (chosen.childId != -1) {
+        const auto nextTargetIt = nodes.find(chosen.childId);
 
-        nodeState.set(NodeStateSlot::LastNode, chosenNodeId, chosenNodeId);
+        nodeState.set(NodeStateSlot::LastNode, chosen.childId, chosen.childId);
+        nodeState.set(NodeStateSlot::LastEdge, chosen.childId, -1);
 
         if (nextTargetIt == nodes.end()) {
             primary.alternativeTarget = -1;
         }
         else {
-            primary.target = chosenNodeId;
-            advanceAlternative(nodes,chosenNodeId);
+            primary.target   = chosen.childId;
+            primary.lastEdge = chosen.edge;
+            advanceAlternative(nodes,chosen.childId);
 
             const int nextSubLoopCountLimit = nextTargetIt->second.subLoopCountLimit;
             const bool subLoopsForever      = (nextSubLoopCountLimit == 0);
@@ -309,42 +325,46 @@ void TraversalLogic::advance(const NodeMap& nodes)
     }
 }
 
-const RTNode* TraversalLogic::peekNextTarget(const NodeMap& nodes)
+const RTNode* TraversalLogic::peekNextTarget(const RTNodeDirectory& nodes, int& edge)
 {
+    edge = -1;
+
     const int count = nodeState.get(NodeStateSlot::Count, primary.target) + 1;
 
     const auto targetIt = nodes.find(primary.target);
 
     if (targetIt != nodes.end()) {
-        const int jumpTargetId = selectTreeJumpChild(nodes, targetIt->second, count);
+        const ChildSelection jumpTarget = selectTreeJumpChild(nodes, targetIt->second, count);
 
-        if (jumpTargetId != -1) {
-            const auto jumpTargetIt = nodes.find(jumpTargetId);
+        if (jumpTarget.childId != -1) {
+            const auto jumpTargetIt = nodes.find(jumpTarget.childId);
 
             if (jumpTargetIt != nodes.end()) {
+                edge = jumpTarget.edge;
                 return &jumpTargetIt->second;
             }
         }
     }
 
-    const int peekTargetId = selectNextChild(nodes,primary.target, count, &isAudibleChild);
+    const ChildSelection peekTarget = selectNextChild(nodes,primary.target, count, &isAudibleChild);
 
-    if (peekTargetId == -1 || peekTargetId == primary.target) {
+    if (peekTarget.childId == -1 || peekTarget.childId == primary.target) {
         return nullptr;
     }
 
-    const auto itPeek = nodes.find(peekTargetId);
+    const auto itPeek = nodes.find(peekTarget.childId);
 
     if (itPeek != nodes.end()) {
+        edge = peekTarget.edge;
         return &itPeek->second;
     }
 
     return nullptr;
 }
 
-void TraversalLogic::peekCrossTreeNode(const NodeMap& nodes, std::vector<int>& traverserIds)
+void TraversalLogic::peekCrossTreeNode(const RTNodeDirectory& nodes, std::vector<CrossTreeTarget>& targets)
 {
-    traverserIds.clear();
+    targets.clear();
 
     auto scanHost = [&](int hostId) {
         const auto hostIterator = nodes.find(hostId);
@@ -352,22 +372,27 @@ void TraversalLogic::peekCrossTreeNode(const NodeMap& nodes, std::vector<int>& t
             return;
         }
 
-        for (const int childId : hostIterator->second.children) {
-            if (hostIterator->second.treeJumpChildren.count(childId) > 0) {
+        const RTCompiledGraph& graph     = nodes.graphOf(hostIterator->second);
+        const int              hostIndex = hostIterator->second.denseIndex;
+
+        for (int edge = graph.firstEdge(hostIndex); edge < graph.edgeEnd(hostIndex); ++edge) {
+            if (graph.edgeIsTreeJump[static_cast<std::size_t>(edge)] != 0) {
                 continue;
             }
 
-            const auto childIterator = nodes.find(childId);
-            if (childIterator == nodes.end()) {
+            const RTNodeRef child = nodes.child(graph, edge);
+            if (!child) {
                 continue;
             }
 
-            const RTNode& childNode = childIterator->second;
-
-            if (childNode.nodeType != RTNode::NodeType::RootNode) {
+            if (child.type() != RTNode::NodeType::RootNode) {
                 continue;
             }
-            if (childNode.nodeID == rootId) {
+
+            const RTNode& childNode = child.node();
+            const int     childId   = childNode.nodeID;
+
+            if (childId == rootId) {
                 continue;
             }
             if (childNode.countLimit <= 0) {
@@ -377,8 +402,10 @@ void TraversalLogic::peekCrossTreeNode(const NodeMap& nodes, std::vector<int>& t
             int& count       = nodeState.ref(NodeStateSlot::CrossTree, childId);
             int& switchCount = nodeState.ref(NodeStateSlot::CrossTreeSwitch, childId);
 
+            const CrossTreeTarget target { childId, hostId, graph.edgeDurations[static_cast<std::size_t>(edge)] };
+
             if (switchCount > 0) {
-                traverserIds.push_back(childId);
+                targets.push_back(target);
                 switchCount++;
                 if (switchCount >= childNode.switchCountLimit) {
                     switchCount = 0;
@@ -388,7 +415,7 @@ void TraversalLogic::peekCrossTreeNode(const NodeMap& nodes, std::vector<int>& t
             else {
                 count++;
                 if (count >= childNode.countLimit) {
-                    traverserIds.push_back(childId);
+                    targets.push_back(target);
                     if (childNode.switchCountLimit > 1) {
                         switchCount = 1;
                     }
@@ -406,30 +433,37 @@ void TraversalLogic::peekCrossTreeNode(const NodeMap& nodes, std::vector<int>& t
     }
 }
 
-const RTNode* TraversalLogic::ModulatorWalk::peek(const NodeMap& nodes, TraversalLogic& owner) const
+const RTNode* TraversalLogic::ModulatorWalk::peek(const RTNodeDirectory& nodes, TraversalLogic& owner, int& edge) const
 {
+    edge = -1;
+
     if (walker.target == -1) {
         return nullptr;
     }
 
     const int count = owner.nodeState.get(NodeStateSlot::ModulatorCount, walker.target) + 1;
 
-    const int peekId = owner.selectNextChild(nodes, walker.target, count, &isModulatorChild);
-    if (peekId == -1) {
+    const ChildSelection peeked = owner.selectNextChild(nodes, walker.target, count, &isModulatorChild);
+    if (peeked.childId == -1) {
         return nullptr;
     }
 
-    const auto peekIt = nodes.find(peekId);
-    return (peekIt != nodes.end()) ? &peekIt->second : nullptr;
+    const auto peekIt = nodes.find(peeked.childId);
+    if (peekIt == nodes.end()) {
+        return nullptr;
+    }
+
+    edge = peeked.edge;
+    return &peekIt->second;
 }
 
-const RTNode* TraversalLogic::peekModulators(const NodeMap& nodes)
+const RTNode* TraversalLogic::peekModulators(const RTNodeDirectory& nodes, int& edge)
 {
-    return mod.peek(nodes, *this);
+    return mod.peek(nodes, *this, edge);
 }
 
-const RTNode& TraversalLogic::getTargetNode(const NodeMap& nodes) const { return nodes.at(primary.target); }
-const RTNode& TraversalLogic::getRootNode  (const NodeMap& nodes) const { return nodes.at(rootId);         }
+const RTNode& TraversalLogic::getTargetNode(const RTNodeDirectory& nodes) const { return nodes.at(primary.target); }
+const RTNode& TraversalLogic::getRootNode  (const RTNodeDirectory& nodes) const { return nodes.at(rootId);         }
 
 bool TraversalLogic::shouldTraverse() const
 {
@@ -444,10 +478,11 @@ void TraversalLogic::fillEndedResult(StepResult& result) const
     result.referenceOffId    = referenceTargetId;
 }
 
-TraversalLogic::StepResult TraversalLogic::enterRoot(const NodeMap& nodes)
+TraversalLogic::StepResult TraversalLogic::enterRoot(const RTNodeDirectory& nodes)
 {
-    state          = TraversalState::Active;
-    primary.target = rootId;
+    state            = TraversalState::Active;
+    primary.target   = rootId;
+    primary.lastEdge = -1;
     advanceAlternative(nodes, rootId);
 
     StepResult result;
@@ -457,7 +492,7 @@ TraversalLogic::StepResult TraversalLogic::enterRoot(const NodeMap& nodes)
     return result;
 }
 
-void TraversalLogic::advanceSubRoot(const NodeMap& nodes, StepResult& result)
+void TraversalLogic::advanceSubRoot(const RTNodeDirectory& nodes, StepResult& result)
 {
     const auto subRootIt   = nodes.find(primary.subRootNode);
     const int  subRootLimit = (subRootIt != nodes.end()) ? subRootIt->second.subLoopCountLimit : 0;
@@ -473,11 +508,12 @@ void TraversalLogic::advanceSubRoot(const NodeMap& nodes, StepResult& result)
     else {
         result.rootForReset = primary.subRootNode;
         primary.target      = primary.subRootNode;
+        primary.lastEdge    = -1;
         result.enteredId    = primary.subRootNode;
     }
 }
 
-void TraversalLogic::handleLoopReset(const NodeMap& nodes, StepResult& result)
+void TraversalLogic::handleLoopReset(const RTNodeDirectory& nodes, StepResult& result)
 {
     loop.count++;
 
@@ -493,7 +529,8 @@ void TraversalLogic::handleLoopReset(const NodeMap& nodes, StepResult& result)
     result.leftId            = primary.target;
     result.leftAlternativeId = primary.alternativeTarget;
 
-    primary.target = rootId;
+    primary.target   = rootId;
+    primary.lastEdge = -1;
     advanceAlternative(nodes, rootId);
 
     result.enteredId            = rootId;
@@ -509,10 +546,12 @@ void TraversalLogic::handleLoopReset(const NodeMap& nodes, StepResult& result)
     state = TraversalState::Active;
 }
 
-void TraversalLogic::handleTreeJump(const NodeMap& nodes, StepResult& result)
+void TraversalLogic::handleTreeJump(const RTNodeDirectory& nodes, StepResult& result)
 {
     const int jumpTargetId = pendingJumpTargetId;
+    const int jumpEdge     = pendingJumpEdge;
     pendingJumpTargetId = -1;
+    pendingJumpEdge     = -1;
 
     state = TraversalState::Active;
 
@@ -530,6 +569,7 @@ void TraversalLogic::handleTreeJump(const NodeMap& nodes, StepResult& result)
     rootId = jumpTargetIt->second.nodeID;
 
     primary.target            = rootId;
+    primary.lastEdge          = jumpEdge;
     primary.subRootNode       = -1;
     primary.alternativeTarget = -1;
     primary.alternativeLast   = -1;
@@ -545,7 +585,7 @@ void TraversalLogic::handleTreeJump(const NodeMap& nodes, StepResult& result)
     loop.limit  = 0;
 }
 
-TraversalLogic::StepResult TraversalLogic::stepActive(const NodeMap& nodes)
+TraversalLogic::StepResult TraversalLogic::stepActive(const RTNodeDirectory& nodes)
 {
     advance(nodes);
 
@@ -586,7 +626,7 @@ TraversalLogic::StepResult TraversalLogic::stepActive(const NodeMap& nodes)
     return result;
 }
 
-TraversalLogic::StepResult TraversalLogic::handleNodeEvent(const NodeMap& nodes) {
+TraversalLogic::StepResult TraversalLogic::handleNodeEvent(const RTNodeDirectory& nodes) {
     switch (state) {
         case TraversalState::Start:
             return enterRoot(nodes);
@@ -605,56 +645,31 @@ TraversalLogic::StepResult TraversalLogic::handleNodeEvent(const NodeMap& nodes)
     }
 }
 
-const RTNode* TraversalLogic::getModulatorNode(const NodeMap& nodes, int nodeId) const
+const RTNode* TraversalLogic::getModulatorNode(const RTNodeDirectory& nodes, int nodeId) const
 {
     const auto nodeIterator = nodes.find(nodeId);
     if (nodeIterator == nodes.end()) {
         return nullptr;
     }
 
-    for (const int childId : nodeIterator->second.children) {
-        const auto childIt = nodes.find(childId);
-        if (childIt == nodes.end()) {
+    const RTCompiledGraph& graph     = nodes.graphOf(nodeIterator->second);
+    const int              nodeIndex = nodeIterator->second.denseIndex;
+
+    for (int edge = graph.firstEdge(nodeIndex); edge < graph.edgeEnd(nodeIndex); ++edge) {
+        const RTNodeRef child = nodes.child(graph, edge);
+        if (!child) {
             continue;
         }
 
-        const RTNode* childNode = &childIt->second;
-
-        if (childNode->nodeType == RTNode::NodeType::ModulatorRoot) {
-            return childNode;
+        if (child.type() == RTNode::NodeType::ModulatorRoot) {
+            return &child.node();
         }
     }
 
     return nullptr;
 }
 
-bool TraversalLogic::isDescendantOf(const NodeMap& nodes, int nodeId, int ancestorId)
-{
-    if (ancestorId == -1 || nodeId == ancestorId) {
-        return false;
-    }
-
-    int current = nodeId;
-    int guard   = 0;
-
-    while (current != 0 && guard++ < 10000) {
-        const auto it = nodes.find(current);
-        if (it == nodes.end()) {
-            return false;
-        }
-
-        const int parent = it->second.parentId;
-        if (parent == ancestorId) {
-            return true;
-        }
-
-        current = parent;
-    }
-
-    return false;
-}
-
-int TraversalLogic::findActiveModulatorRoot(const NodeMap& nodes, int regularNodeId) const
+int TraversalLogic::findActiveModulatorRoot(const RTNodeDirectory& nodes, int regularNodeId) const
 {
     if (nodes.find(regularNodeId) == nodes.end()) {
         return -1;
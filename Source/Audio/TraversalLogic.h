@@ -2,6 +2,7 @@
 
 #include "../Graph/RTData.h"
 #include "TraversalRule.h"
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 
@@ -12,8 +13,9 @@ public:
 
     struct Walker
     {
-        int target = 0;
-        int last   = 0;
+        int target   = 0;
+        int last     = 0;
+        int lastEdge = -1;
 
         int subRootNode = -1;
 
@@ -49,13 +51,15 @@ public:
             gate.repeatCount  = 0;
             walker.target     = rootId;
             walker.last       = -1;
+            walker.lastEdge   = -1;
         }
 
         void deactivate()
         {
-            gate          = {};
-            walker.target = -1;
-            walker.last   = -1;
+            gate            = {};
+            walker.target   = -1;
+            walker.last     = -1;
+            walker.lastEdge = -1;
         }
 
         bool tickRepeat(int repeatLimit)
@@ -68,8 +72,26 @@ public:
             return false;
         }
 
-        bool          advance(const NodeMap& nodes, TraversalLogic& owner);
-        const RTNode* peek   (const NodeMap& nodes, TraversalLogic& owner) const;
+        bool          advance(const RTNodeDirectory& nodes, TraversalLogic& owner);
+        const RTNode* peek   (const RTNodeDirectory& nodes, TraversalLogic& owner, int& edge) const;
+    };
+
+    struct BlockParams
+    {
+        std::uint64_t block  = 0;
+        int           rootId = -1;
+
+        double tempoMultiplier    = 1.0;
+        int    channel            = 1;
+        int    transpose          = 0;
+        double velocityMultiplier = 1.0;
+    };
+
+    struct CrossTreeTarget
+    {
+        int rootId     = -1;
+        int sourceId   = -1;
+        int durationMs = RTCompiledGraph::noDuration;
     };
 
     enum class TraversalState { Start, Active, End, Reset, Jump };
@@ -99,6 +121,7 @@ public:
     using ChildPredicate = ::ChildPredicate;
 
     RTtraversal    traversal;
+    BlockParams    params;
     NodeStateTable nodeState;
 
     Walker         primary;
@@ -116,44 +139,44 @@ public:
 
     void reset(int root, const RTtraversal& newTraversal);
 
-    StepResult handleNodeEvent(const NodeMap& nodes);
+    StepResult handleNodeEvent(const RTNodeDirectory& nodes);
 
-    void advanceAlternative(const NodeMap& nodes, int parentId);
+    void advanceAlternative(const RTNodeDirectory& nodes, int parentId);
 
-    void advance(const NodeMap& nodes);
+    void advance(const RTNodeDirectory& nodes);
 
-    int advanceModulator(const NodeMap& nodes);
+    int advanceModulator(const RTNodeDirectory& nodes);
 
-    const RTNode* peekNextTarget(const NodeMap& nodes);
+    const RTNode* peekNextTarget(const RTNodeDirectory& nodes, int& edge);
 
-    void peekCrossTreeNode(const NodeMap& nodes, std::vector<int>& traverserIds);
-    const RTNode* peekModulators(const NodeMap& nodes);
+    void peekCrossTreeNode(const RTNodeDirectory& nodes, std::vector<CrossTreeTarget>& targets);
+    const RTNode* peekModulators(const RTNodeDirectory& nodes, int& edge);
 
-    const RTNode& getTargetNode(const NodeMap& nodes) const;
-    const RTNode& getRootNode  (const NodeMap& nodes) const;
+    const RTNode& getTargetNode(const RTNodeDirectory& nodes) const;
+    const RTNode& getRootNode  (const RTNodeDirectory& nodes) const;
 
-    int findActiveModulatorRoot(const NodeMap& nodes, int regularNodeId) const;
-
-    static bool isDescendantOf(const NodeMap& nodes, int nodeId, int ancestorId);
+    int findActiveModulatorRoot(const RTNodeDirectory& nodes, int regularNodeId) const;
 
     bool shouldTraverse() const;
 
 private:
 
-    int  selectNextChild(const NodeMap& nodes, int parentId, int parentCount, ChildPredicate isEligible);
-    int  selectTreeJumpChild(const NodeMap& nodes, const RTNode& parent, int parentCount) const;
-    void selectSwitchNode(const NodeMap& nodes, int targetId, int& chosenNodeId);
-    void registerTrigger(const NodeMap& nodes, int nodeId);
+    ChildSelection selectNextChild(const RTNodeDirectory& nodes, int parentId, int parentCount, ChildPredicate isEligible);
+    ChildSelection selectTreeJumpChild(const RTNodeDirectory& nodes, const RTNode& parent, int parentCount) const;
+
+    void selectSwitchNode(const RTNodeDirectory& nodes, int targetId, ChildSelection& chosen);
+    void registerTrigger(const RTNodeDirectory& nodes, int nodeId);
 
-    const RTNode* getModulatorNode(const NodeMap& nodes, int nodeId) const;
+    const RTNode* getModulatorNode(const RTNodeDirectory& nodes, int nodeId) const;
 
-    StepResult enterRoot(const NodeMap& nodes);
-    StepResult stepActive(const NodeMap& nodes);
-    void       handleLoopReset(const NodeMap& nodes, StepResult& result);
-    void       handleTreeJump(const NodeMap& nodes, StepResult& result);
-    void       advanceSubRoot(const NodeMap& nodes, StepResult& result);
+    StepResult enterRoot(const RTNodeDirectory& nodes);
+    StepResult stepActive(const RTNodeDirectory& nodes);
+    void       handleLoopReset(const RTNodeDirectory& nodes, StepResult& result);
+    void       handleTreeJump(const RTNodeDirectory& nodes, StepResult& result);
+    void       advanceSubRoot(const RTNodeDirectory& nodes, StepResult& result);
     void       fillEndedResult(StepResult& result) const;
 
     int referenceTargetId   = 0;
     int pendingJumpTargetId = -1;
+    int pendingJumpEdge     = -1;
 };
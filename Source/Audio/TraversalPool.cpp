@@ -0,0 +1,288 @@
+#include "TraversalPool.h"
+
+void TraversalPool::prepare(int capacity, const TraversalRule& rule,
+                            std::span<const TraversalRule* const> rules, int nodeCapacity)
+{
+    defaultRule = &rule;
+    ruleTable   = rules;
+
+    if (static_cast<int>(slots.size()) != capacity) {
+        slots.assign(static_cast<std::size_t>(capacity), Slot{});
+        active.reserve(static_cast<std::size_t>(capacity));
+
+        instanceSlots.prepare(capacity);
+        rootHeads    .prepare(capacity);
+        typeHeads    .prepare(capacity);
+
+        clear();
+    }
+
+    for (auto& slot : slots) {
+        slot.entry.second.logic.nodeState.prepare(nodeCapacity);
+        slot.entry.second.logic.nodeState.bind(boundDirectory);
+        slot.entry.second.logic.rule = ruleFor(slot.entry.second.logic.traversal.ruleIndex);
+    }
+
+    nodeStateCapacity = nodeCapacity;
+}
+
+const TraversalRule* TraversalPool::ruleFor(int ruleIndex) const
+{
+    if (ruleIndex < 0 || ruleIndex >= static_cast<int>(ruleTable.size()) || ruleTable[static_cast<std::size_t>(ruleIndex)] == nullptr) {
+        return defaultRule;
+    }
+
+    return ruleTable[static_cast<std::size_t>(ruleIndex)];
+}
+
+void TraversalPool::adoptNodeStates(NodeStateReserve& reserve)
+{
+    if (reserve.capacity <= nodeStateCapacity || reserve.storages.size() < slots.size()) {
+        return;
+    }
+
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+        slots[i].entry.second.logic.nodeState.adopt(reserve.storages[i]);
+    }
+
+    nodeStateCapacity = reserve.capacity;
+}
+
+void TraversalPool::bindNodeDirectory(const RTNodeDirectory* directory)
+{
+    if (directory == boundDirectory) {
+        return;
+    }
+
+    for (auto& slot : slots) {
+        slot.entry.second.logic.nodeState.bind(directory);
+    }
+
+    boundDirectory = directory;
+}
+
+std::uint64_t TraversalPool::nodeStateOverflowCount() const
+{
+    std::uint64_t overflows = 0;
+
+    for (const auto& slot : slots) {
+        overflows += slot.entry.second.logic.nodeState.overflowCount();
+    }
+
+    return overflows;
+}
+
+TraversalPool::Instance* TraversalPool::get(Handle handle)
+{
+    return const_cast<Instance*>(std::as_const(*this).get(handle));
+}
+
+const TraversalPool::Instance* TraversalPool::get(Handle handle) const
+{
+    if (handle.slot < 0 || handle.slot >= static_cast<int>(slots.size())) {
+        return nullptr;
+    }
+
+    const Slot& slot = slotAt(handle.slot);
+
+    if (slot.generation != handle.generation || slot.denseIndex == noSlot) {
+        return nullptr;
+    }
+
+    return &slot.entry.second;
+}
+
+TraversalPool::Handle TraversalPool::handleOf(int id) const
+{
+    const int slot = instanceSlots.find(id);
+
+    if (slot == noSlot) {
+        return {};
+    }
+
+    return { slot, slotAt(slot).generation };
+}
+
+int TraversalPool::idOf(Handle handle) const
+{
+    return get(handle) != nullptr ? slotAt(handle.slot).entry.first : -1;
+}
+
+TraversalPool::Handle TraversalPool::findOnRoot(int rootId, int typeId) const
+{
+    int first = noSlot;
+
+    for (int slot = typeHeads.find(typeKey(rootId, typeId)); slot != noSlot; slot = slotAt(slot).typeLink.next) {
+        if (first == noSlot || slotAt(slot).denseIndex < slotAt(first).denseIndex) {
+            first = slot;
+        }
+    }
+
+    if (first == noSlot) {
+        return {};
+    }
+
+    return { first, slotAt(first).generation };
+}
+
+TraversalPool::Instance* TraversalPool::acquire(int id, int rootId, const RTtraversal& traversal)
+{
+    if (firstFree == noSlot) {
+        return nullptr;
+    }
+
+    const int slotIndex = firstFree;
+    Slot&     slot      = slotAt(slotIndex);
+
+    firstFree     = slot.nextFree;
+    slot.nextFree = noSlot;
+
+    slot.entry.first = id;
+    slot.entry.second.logic.reset(rootId, traversal);
+    slot.entry.second.logic.rule = ruleFor(traversal.ruleIndex);
+    slot.entry.second.runtime = {};
+
+    slot.denseIndex = size();
+    active.push_back(slotIndex);
+
+    instanceSlots.assign(id, slotIndex);
+    linkIndexes(slotIndex);
+
+    ++version;
+
+    return &slot.entry.second;
+}
+
+TraversalPool::iterator TraversalPool::erase(iterator it)
+{
+    const int denseIndex = it.denseIndex();
+
+    release(active[static_cast<std::size_t>(denseIndex)]);
+
+    return iterator(this, denseIndex);
+}
+
+void TraversalPool::reindex(int id)
+{
+    const int slotIndex = instanceSlots.find(id);
+
+    if (slotIndex == noSlot) {
+        return;
+    }
+
+    const Slot&           slot  = slotAt(slotIndex);
+    const TraversalLogic& logic = slot.entry.second.logic;
+
+    if (slot.indexedRootId == logic.rootId && slot.indexedTypeId == logic.traversal.traversalId) {
+        return;
+    }
+
+    unlinkIndexes(slotIndex);
+    linkIndexes(slotIndex);
+
+    ++version;
+}
+
+void TraversalPool::clear()
+{
+    for (const int slotIndex : active) {
+        Slot& slot = slotAt(slotIndex);
+
+        slot.denseIndex = noSlot;
+        slot.rootLink   = {};
+        slot.typeLink   = {};
+        ++slot.generation;
+    }
+
+    active.clear();
+    ++version;
+
+    instanceSlots.clear();
+    rootHeads    .clear();
+    typeHeads    .clear();
+
+    firstFree = noSlot;
+
+    for (int slotIndex = static_cast<int>(slots.size()) - 1; slotIndex >= 0; --slotIndex) {
+        slotAt(slotIndex).nextFree = firstFree;
+        firstFree                  = slotIndex;
+    }
+}
+
+template <typename Key>
+void TraversalPool::link(SlotIndexMap<Key>& heads, Link Slot::* member, Key key, int slot)
+{
+    const int head = heads.find(key);
+
+    (slotAt(slot).*member) = { noSlot, head };
+
+    if (head != noSlot) {
+        (slotAt(head).*member).previous = slot;
+    }
+
+    heads.assign(key, slot);
+}
+
+template <typename Key>
+void TraversalPool::unlink(SlotIndexMap<Key>& heads, Link Slot::* member, Key key, int slot)
+{
+    const Link links = slotAt(slot).*member;
+
+    if (links.previous != noSlot) {
+        (slotAt(links.previous).*member).next = links.next;
+    }
+    else if (links.next != noSlot) {
+        heads.assign(key, links.next);
+    }
+    else {
+        heads.erase(key);
+    }
+
+    if (links.next != noSlot) {
+        (slotAt(links.next).*member).previous = links.previous;
+    }
+
+    (slotAt(slot).*member) = {};
+}
+
+void TraversalPool::linkIndexes(int slotIndex)
+{
+    Slot&                 slot  = slotAt(slotIndex);
+    const TraversalLogic& logic = slot.entry.second.logic;
+
+    slot.indexedRootId = logic.rootId;
+    slot.indexedTypeId = logic.traversal.traversalId;
+
+    link(rootHeads, &Slot::rootLink, slot.indexedRootId, slotIndex);
+    link(typeHeads, &Slot::typeLink, typeKey(slot.indexedRootId, slot.indexedTypeId), slotIndex);
+}
+
+void TraversalPool::unlinkIndexes(int slotIndex)
+{
+    const Slot& slot = slotAt(slotIndex);
+
+    unlink(rootHeads, &Slot::rootLink, slot.indexedRootId, slotIndex);
+    unlink(typeHeads, &Slot::typeLink, typeKey(slot.indexedRootId, slot.indexedTypeId), slotIndex);
+}
+
+void TraversalPool::release(int slotIndex)
+{
+    Slot& slot = slotAt(slotIndex);
+
+    unlinkIndexes(slotIndex);
+    instanceSlots.erase(slot.entry.first);
+
+    const int lastSlot = active.back();
+
+    active[static_cast<std::size_t>(slot.denseIndex)] = lastSlot;
+    slotAt(lastSlot).denseIndex                       = slot.denseIndex;
+    active.pop_back();
+
+    slot.denseIndex = noSlot;
+    ++slot.generation;
+
+    slot.nextFree = firstFree;
+    firstFree     = slotIndex;
+
+    ++version;
+}
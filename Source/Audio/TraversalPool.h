@@ -3,7 +3,9 @@
 #include "TraversalLogic.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <span>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -22,6 +24,105 @@ struct TraversalRuntime
     bool isSpawned() const { return asFlag || asCrossTree; }
 };
 
+template <typename Key>
+class SlotIndexMap
+{
+public:
+
+    static constexpr int noSlot = -1;
+
+    void prepare(int slotCapacity)
+    {
+        std::size_t capacity = 2;
+
+        while (capacity < static_cast<std::size_t>(slotCapacity) * 2) {
+            capacity *= 2;
+        }
+
+        cells.assign(capacity, Cell{});
+    }
+
+    void clear()
+    {
+        for (auto& cell : cells) {
+            cell.slot = noSlot;
+        }
+    }
+
+    int find(Key key) const
+    {
+        if (cells.empty()) {
+            return noSlot;
+        }
+
+        for (std::size_t index = homeOf(key); ; index = next(index)) {
+            const Cell& cell = cells[index];
+
+            if (cell.slot == noSlot || cell.key == key) {
+                return cell.slot;
+            }
+        }
+    }
+
+    void assign(Key key, int slot)
+    {
+        for (std::size_t index = homeOf(key); ; index = next(index)) {
+            Cell& cell = cells[index];
+
+            if (cell.slot == noSlot || cell.key == key) {
+                cell = { key, slot };
+                return;
+            }
+        }
+    }
+
+    void erase(Key key)
+    {
+        std::size_t hole = homeOf(key);
+
+        while (cells[hole].slot != noSlot && cells[hole].key != key) {
+            hole = next(hole);
+        }
+
+        if (cells[hole].slot == noSlot) {
+            return;
+        }
+
+        for (std::size_t index = next(hole); cells[index].slot != noSlot; index = next(index)) {
+            const std::size_t home = homeOf(cells[index].key);
+
+            const bool homeIsBetween = hole <= index ? (hole < home && home <= index)
+                                                     : (hole < home || home <= index);
+
+            if (!homeIsBetween) {
+                cells[hole] = cells[index];
+                hole        = index;
+            }
+        }
+
+        cells[hole].slot = noSlot;
+    }
+
+private:
+
+    struct Cell
+    {
+        Key key  {};
+        int slot = noSlot;
+    };
+
+    std::size_t homeOf(Key key) const
+    {
+        const auto hashed = static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15ull;
+
+        return static_cast<std::size_t>(hashed >> 32) & (cells.size() - 1);
+    }
+
+    std::size_t next(std::size_t index) const { return (index + 1) & (cells.size() - 1); }
+
+    std::vector<Cell> cells;
+};
+
 class TraversalPool
 {
 public:
@@ -34,29 +135,48 @@ public:
 
     using Entry = std::pair<int, Instance>;
 
+    struct Handle
+    {
+        int           slot       = -1;
+        std::uint32_t generation = 0;
+
+        explicit operator bool() const { return slot != -1; }
+    };
+
 private:
 
+    static constexpr int noSlot = -1;
+
+    struct Link
+    {
+        int previous = noSlot;
+        int next     = noSlot;
+    };
+
     struct Slot
     {
-        Entry entry;
-        bool  active = false;
+        Entry         entry;
+        std::uint32_t generation = 0;
+        int           denseIndex = noSlot;
+        int           nextFree   = noSlot;
+
+        int  indexedRootId = 0;
+        int  indexedTypeId = 0;
+        Link rootLink;
+        Link typeLink;
     };
 
 public:
 
-    void prepare(int capacity, const TraversalRule& rule)
-    {
-        if (slotCount() != capacity) {
-            slots.assign(static_cast<std::size_t>(capacity), Slot{});
+    void prepare(int capacity, const TraversalRule& defaultRule,
+                 std::span<const TraversalRule* const> ruleTable, int nodeCapacity);
 
-            activeCount = 0;
-        }
+    const TraversalRule* ruleFor(int ruleIndex) const;
 
-        for (auto& slot : slots) {
-            slot.entry.second.logic.nodeState.prepare();
-            slot.entry.second.logic.rule = &rule;
-        }
-    }
+    void adoptNodeStates(NodeStateReserve& reserve);
+    void bindNodeDirectory(const RTNodeDirectory* directory);
+
+    std::uint64_t nodeStateOverflowCount() const;
 
     template <bool IsConst>
     class Iterator
@@ -74,10 +194,7 @@ public:
 
         Iterator() = default;
 
-        Iterator(PoolPointer owner, int startIndex) : pool(owner), index(startIndex)
-        {
-            skipInactive();
-        }
+        Iterator(PoolPointer owner, int startIndex) : pool(owner), index(startIndex) {}
 
         reference operator* () const { return  slot().entry; }
         pointer   operator->() const { return &slot().entry; }
@@ -85,27 +202,21 @@ public:
         Iterator& operator++()
         {
             ++index;
-            skipInactive();
             return *this;
         }
 
         bool operator==(const Iterator& other) const { return index == other.index; }
         bool operator!=(const Iterator& other) const { return index != other.index; }
 
-        int slotIndex() const { return index; }
+        int denseIndex() const { return index; }
 
-    private:
+        Handle handle() const { return { slotIndex(), slot().generation }; }
 
-        SlotReference slot() const { return pool->slots[static_cast<std::size_t>(index)]; }
+    private:
 
-        void skipInactive()
-        {
-            const int slotCount = static_cast<int>(pool->slots.size());
+        int slotIndex() const { return pool->active[static_cast<std::size_t>(index)]; }
 
-            while (index < slotCount && !slot().active) {
-                ++index;
-            }
-        }
+        SlotReference slot() const { return pool->slots[static_cast<std::size_t>(slotIndex())]; }
 
         PoolPointer pool  = nullptr;
         int         index = 0;
@@ -115,73 +226,86 @@ public:
     using const_iterator = Iterator<true>;
 
     iterator begin() { return iterator(this, 0); }
-    iterator end()   { return iterator(this, slotCount()); }
+    iterator end()   { return iterator(this, size()); }
 
     const_iterator begin() const { return const_iterator(this, 0); }
-    const_iterator end()   const { return const_iterator(this, slotCount()); }
+    const_iterator end()   const { return const_iterator(this, size()); }
 
-    iterator       find(int id)       { return iterator      (this, findSlotIndex(id)); }
-    const_iterator find(int id) const { return const_iterator(this, findSlotIndex(id)); }
+    iterator       find(int id)       { return iterator      (this, denseIndexOf(instanceSlots.find(id))); }
+    const_iterator find(int id) const { return const_iterator(this, denseIndexOf(instanceSlots.find(id))); }
 
-    Instance* acquire(int id, int rootId, const RTtraversal& traversal)
-    {
-        for (auto& slot : slots) {
-            if (slot.active) {
-                continue;
-            }
+    Instance*       get(Handle handle);
+    const Instance* get(Handle handle) const;
 
-            slot.active      = true;
-            slot.entry.first = id;
-            slot.entry.second.logic.reset(rootId, traversal);
-            slot.entry.second.runtime = {};
+    Handle handleOf(int id) const;
+    int    idOf    (Handle handle) const;
 
-            ++activeCount;
+    Handle findOnRoot(int rootId, int typeId) const;
 
-            return &slot.entry.second;
+    template <typename Predicate>
+    bool anyOnRoot(int rootId, Predicate&& predicate) const
+    {
+        for (int slot = rootHeads.find(rootId); slot != noSlot; slot = slotAt(slot).rootLink.next) {
+            if (predicate(slotAt(slot).entry.second)) {
+                return true;
+            }
         }
 
-        return nullptr;
+        return false;
     }
 
-    iterator erase(iterator it)
-    {
-        const int index = it.slotIndex();
+    Instance* acquire(int id, int rootId, const RTtraversal& traversal);
 
-        slots[static_cast<std::size_t>(index)].active = false;
-        --activeCount;
+    iterator erase(iterator it);
 
-        return iterator(this, index + 1);
-    }
+    void reindex(int id);
 
-    void clear()
-    {
-        for (auto& slot : slots) {
-            slot.active = false;
-        }
+    void clear();
 
-        activeCount = 0;
-    }
+    bool empty() const { return active.empty(); }
+    int  size () const { return static_cast<int>(active.size()); }
 
-    bool empty() const { return activeCount == 0; }
-    int  size () const { return activeCount; }
+    std::uint64_t membershipVersion() const { return version; }
 
-private:
+    void markRepurposed() { ++version; }
 
-    int slotCount() const { return static_cast<int>(slots.size()); }
+private:
 
-    int findSlotIndex(int id) const
+    static std::int64_t typeKey(int rootId, int typeId)
     {
-        for (std::size_t i = 0; i < slots.size(); ++i) {
-            if (slots[i].active && slots[i].entry.first == id) {
-                return static_cast<int>(i);
-            }
-        }
-
-        return slotCount();
+        return (static_cast<std::int64_t>(rootId) << 32) ^ static_cast<std::uint32_t>(typeId);
     }
 
+    Slot&       slotAt(int slot)       { return slots[static_cast<std::size_t>(slot)]; }
+    const Slot& slotAt(int slot) const { return slots[static_cast<std::size_t>(slot)]; }
+
+    int denseIndexOf(int slot) const { return slot == noSlot ? size() : slotAt(slot).denseIndex; }
+
+    template <typename Key>
+    void link  (SlotIndexMap<Key>& heads, Link Slot::* member, Key key, int slot);
+
+    template <typename Key>
+    void unlink(SlotIndexMap<Key>& heads, Link Slot::* member, Key key, int slot);
+
+    void linkIndexes  (int slot);
+    void unlinkIndexes(int slot);
+
+    void release(int slot);
+
     std::vector<Slot> slots;
+    std::vector<int>  active;
 
-    int activeCount = 0;
-};
+    SlotIndexMap<int>          instanceSlots;
+    SlotIndexMap<int>          rootHeads;
+    SlotIndexMap<std::int64_t> typeHeads;
+
+    const TraversalRule*                  defaultRule = &NativeTraversalRule::instance();
+    std::span<const TraversalRule* const> ruleTable;
 
+    int firstFree         = noSlot;
+    int nodeStateCapacity = 0;
+
+    const RTNodeDirectory* boundDirectory = nullptr;
+
+    std::uint64_t version = 0;
+};
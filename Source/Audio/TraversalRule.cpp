@@ -1,69 +1,142 @@
 #include "TraversalRule.h"
 
-const RTNode* RuleContext::eligibleChild(int childId) const
+RTNodeRef RuleContext::eligibleChildRef(int edge) const
 {
-    const bool isTreeJumpChild = parent.treeJumpChildren.count(childId) > 0;
+    const auto edgeIndex = static_cast<std::size_t>(edge);
+
+    const bool isTreeJumpChild = graph.edgeIsTreeJump[edgeIndex] != 0;
 
     if (isTreeJumpChild && !allowTreeJumpChildren) {
-        return nullptr;
+        return {};
     }
 
-    const auto childIt = nodes.find(childId);
-    if (childIt == nodes.end()) {
-        return nullptr;
+    const RTNodeRef child = nodes.child(graph, edge);
+    if (!child) {
+        return {};
     }
 
-    const RTNode& child = childIt->second;
-
-    if (!isEligible(child.nodeType)) {
-        return nullptr;
+    if (!isEligible(child.type())) {
+        return {};
     }
 
-    if (child.countLimit <= 0) {
-        return nullptr;
+    if (child.countLimit() <= 0) {
+        return {};
     }
 
-    if (child.triggerLimit > 0) {
-        if (nodeState.get(NodeStateSlot::Trigger, childId) >= child.triggerLimit) {
-            return nullptr;
+    const int triggerLimit = child.triggerLimit();
+
+    if (triggerLimit > 0) {
+        if (nodeState.get(NodeStateSlot::Trigger, child.id()) >= triggerLimit) {
+            return {};
         }
     }
 
-    if (!isTreeJumpChild) {
-        const auto durIt = parent.durationMap.find(childId);
-        if (durIt != parent.durationMap.end() && durIt->second == 0) {
-            return nullptr;
-        }
+    if (!isTreeJumpChild && graph.edgeDurations[edgeIndex] == 0) {
+        return {};
     }
 
-    const auto disabledIt = parent.disabledTraversalsByChild.find(childId);
-    if (disabledIt != parent.disabledTraversalsByChild.end()
-        && disabledIt->second.count(traversalId) > 0) {
-        return nullptr;
+    if (graph.isTraversalDisabled(parent.denseIndex, edge, traversalId)) {
+        return {};
     }
 
-    return &child;
+    return child;
 }
 
-int NativeTraversalRule::selectChild(const RuleContext& context) const
+const RTNode* RuleContext::eligibleChild(int edge) const
+{
+    const RTNodeRef child = eligibleChildRef(edge);
+
+    return child ? &child.node() : nullptr;
+}
+
+int RuleContext::edgeTo(int childId) const
+{
+    for (int edge = firstEdge(); edge < edgeEnd(); ++edge) {
+        if (graph.edgeChildIds[static_cast<std::size_t>(edge)] == childId) {
+            return edge;
+        }
+    }
+
+    return -1;
+}
+
+ChildSelection TraversalRule::selectEdge(const RuleContext& context) const
 {
-    int chosen   = -1;
-    int maxLimit = 0;
+    const int childId = selectChild(context);
+
+    return { childId, childId != -1 ? context.edgeTo(childId) : -1 };
+}
 
-    for (const int childId : context.parent.children) {
-        const RTNode* child = context.eligibleChild(childId);
+namespace {
 
-        if (child == nullptr) {
+int selectPeriodicEdge(const RuleContext& context, const RTCompiledGraph::PeriodicSelection& selection)
+{
+    const RTCompiledGraph& graph = context.graph;
+
+    const std::int16_t* choices = graph.periodicSelectionChoices.data() + selection.offset
+                                + (context.parentCount % selection.period) * selection.typeCount;
+
+    int chosenEdge = -1;
+    int maxLimit   = 0;
+
+    for (int typeSlot = 0; typeSlot < selection.typeCount; ++typeSlot) {
+        if (choices[typeSlot] < 0 || !context.isEligible(selection.types[static_cast<std::size_t>(typeSlot)])) {
             continue;
         }
 
-        if (context.parentCount % child->countLimit == 0 && child->countLimit > maxLimit) {
-            chosen   = childId;
-            maxLimit = child->countLimit;
+        const int edge       = context.firstEdge() + choices[typeSlot];
+        const int childIndex = graph.edgeChildIndices[static_cast<std::size_t>(edge)];
+        const int countLimit = graph.countLimits[static_cast<std::size_t>(childIndex)];
+
+        if (countLimit > maxLimit || (countLimit == maxLimit && edge < chosenEdge)) {
+            chosenEdge = edge;
+            maxLimit   = countLimit;
         }
     }
 
-    return chosen;
+    return chosenEdge;
+}
+
+}
+
+int NativeTraversalRule::selectChild(const RuleContext& context) const
+{
+    return selectEdge(context).childId;
+}
+
+ChildSelection NativeTraversalRule::selectEdge(const RuleContext& context) const
+{
+    const auto& selection = context.graph.periodicSelectionAt(context.parent.denseIndex);
+
+    int chosenEdge = -1;
+
+    if (selection.period > 0 && context.parentCount >= 0 && !context.allowTreeJumpChildren) {
+        chosenEdge = selectPeriodicEdge(context, selection);
+    }
+    else {
+        int maxLimit = 0;
+
+        for (int edge = context.firstEdge(); edge < context.edgeEnd(); ++edge) {
+            const RTNodeRef child = context.eligibleChildRef(edge);
+
+            if (!child) {
+                continue;
+            }
+
+            const int countLimit = child.countLimit();
+
+            if (context.parentCount % countLimit == 0 && countLimit > maxLimit) {
+                chosenEdge = edge;
+                maxLimit   = countLimit;
+            }
+        }
+    }
+
+    if (chosenEdge == -1) {
+        return {};
+    }
+
+    return { context.graph.edgeChildIds[static_cast<std::size_t>(chosenEdge)], chosenEdge };
 }
 
 const NativeTraversalRule& NativeTraversalRule::instance()
@@ -1,22 +1,36 @@
 #pragma once
 
-#include "../Graph/RTData.h"
+#include "../Graph/RTNodeDirectory.h"
 #include "NodeStateTable.h"
 
 using ChildPredicate = bool (*)(RTNode::NodeType);
 
 struct RuleContext
 {
-    const NodeMap&        nodes;
-    const RTNode&         parent;
-    int                   parentCount;
-    int                   traversalId;
-    ChildPredicate        isEligible;
-    const NodeStateTable& nodeState;
+    const RTNodeDirectory& nodes;
+    const RTCompiledGraph& graph;
+    const RTNode&          parent;
+    int                    parentCount;
+    int                    traversalId;
+    ChildPredicate         isEligible;
+    const NodeStateTable&  nodeState;
 
     bool allowTreeJumpChildren = false;
 
-    const RTNode* eligibleChild(int childId) const;
+    int firstEdge () const { return graph.firstEdge(parent.denseIndex); }
+    int edgeEnd   () const { return graph.edgeEnd  (parent.denseIndex); }
+    int childCount() const { return edgeEnd() - firstEdge(); }
+
+    RTNodeRef     eligibleChildRef(int edge) const;
+    const RTNode* eligibleChild   (int edge) const;
+
+    int edgeTo(int childId) const;
+};
+
+struct ChildSelection
+{
+    int childId = -1;
+    int edge    = -1;
 };
 
 class TraversalRule
@@ -26,6 +40,8 @@ public:
     virtual ~TraversalRule() = default;
 
     virtual int selectChild(const RuleContext& context) const = 0;
+
+    virtual ChildSelection selectEdge(const RuleContext& context) const;
 };
 
 class NativeTraversalRule : public TraversalRule
@@ -34,5 +50,7 @@ public:
 
     int selectChild(const RuleContext& context) const override;
 
+    ChildSelection selectEdge(const RuleContext& context) const override;
+
     static const NativeTraversalRule& instance();
 };
@@ -18,16 +18,37 @@ TraversalSession::TraversalSession(EventManager& eventManager) : eventManager(ev
     restartRootScratch.reserve(scratchCapacity);
 }
 
-void TraversalSession::prepare()
+void TraversalSession::prepare(int nodeStateCapacity)
 {
-    selectChildScript = makeNativeSelectChildScript();
-    scriptRule.setScript(&selectChildScript);
+    builtInSelectionRule = ScriptTraversalRule::compile(makeNativeSelectChildScript());
+    jassert(builtInSelectionRule != nullptr);
 
-    if (useScriptedChildSelection) {
-        traversals.prepare(maxConcurrentTraversals, scriptRule);
+    scriptRule.setProgram(builtInSelectionRule.get());
+
+    for (std::size_t i = 0; i < traversalRules.size(); ++i) {
+        traversalRules[i].setProgram(builtInSelectionRule.get());
+        traversalRuleTable[i] = &traversalRules[i];
+    }
+
+    if (useScriptedChildSelection && builtInSelectionRule != nullptr) {
+        traversals.prepare(maxConcurrentTraversals, scriptRule, traversalRuleTable, nodeStateCapacity);
     }
     else {
-        traversals.prepare(maxConcurrentTraversals, NativeTraversalRule::instance());
+        traversals.prepare(maxConcurrentTraversals, NativeTraversalRule::instance(), {}, nodeStateCapacity);
+    }
+}
+
+void TraversalSession::adoptSelectionRules(const ScriptTraversalRule::Program* defaultRule,
+                                           const TraversalRulePrograms*        traversalPrograms)
+{
+    const ScriptTraversalRule::Program* fallback = defaultRule != nullptr ? defaultRule : builtInSelectionRule.get();
+
+    scriptRule.setProgram(fallback);
+
+    for (std::size_t i = 0; i < traversalRules.size(); ++i) {
+        const ScriptTraversalRule::Program* program = traversalPrograms != nullptr ? (*traversalPrograms)[i].get() : nullptr;
+
+        traversalRules[i].setProgram(program != nullptr ? program : fallback);
     }
 }
 
@@ -41,7 +62,7 @@ void TraversalSession::silenceAllNotes(juce::MidiBuffer& midiMessages)
     }
 
     eventManager.bridge.clearAllHighlights();
-    eventManager.scheduler.activeNotes.clear();
+    eventManager.scheduler.clear();
 }
 
 void TraversalSession::clearTraversals()
@@ -59,7 +80,7 @@ void TraversalSession::suspendActiveNotes(juce::MidiBuffer& midiMessages)
     eventManager.bridge.clearAllHighlights();
 }
 
-void TraversalSession::restartActiveTraversals(const NodeMap& nodes, RTGraphs& rtGraphs,
+void TraversalSession::restartActiveTraversals(const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
                                                juce::MidiBuffer& midiMessages)
 {
     restartRootScratch.clear();
@@ -93,16 +114,23 @@ void TraversalSession::restartActiveTraversals(const NodeMap& nodes, RTGraphs& r
     }
 }
 
-void TraversalSession::syncWithGraph(const NodeMap& nodes, RTGraphs& rtGraphs,
-                                     juce::MidiBuffer& midiMessages)
+void TraversalSession::syncWithGraph(const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
+                                     juce::MidiBuffer& midiMessages, std::uint64_t snapshotGeneration)
 {
+    if (snapshotGeneration == syncedGeneration && traversals.membershipVersion() == syncedPoolVersion) {
+        return;
+    }
+
+    syncedGeneration  = snapshotGeneration;
+    syncedPoolVersion = traversals.membershipVersion();
+
     syncActiveTraversals(nodes);
     removeDeletedTraversals(nodes, midiMessages);
     startMissingTraversals(nodes, rtGraphs, midiMessages);
     syncTraversalLoopLimits(nodes, rtGraphs, midiMessages);
 }
 
-void TraversalSession::syncActiveTraversals(const NodeMap& nodes)
+void TraversalSession::syncActiveTraversals(const RTNodeDirectory& nodes)
 {
     for (auto& [id, instance] : traversals) {
         TraversalLogic& logic = instance.logic;
@@ -112,6 +140,7 @@ void TraversalSession::syncActiveTraversals(const NodeMap& nodes)
             if (flagIt != nodes.end()
                 && flagIt->second.flagTraversal.traversalId == logic.traversal.traversalId) {
                 logic.traversal = flagIt->second.flagTraversal;
+                logic.rule      = traversals.ruleFor(logic.traversal.ruleIndex);
             }
             continue;
         }
@@ -124,13 +153,14 @@ void TraversalSession::syncActiveTraversals(const NodeMap& nodes)
         for (const RTtraversal& assigned : rootIt->second.traversals) {
             if (assigned.traversalId == logic.traversal.traversalId) {
                 logic.traversal = assigned;
+                logic.rule      = traversals.ruleFor(logic.traversal.ruleIndex);
                 break;
             }
         }
     }
 }
 
-void TraversalSession::removeDeletedTraversals(const NodeMap& nodes, juce::MidiBuffer& midiMessages)
+void TraversalSession::removeDeletedTraversals(const RTNodeDirectory& nodes, juce::MidiBuffer& midiMessages)
 {
     for (auto it = traversals.begin(); it != traversals.end(); ) {
         const TraversalPool::Instance& instance = it->second;
@@ -163,7 +193,7 @@ void TraversalSession::removeDeletedTraversals(const NodeMap& nodes, juce::MidiB
     }
 }
 
-void TraversalSession::startMissingTraversals(const NodeMap& nodes, RTGraphs& rtGraphs,
+void TraversalSession::startMissingTraversals(const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
                                               juce::MidiBuffer& midiMessages)
 {
     activeRootIdScratch.clear();
@@ -204,7 +234,7 @@ void TraversalSession::startMissingTraversals(const NodeMap& nodes, RTGraphs& rt
     }
 }
 
-void TraversalSession::syncTraversalLoopLimits(const NodeMap& nodes, RTGraphs& rtGraphs,
+void TraversalSession::syncTraversalLoopLimits(const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
                                                juce::MidiBuffer& midiMessages)
 {
     for (auto& [instanceId, instance] : traversals)
@@ -225,8 +255,9 @@ void TraversalSession::syncTraversalLoopLimits(const NodeMap& nodes, RTGraphs& r
 
         if (traversal.state == TraversalLogic::TraversalState::End) {
             if (newLoopLimit == 0 || traversal.loop.count < newLoopLimit) {
-                traversal.primary.target = traversal.rootId;
-                traversal.state          = TraversalLogic::TraversalState::Active;
+                traversal.primary.target   = traversal.rootId;
+                traversal.primary.lastEdge = -1;
+                traversal.state            = TraversalLogic::TraversalState::Active;
                 traversal.advanceAlternative(nodes, traversal.rootId);
 
                 auto rootIt = nodes.find(traversal.rootId);
@@ -239,50 +270,16 @@ void TraversalSession::syncTraversalLoopLimits(const NodeMap& nodes, RTGraphs& r
     }
 }
 
-bool TraversalSession::isLinkedAsChild(const NodeMap& nodes, int nodeId)
-{
-    for (const auto& [otherId, other] : nodes) {
-        for (int childId : other.children) {
-            if (childId == nodeId) {
-                return true;
-            }
-        }
-    }
-
-    return false;
-}
-
-int TraversalSession::findFirstUnlinkedRootId(const NodeMap& nodes) const
-{
-    int rootId = -1;
-
-    for (const auto& [nodeId, node] : nodes) {
-        if (node.nodeID != node.graphID) {
-            continue;
-        }
-
-        if (rootId != -1 && nodeId >= rootId) {
-            continue;
-        }
-
-        if (!isLinkedAsChild(nodes, nodeId)) {
-            rootId = nodeId;
-        }
-    }
-
-    return rootId;
-}
-
-bool TraversalSession::startTraversalsFromFirstRoot(const NodeMap& nodes, RTGraphs& rtGraphs,
+bool TraversalSession::startTraversalsFromFirstRoot(const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
                                                     juce::MidiBuffer& midiMessages)
 {
-    const int rootId = findFirstUnlinkedRootId(nodes);
+    const std::span<const int> entryRootIds = nodes.entryRootIds();
 
-    if (rootId == -1) {
+    if (entryRootIds.empty()) {
         return false;
     }
 
-    const RTNode& rootNode = nodes.at(rootId);
+    const RTNode& rootNode = nodes.at(entryRootIds.front());
 
     for (const RTtraversal& traversal : rootNode.traversals) {
         startTraversal(rootNode, traversal, nodes, rtGraphs, midiMessages);
@@ -292,7 +289,7 @@ bool TraversalSession::startTraversalsFromFirstRoot(const NodeMap& nodes, RTGrap
 }
 
 void TraversalSession::startTraversal(const RTNode& rootNode, const RTtraversal& traversal,
-                                      const NodeMap& nodes, RTGraphs& rtGraphs,
+                                      const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
                                       juce::MidiBuffer& midiMessages)
 {
     const int rootId      = rootNode.nodeID;
@@ -1,10 +1,14 @@
 #pragma once
 
-#include "../Util/PluginModules.h"
+#include "../Util/CoreModules.h"
 #include "TraversalPool.h"
 #include "ScriptTraversalRule.h"
 #include "../Graph/RTData.h"
 
+#include <array>
+#include <cstdint>
+#include <memory>
+
 class EventManager;
 
 class TraversalSession
@@ -13,20 +17,27 @@ public:
 
     explicit TraversalSession(EventManager& eventManager);
 
-    void prepare();
+    void prepare(int nodeStateCapacity);
+
+    static constexpr int maxTraversalRules = 16;
+
+    using TraversalRulePrograms = std::array<std::shared_ptr<const ScriptTraversalRule::Program>, maxTraversalRules>;
+
+    void adoptSelectionRules(const ScriptTraversalRule::Program* defaultRule,
+                             const TraversalRulePrograms*        traversalPrograms);
 
     void silenceAllNotes(juce::MidiBuffer& midiMessages);
     void clearTraversals();
 
     void suspendActiveNotes(juce::MidiBuffer& midiMessages);
 
-    void restartActiveTraversals(const NodeMap& nodes, RTGraphs& rtGraphs,
+    void restartActiveTraversals(const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
                                  juce::MidiBuffer& midiMessages);
 
-    void syncWithGraph(const NodeMap& nodes, RTGraphs& rtGraphs,
-                       juce::MidiBuffer& midiMessages);
+    void syncWithGraph(const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
+                       juce::MidiBuffer& midiMessages, std::uint64_t snapshotGeneration);
 
-    bool startTraversalsFromFirstRoot(const NodeMap& nodes, RTGraphs& rtGraphs,
+    bool startTraversalsFromFirstRoot(const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
                                       juce::MidiBuffer& midiMessages);
 
     TraversalPool&       getTraversals()       { return traversals; }
@@ -36,41 +47,44 @@ public:
 
     int nextTraversalInstanceId() { return ++traversalInstanceCounter; }
 
+    static constexpr int maxConcurrentTraversals = 128;
+
 private:
 
-    void syncActiveTraversals   (const NodeMap& nodes);
-    void removeDeletedTraversals(const NodeMap& nodes, juce::MidiBuffer& midiMessages);
+    void syncActiveTraversals   (const RTNodeDirectory& nodes);
+    void removeDeletedTraversals(const RTNodeDirectory& nodes, juce::MidiBuffer& midiMessages);
 
-    void startMissingTraversals (const NodeMap& nodes, RTGraphs& rtGraphs,
+    void startMissingTraversals (const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
                                  juce::MidiBuffer& midiMessages);
 
-    void syncTraversalLoopLimits(const NodeMap& nodes, RTGraphs& rtGraphs,
+    void syncTraversalLoopLimits(const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
                                  juce::MidiBuffer& midiMessages);
 
     void startTraversal(const RTNode& rootNode, const RTtraversal& traversal,
-                        const NodeMap& nodes, RTGraphs& rtGraphs,
+                        const RTNodeDirectory& nodes, RTGraphs& rtGraphs,
                         juce::MidiBuffer& midiMessages);
 
     void stopTraversalNotes(int instanceId, juce::MidiBuffer& midiMessages);
 
-    int findFirstUnlinkedRootId(const NodeMap& nodes) const;
-
-    static bool isLinkedAsChild(const NodeMap& nodes, int nodeId);
-
     EventManager& eventManager;
 
     TraversalPool traversals;
 
-    RTScript            selectChildScript;
-    ScriptTraversalRule scriptRule;
+    std::shared_ptr<const ScriptTraversalRule::Program> builtInSelectionRule;
+    ScriptTraversalRule                                 scriptRule;
+
+    std::array<ScriptTraversalRule,  maxTraversalRules> traversalRules;
+    std::array<const TraversalRule*, maxTraversalRules> traversalRuleTable {};
 
     static constexpr bool useScriptedChildSelection = true;
 
-    static constexpr int scratchCapacity           = 256;
-    static constexpr int maxConcurrentTraversals   = 128;
+    static constexpr int scratchCapacity = 256;
 
     std::vector<int> activeRootIdScratch;
     std::vector<int> restartRootScratch;
 
     int traversalInstanceCounter = 0;
+
+    std::uint64_t syncedGeneration  = 0;
+    std::uint64_t syncedPoolVersion  = 0;
 };
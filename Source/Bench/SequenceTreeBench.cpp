@@ -0,0 +1,329 @@
+#include "../Audio/ScriptTraversalRule.h"
+#include "../Audio/SequenceTreeEngine.h"
+#include "../Graph/ProjectGenerator.h"
+#include "../Graph/RTGraphBuilder.h"
+#include "../Graph/ValueTreeState.h"
+#include "../Graph/ValueTreeIdentifiers.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr double sampleRate = 48000.0;
+constexpr int    blockSize  = 512;
+
+struct Shape
+{
+    const char*                name = "";
+    ProjectGenerator::Settings settings;
+};
+
+struct Options
+{
+    int blocks       = 2000;
+    int steps        = 200000;
+    int rebuilds     = 50;
+    int publishes    = 200;
+    int warmupBlocks = 64;
+    int selections   = 200000;
+};
+
+double nanosecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+std::vector<juce::ValueTree> rootNodes(const ValueTreeState& state)
+{
+    std::vector<juce::ValueTree> roots;
+
+    for (int i = 0; i < state.nodeMap.getNumChildren(); ++i) {
+        const juce::ValueTree node = state.nodeMap.getChild(i);
+
+        if (node.getType() == ValueTreeIdentifiers::RootNodeData) {
+            roots.push_back(node);
+        }
+    }
+
+    return roots;
+}
+
+juce::var makeResult(const char* name, const Shape& shape, int nodeCount, int operations, double totalNs)
+{
+    auto* result = new juce::DynamicObject();
+
+    result->setProperty("name",       name);
+    result->setProperty("shape",      shape.name);
+    result->setProperty("trees",      shape.settings.trees);
+    result->setProperty("depth",      shape.settings.depth);
+    result->setProperty("fanOut",     shape.settings.fanOut);
+    result->setProperty("nodes",      nodeCount);
+    result->setProperty("operations", operations);
+    result->setProperty("nsPerOp",    totalNs / juce::jmax(1, operations));
+
+    return juce::var(result);
+}
+
+bool anyChild(RTNode::NodeType)
+{
+    return true;
+}
+
+void benchChildSelection(int fanOut, const Options& options, juce::Array<juce::var>& results)
+{
+    Shape shape { "fanOut", {} };
+
+    shape.settings.depth  = 1;
+    shape.settings.fanOut = fanOut;
+
+    ValueTreeState     state;
+    SequenceTreeEngine engine;
+
+    const int  nodeCount = ProjectGenerator(shape.settings).populate(state).nodes;
+    const auto rtGraphs  = ProjectGenerator::compileGraphs(engine, state);
+
+    const auto* snapshot = engine.getPublishedSnapshot();
+
+    if (snapshot == nullptr || rtGraphs.empty()) {
+        return;
+    }
+
+    const RTNodeDirectory& nodes  = snapshot->nodes;
+    const RTNode&          parent = nodes.at(rtGraphs.begin()->first);
+
+    NodeStateTable nodeState;
+    nodeState.prepare(engine.getNodeStateCapacity());
+    nodeState.bind(&nodes);
+
+    const RTScript      script = makeNativeSelectChildScript();
+    ScriptTraversalRule scriptRule;
+
+    if (!scriptRule.setScript(&script)) {
+        return;
+    }
+
+    auto run = [&](const TraversalRule& rule, int& checksum) {
+        const auto start = Clock::now();
+
+        for (int i = 0; i < options.selections; ++i) {
+            const RuleContext context { nodes, nodes.graphOf(parent), parent, i, 1, &anyChild, nodeState };
+            checksum += rule.selectChild(context);
+        }
+
+        return nanosecondsSince(start);
+    };
+
+    int nativeChecksum = 0;
+    int scriptChecksum = 0;
+
+    const double nativeNs = run(NativeTraversalRule::instance(), nativeChecksum);
+    const double scriptNs = run(scriptRule, scriptChecksum);
+
+    for (const auto& [name, totalNs] : { std::pair { "selectChildNative", nativeNs },
+                                         std::pair { "selectChildScript", scriptNs } }) {
+        juce::var result = makeResult(name, shape, nodeCount, options.selections, totalNs);
+        result.getDynamicObject()->setProperty("childCount",     fanOut);
+        result.getDynamicObject()->setProperty("matchesNative",  nativeChecksum == scriptChecksum);
+        result.getDynamicObject()->setProperty("scriptOverhead", scriptNs / juce::jmax(1.0, nativeNs));
+
+        results.add(result);
+    }
+}
+
+void benchShape(const Shape& shape, const Options& options, juce::Array<juce::var>& results)
+{
+    ValueTreeState     state;
+    SequenceTreeEngine engine;
+    RTGraphBuilder     builder { engine, state };
+
+    const int nodeCount = ProjectGenerator(shape.settings).populate(state).nodes;
+    const auto roots    = rootNodes(state);
+
+    engine.prepare(sampleRate);
+    engine.syncToHost.store(false);
+
+    auto completeAudioBlock = [&engine] { engine.blocksCompleted.fetch_add(1, std::memory_order_release); };
+
+    {
+        const auto start = Clock::now();
+
+        for (int i = 0; i < options.rebuilds; ++i) {
+            for (const auto& root : roots) {
+                builder.makeRTGraph(root);
+                completeAudioBlock();
+            }
+        }
+
+        results.add(makeResult("makeRTGraph", shape, nodeCount,
+                               options.rebuilds * static_cast<int>(roots.size()), nanosecondsSince(start)));
+    }
+
+    {
+        double totalNs = 0.0;
+
+        for (int i = 0; i < options.publishes; ++i) {
+            for (const auto& [graphId, graph] : builder.rtGraphs) {
+                const auto start = Clock::now();
+                engine.setNewGraph(graph);
+                totalNs += nanosecondsSince(start);
+
+                completeAudioBlock();
+            }
+        }
+
+        results.add(makeResult("snapshotPublish", shape, nodeCount,
+                               options.publishes * static_cast<int>(builder.rtGraphs.size()), totalNs));
+    }
+
+    const auto* snapshot = engine.getPublishedSnapshot();
+
+    if (snapshot == nullptr || builder.rtGraphs.empty()) {
+        return;
+    }
+
+    {
+        const RTNodeDirectory& nodes = snapshot->nodes;
+
+        const auto& firstGraph = *builder.rtGraphs.begin()->second;
+
+        TraversalLogic logic;
+        logic.nodeState.prepare(engine.getNodeStateCapacity());
+        logic.nodeState.bind(&nodes);
+
+        const RTNode&     rootNode  = firstGraph.nodeMap.at(firstGraph.graphID);
+        const RTtraversal traversal = rootNode.traversals.empty() ? RTtraversal {} : rootNode.traversals.front();
+
+        logic.reset(firstGraph.graphID, traversal);
+
+        const auto start = Clock::now();
+
+        for (int i = 0; i < options.steps; ++i) {
+            logic.handleNodeEvent(nodes);
+
+            if (logic.state == TraversalLogic::TraversalState::End) {
+                logic.reset(firstGraph.graphID, traversal);
+            }
+        }
+
+        results.add(makeResult("handleNodeEvent", shape, nodeCount, options.steps, nanosecondsSince(start)));
+    }
+
+    {
+        juce::MidiBuffer midiMessages;
+
+        engine.isPlaying.store(true);
+
+        for (int i = 0; i < options.warmupBlocks; ++i) {
+            engine.processBlock(nullptr, blockSize, midiMessages);
+            engine.eventManager.bridge.discardPendingCommands();
+        }
+
+        const RTNodeDirectory& nodes      = engine.getPublishedSnapshot()->nodes;
+        const std::uint64_t    generation = engine.getPublishedSnapshot()->generation;
+        TraversalPool&         traversals = engine.traversalSession.getTraversals();
+
+        double totalNs = 0.0;
+        int    events  = 0;
+
+        for (int i = 0; i < options.blocks; ++i) {
+            midiMessages.clear();
+            engine.eventManager.beginBlock(sampleRate, nullptr);
+
+            const auto start = Clock::now();
+            engine.eventManager.processEvents(blockSize, midiMessages, nodes, traversals, generation);
+            totalNs += nanosecondsSince(start);
+
+            events += midiMessages.getNumEvents();
+            engine.eventManager.bridge.discardPendingCommands();
+        }
+
+        juce::var result = makeResult("processEvents", shape, nodeCount, options.blocks, totalNs);
+        result.getDynamicObject()->setProperty("midiEvents", events);
+        result.getDynamicObject()->setProperty("blockSize",  blockSize);
+
+        results.add(result);
+    }
+}
+}
+
+int main(int argc, char** argv)
+{
+    const juce::ArgumentList arguments(argc, argv);
+
+    Options options;
+
+    if (arguments.containsOption("--blocks"))     options.blocks     = juce::jmax(1, arguments.getValueForOption("--blocks").getIntValue());
+    if (arguments.containsOption("--steps"))      options.steps      = juce::jmax(1, arguments.getValueForOption("--steps").getIntValue());
+    if (arguments.containsOption("--rebuilds"))   options.rebuilds   = juce::jmax(1, arguments.getValueForOption("--rebuilds").getIntValue());
+    if (arguments.containsOption("--publishes"))  options.publishes  = juce::jmax(1, arguments.getValueForOption("--publishes").getIntValue());
+    if (arguments.containsOption("--selections")) options.selections = juce::jmax(1, arguments.getValueForOption("--selections").getIntValue());
+
+    auto shape = [](const char* name, int trees, int depth, int fanOut) {
+        Shape result { name, {} };
+
+        result.settings.trees  = trees;
+        result.settings.depth  = depth;
+        result.settings.fanOut = fanOut;
+
+        return result;
+    };
+
+    Shape mixed = shape("mixed", 8, 4, 3);
+
+    mixed.settings.chordEdges       = 0.2f;
+    mixed.settings.alternativeNodes = 0.1f;
+    mixed.settings.modulatorChains  = 0.05f;
+    mixed.settings.traversalFlags   = 0.05f;
+    mixed.settings.crossTreeJumps   = 0.1f;
+
+    Shape large = mixed;
+
+    large.name     = "large";
+    large.settings = ProjectGenerator::withNodeCount(mixed.settings, 10000);
+
+    const Shape shapes[] = {
+        shape("chain",  1, 4, 2),
+        shape("wide",   4, 3, 3),
+        shape("forest", 8, 4, 2),
+        shape("bushy", 16, 2, 5),
+        mixed,
+        large,
+    };
+
+    juce::Array<juce::var> results;
+
+    for (const Shape& shape : shapes) {
+        benchShape(shape, options, results);
+    }
+
+    for (const int fanOut : { 4, 16, 64, 256 }) {
+        benchChildSelection(fanOut, options, results);
+    }
+
+    auto* report = new juce::DynamicObject();
+
+    report->setProperty("benchmark",  "SequenceTreeBench");
+    report->setProperty("sampleRate", sampleRate);
+    report->setProperty("results",    results);
+
+    const juce::String json = juce::JSON::toString(juce::var(report));
+
+    if (arguments.containsOption("--out")) {
+        const juce::File out = juce::File::getCurrentWorkingDirectory()
+                                   .getChildFile(arguments.getValueForOption("--out"));
+
+        if (!out.replaceWithText(json)) {
+            std::fprintf(stderr, "could not write %s\n", out.getFullPathName().toRawUTF8());
+            return 1;
+        }
+    }
+    else {
+        std::printf("%s\n", json.toRawUTF8());
+    }
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include "../Graph/RTNodeDirectory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct Project
+{
+    std::vector<std::shared_ptr<RTGraph>> graphs;
+};
+
+Project makeProject(int treeCount, int nodesPerTree, unsigned seed)
+{
+    std::mt19937 random(seed);
+
+    Project project;
+    int     nextId = 1;
+
+    for (int tree = 0; tree < treeCount; ++tree) {
+        auto graph = std::make_shared<RTGraph>();
+
+        const int rootId = nextId++;
+
+        graph->graphID = rootId;
+        graph->rootID  = rootId;
+
+        RTNode root;
+        root.nodeID   = rootId;
+        root.graphID  = rootId;
+        root.nodeType = RTNode::NodeType::RootNode;
+
+        graph->nodeMap[rootId] = root;
+
+        std::vector<int> ids { rootId };
+
+        for (int index = 1; index < nodesPerTree; ++index) {
+            const int parentId = ids[random() % ids.size()];
+
+            RTNode node;
+            node.nodeID   = nextId++;
+            node.graphID  = rootId;
+            node.parentId = parentId;
+
+            RTNode& parent = graph->nodeMap[parentId];
+            parent.children.push_back(node.nodeID);
+            parent.durationMap[node.nodeID] = 100 + static_cast<int>(random() % 400);
+
+            graph->nodeMap[node.nodeID] = node;
+            ids.push_back(node.nodeID);
+        }
+
+        project.graphs.push_back(std::move(graph));
+    }
+
+    return project;
+}
+
+struct CopyEverythingSnapshot
+{
+    std::shared_ptr<NodeMap>               globalNodes;
+    std::shared_ptr<const RTCompiledGraph> compiledNodes;
+};
+
+CopyEverythingSnapshot publishByCopy(const CopyEverythingSnapshot& previous, const RTGraph& graph)
+{
+    CopyEverythingSnapshot next;
+
+    next.globalNodes = previous.globalNodes ? std::make_shared<NodeMap>(*previous.globalNodes)
+                                            : std::make_shared<NodeMap>();
+
+    for (const auto& [nodeId, node] : graph.nodeMap) {
+        (*next.globalNodes)[nodeId] = node;
+    }
+
+    for (auto it = next.globalNodes->begin(); it != next.globalNodes->end();) {
+        if (it->second.graphID == graph.graphID && !graph.nodeMap.count(it->first)) {
+            it = next.globalNodes->erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    next.compiledNodes = std::make_shared<const RTCompiledGraph>(RTCompiledGraph::compile(*next.globalNodes, 0));
+
+    return next;
+}
+
+RTNodeDirectory publishShared(const RTNodeDirectory& previous, const RTGraph& graph)
+{
+    return previous.withGraph(std::make_shared<RTCompiledGraph>(RTCompiledGraph::compile(graph.nodeMap, graph.graphID)));
+}
+
+double median(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+template <typename Publish>
+double measureMicroseconds(const Project& project, int publishes, Publish&& publish)
+{
+    std::vector<double> samples;
+    samples.reserve(static_cast<std::size_t>(publishes));
+
+    for (int index = 0; index < publishes; ++index) {
+        const RTGraph& edited = *project.graphs[static_cast<std::size_t>(index) % project.graphs.size()];
+
+        const auto start = Clock::now();
+        publish(edited);
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+
+    return median(samples);
+}
+}
+
+int main(int argc, char** argv)
+{
+    const int publishes = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200;
+
+    std::printf("%8s %10s %14s %14s %8s\n", "trees", "nodes", "copy_all_us", "shared_us", "speedup");
+
+    for (const int treeCount : { 4, 16, 64 }) {
+        for (const int nodesPerTree : { 16, 128, 512 }) {
+            const Project project = makeProject(treeCount, nodesPerTree, 1234u);
+
+            CopyEverythingSnapshot copied;
+            RTNodeDirectory        shared;
+
+            for (const auto& graph : project.graphs) {
+                copied = publishByCopy(copied, *graph);
+                shared = publishShared(shared, *graph);
+            }
+
+            const double copyMicros = measureMicroseconds(project, publishes, [&](const RTGraph& graph) {
+                copied = publishByCopy(copied, graph);
+            });
+
+            const double sharedMicros = measureMicroseconds(project, publishes, [&](const RTGraph& graph) {
+                shared = publishShared(shared, graph);
+            });
+
+            std::printf("%8d %10d %14.1f %14.1f %7.1fx\n", treeCount, treeCount * nodesPerTree,
+                        copyMicros, sharedMicros, copyMicros / std::max(sharedMicros, 0.001));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include "ProjectGenerator.h"
+
+#include "../Audio/SequenceTreeEngine.h"
+#include "RTGraphBuilder.h"
+#include "ValueTreeState.h"
+#include "ValueTreeIdentifiers.h"
+
+#include <limits>
+#include <utility>
+
+static NodePosition positionOf(const juce::ValueTree& node)
+{
+    return { (int) node.getProperty(ValueTreeIdentifiers::XPosition),
+             (int) node.getProperty(ValueTreeIdentifiers::YPosition),
+             (int) node.getProperty(ValueTreeIdentifiers::Radius) };
+}
+
+ProjectGenerator::ProjectGenerator(Settings newSettings)
+    : settings(newSettings), random(newSettings.seed)
+{
+    jassert(settings.trees > 0 && settings.depth >= 0 && settings.fanOut > 0);
+}
+
+ProjectGenerator::Stats ProjectGenerator::populate(ValueTreeState& state)
+{
+    stats = {};
+    row   = 0;
+
+    const int nodesBefore = state.nodeMap.getNumChildren();
+
+    for (const int traversalId : { rootTraversalId, flagTraversalId }) {
+        if (!state.traversalMap.getChildWithProperty(ValueTreeIdentifiers::TraversalId, traversalId).isValid()) {
+            state.createTraversalData(traversalId, nullptr);
+        }
+    }
+
+    std::vector<Tree> trees;
+    trees.reserve(static_cast<std::size_t>(settings.trees));
+
+    for (int i = 0; i < settings.trees; ++i) {
+        Tree tree;
+        tree.root = addRoot(state);
+
+        addChildren(state, tree);
+        trees.push_back(std::move(tree));
+    }
+
+    connectTrees(state, trees);
+
+    stats.trees = settings.trees;
+    stats.nodes = state.nodeMap.getNumChildren() - nodesBefore;
+
+    return stats;
+}
+
+juce::ValueTree ProjectGenerator::addRoot(ValueTreeState& state)
+{
+    juce::ValueTree root = state.addRootNode(nullptr);
+
+    state.setNodePosition(root, { 0, nextRow(), radius }, nullptr);
+    state.setMidiValue(root, randomNote(), nullptr);
+
+    juce::ValueTree traversalIdTree { ValueTreeIdentifiers::TraversalId };
+    traversalIdTree.setProperty(ValueTreeIdentifiers::TraversalId, rootTraversalId, nullptr);
+    root.getChildWithName(ValueTreeIdentifiers::TraversalChildrenIds).addChild(traversalIdTree, -1, nullptr);
+
+    decorate(state, root);
+
+    return root;
+}
+
+void ProjectGenerator::addChildren(ValueTreeState& state, Tree& tree)
+{
+    const int stepPixels = juce::jmax(1, juce::roundToInt(static_cast<float>(settings.stepMs) / arrowMillisecondsPerPixel));
+
+    std::vector<std::pair<juce::ValueTree, int>> stack { { tree.root, 0 } };
+
+    while (!stack.empty()) {
+        auto [parent, level] = std::move(stack.back());
+        stack.pop_back();
+
+        if (level >= settings.depth) {
+            tree.leaves.push_back(parent);
+            continue;
+        }
+
+        const NodePosition parentPosition    = positionOf(parent);
+        const bool         parentAlternative = parent.getType() == ValueTreeIdentifiers::AlternativeNodeData;
+
+        for (int i = 0; i < settings.fanOut; ++i) {
+            const bool alternative = chance(settings.alternativeNodes);
+            const bool chord       = !alternative && !parentAlternative && chance(settings.chordEdges);
+
+            juce::ValueTree node = state.addChildNode(parent, alternative ? ValueTreeIdentifiers::AlternativeNodeData
+                                                                          : ValueTreeIdentifiers::NodeData, nullptr);
+
+            const int x = chord ? parentPosition.xPosition : parentPosition.xPosition + stepPixels;
+            const int y = (alternative || parentAlternative) ? parentPosition.yPosition + stepPixels : nextRow();
+
+            state.setNodePosition(node, { x, y, radius }, nullptr);
+            state.setMidiValue(node, randomNote(), nullptr);
+
+            stats.chordEdges       += chord       ? 1 : 0;
+            stats.alternativeNodes += alternative ? 1 : 0;
+
+            decorate(state, node);
+
+            stack.emplace_back(node, level + 1);
+        }
+    }
+}
+
+void ProjectGenerator::decorate(ValueTreeState& state, juce::ValueTree node)
+{
+    if (chance(settings.traversalFlags)) {
+        const NodePosition position = positionOf(node);
+
+        juce::ValueTree flag = state.addTraversalFlagNode(node, nullptr);
+
+        flag.setProperty(ValueTreeIdentifiers::TraversalFlagValue, flagTraversalId, nullptr);
+        state.setNodePosition(flag, { position.xPosition, position.yPosition + radius, radius / 2 }, nullptr);
+
+        ++stats.traversalFlags;
+    }
+
+    if (chance(settings.modulatorChains)) {
+        addModulatorChain(state, node);
+    }
+}
+
+void ProjectGenerator::addModulatorChain(ValueTreeState& state, juce::ValueTree node)
+{
+    const NodePosition position = positionOf(node);
+
+    juce::ValueTree modulator = state.addModulatorRoot(node, nullptr);
+    ++stats.modulatorRoots;
+
+    for (int i = 0; i < settings.modulatorChainLength; ++i) {
+        if (i > 0) {
+            modulator = state.addModulator(modulator, nullptr);
+            ++stats.modulators;
+        }
+
+        modulator.setProperty(ValueTreeIdentifiers::ModAmount, random.nextInt(25) - 12, nullptr);
+        state.setNodePosition(modulator, { position.xPosition + (i + 1) * radius,
+                                           position.yPosition - radius, radius / 2 }, nullptr);
+    }
+}
+
+void ProjectGenerator::connectTrees(ValueTreeState& state, const std::vector<Tree>& trees)
+{
+    const int treeCount = static_cast<int>(trees.size());
+
+    if (treeCount < 2) {
+        return;
+    }
+
+    for (int i = 0; i < treeCount; ++i) {
+        for (const juce::ValueTree& leaf : trees[static_cast<std::size_t>(i)].leaves) {
+            if (!chance(settings.crossTreeJumps)) {
+                continue;
+            }
+
+            const int target   = (i + 1 + random.nextInt(treeCount - 1)) % treeCount;
+            const int targetId = trees[static_cast<std::size_t>(target)].root.getProperty(ValueTreeIdentifiers::Id);
+
+            juce::ValueTree connection = state.connectNodes(leaf, targetId, nullptr);
+            connection.setProperty(ValueTreeIdentifiers::ArrowType, static_cast<int>(ArrowType::Traversal), nullptr);
+
+            ++stats.crossTreeJumps;
+        }
+    }
+}
+
+NodeNote ProjectGenerator::randomNote()
+{
+    return { 36 + random.nextInt(48), 64 + random.nextInt(64), juce::jmax(1, settings.stepMs / 2), 1 };
+}
+
+bool ProjectGenerator::chance(float proportion)
+{
+    return proportion > 0.0f && random.nextFloat() < proportion;
+}
+
+int ProjectGenerator::treeNodeCount(const Settings& settings)
+{
+    juce::int64 levelNodes = 1;
+    juce::int64 total      = 1;
+
+    for (int level = 0; level < settings.depth && total < std::numeric_limits<int>::max(); ++level) {
+        levelNodes *= settings.fanOut;
+        total      += levelNodes;
+    }
+
+    return static_cast<int>(juce::jmin<juce::int64>(total, std::numeric_limits<int>::max()));
+}
+
+ProjectGenerator::Settings ProjectGenerator::withNodeCount(Settings settings, int targetNodes)
+{
+    settings.trees = juce::jmax(1, juce::roundToInt(static_cast<double>(targetNodes) / treeNodeCount(settings)));
+
+    return settings;
+}
+
+void ProjectGenerator::createStateBlob(const ValueTreeState& state, juce::MemoryBlock& destData)
+{
+    ValueTreeState::encodeStateBlob(state.createStateTree(), destData);
+}
+
+ProjectGenerator::RTGraphs ProjectGenerator::compileGraphs(SequenceTreeEngine& engine, ValueTreeState& state)
+{
+    RTGraphBuilder builder { engine, state };
+    builder.rebuildAllGraphs();
+
+    return builder.rtGraphs;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../Util/CoreModules.h"
+#include "../Util/NodeInfo.h"
+#include "RTData.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class SequenceTreeEngine;
+class ValueTreeState;
+
+class ProjectGenerator
+{
+public:
+
+    struct Settings
+    {
+        int trees  = 1;
+        int depth  = 4;
+        int fanOut = 2;
+
+        float chordEdges       = 0.0f;
+        float alternativeNodes = 0.0f;
+        float modulatorChains  = 0.0f;
+        float traversalFlags   = 0.0f;
+        float crossTreeJumps   = 0.0f;
+
+        int modulatorChainLength = 3;
+        int stepMs               = 250;
+
+        juce::int64 seed = 1;
+    };
+
+    struct Stats
+    {
+        int nodes            = 0;
+        int trees            = 0;
+        int chordEdges       = 0;
+        int alternativeNodes = 0;
+        int modulatorRoots   = 0;
+        int modulators       = 0;
+        int traversalFlags   = 0;
+        int crossTreeJumps   = 0;
+    };
+
+    using RTGraphs = std::unordered_map<int, std::shared_ptr<RTGraph>>;
+
+    static constexpr int rootTraversalId = 1;
+    static constexpr int flagTraversalId = 2;
+
+    explicit ProjectGenerator(Settings settings);
+
+    Stats populate(ValueTreeState& state);
+
+    static Settings withNodeCount(Settings settings, int targetNodes);
+    static int      treeNodeCount(const Settings& settings);
+
+    static void     createStateBlob(const ValueTreeState& state, juce::MemoryBlock& destData);
+    static RTGraphs compileGraphs  (SequenceTreeEngine& engine, ValueTreeState& state);
+
+private:
+
+    struct Tree
+    {
+        juce::ValueTree root;
+        std::vector<juce::ValueTree> leaves;
+    };
+
+    juce::ValueTree addRoot(ValueTreeState& state);
+
+    void addChildren(ValueTreeState& state, Tree& tree);
+
+    void decorate(ValueTreeState& state, juce::ValueTree node);
+
+    void addModulatorChain(ValueTreeState& state, juce::ValueTree node);
+
+    void connectTrees(ValueTreeState& state, const std::vector<Tree>& trees);
+
+    NodeNote randomNote();
+
+    bool chance(float proportion);
+
+    int nextRow() { return row++ * rowHeight; }
+
+    static constexpr int rowHeight = 20;
+    static constexpr int radius    = 20;
+
+    Settings     settings;
+    Stats        stats;
+    juce::Random random;
+    int          row = 0;
+};
@@ -0,0 +1,441 @@
+#include "RTCompiledGraph.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+bool hasDisabledTraversals(const RTNode& parent, int childId)
+{
+    const auto disabledIt = parent.disabledTraversalsByChild.find(childId);
+
+    return disabledIt != parent.disabledTraversalsByChild.end() && !disabledIt->second.empty();
+}
+
+std::uint64_t disabledMaskFor(const RTNode& parent, int childId)
+{
+    const auto disabledIt = parent.disabledTraversalsByChild.find(childId);
+
+    std::uint64_t disabledMask = 0;
+
+    if (disabledIt != parent.disabledTraversalsByChild.end()) {
+        for (const int traversalId : disabledIt->second) {
+            if (traversalId >= 0 && traversalId < RTCompiledGraph::maskedTraversalIds) {
+                disabledMask |= std::uint64_t { 1 } << traversalId;
+            }
+        }
+    }
+
+    return disabledMask;
+}
+
+void buildNodeDurations(RTCompiledGraph& graph)
+{
+    const std::size_t nodeCount = graph.entries.size();
+
+    graph.danglingDurations    .reserve(nodeCount);
+    graph.alternativeDurations .reserve(nodeCount);
+    graph.danglingDisabledMasks.reserve(nodeCount);
+
+    for (std::size_t index = 0; index < nodeCount; ++index) {
+        const RTNode& node = graph.nodeAt(static_cast<int>(index));
+
+        const auto danglingIt = node.durationMap.find(node.nodeID);
+        const auto parentIt   = node.isAlternativeNode ? node.durationMap.find(node.parentId) : node.durationMap.end();
+
+        graph.danglingDurations    .push_back(danglingIt != node.durationMap.end() ? danglingIt->second : RTCompiledGraph::noDuration);
+        graph.alternativeDurations .push_back(parentIt   != node.durationMap.end() ? parentIt->second   : RTCompiledGraph::noDuration);
+        graph.danglingDisabledMasks.push_back(disabledMaskFor(node, node.nodeID));
+    }
+}
+
+void buildTreeIntervals(RTCompiledGraph& graph, const std::unordered_map<int, int>& ownedIndexById)
+{
+    const std::size_t nodeCount = graph.entries.size();
+
+    graph.treeEnter      .assign(nodeCount, -1);
+    graph.treeExit       .assign(nodeCount, -1);
+    graph.treeLeavesGraph.assign(nodeCount, 0);
+
+    std::vector<int> parentIndices(nodeCount, -1);
+    std::vector<int> childOffsets (nodeCount + 1, 0);
+
+    for (std::size_t index = 0; index < nodeCount; ++index) {
+        const RTNode& node = graph.nodeAt(static_cast<int>(index));
+
+        if (!graph.ownsNode(static_cast<int>(index))) {
+            continue;
+        }
+
+        const auto parentIt = ownedIndexById.find(node.parentId);
+
+        if (parentIt != ownedIndexById.end() && parentIt->second != static_cast<int>(index)) {
+            parentIndices[index] = parentIt->second;
+            ++childOffsets[static_cast<std::size_t>(parentIt->second) + 1];
+        }
+    }
+
+    for (std::size_t index = 0; index < nodeCount; ++index) {
+        childOffsets[index + 1] += childOffsets[index];
+    }
+
+    std::vector<int> treeChildren(static_cast<std::size_t>(childOffsets[nodeCount]));
+    std::vector<int> nextChild   (childOffsets.begin(), childOffsets.end() - 1);
+
+    for (std::size_t index = 0; index < nodeCount; ++index) {
+        if (const int parentIndex = parentIndices[index]; parentIndex != -1) {
+            treeChildren[static_cast<std::size_t>(nextChild[static_cast<std::size_t>(parentIndex)]++)] = static_cast<int>(index);
+        }
+    }
+
+    std::vector<std::pair<int, int>> stack;
+
+    int counter = 0;
+
+    for (std::size_t root = 0; root < nodeCount; ++root) {
+        if (!graph.ownsNode(static_cast<int>(root)) || parentIndices[root] != -1) {
+            continue;
+        }
+
+        const std::uint8_t leavesGraph = graph.nodeAt(static_cast<int>(root)).parentId != 0 ? 1 : 0;
+
+        stack.emplace_back(static_cast<int>(root), childOffsets[root]);
+
+        graph.treeEnter      [root] = counter++;
+        graph.treeLeavesGraph[root] = leavesGraph;
+
+        while (!stack.empty()) {
+            auto& [nodeIndex, cursor] = stack.back();
+
+            if (cursor == childOffsets[static_cast<std::size_t>(nodeIndex) + 1]) {
+                graph.treeExit[static_cast<std::size_t>(nodeIndex)] = counter;
+                stack.pop_back();
+                continue;
+            }
+
+            const int child = treeChildren[static_cast<std::size_t>(cursor++)];
+
+            graph.treeEnter      [static_cast<std::size_t>(child)] = counter++;
+            graph.treeLeavesGraph[static_cast<std::size_t>(child)] = leavesGraph;
+
+            stack.emplace_back(child, childOffsets[static_cast<std::size_t>(child)]);
+        }
+    }
+}
+
+void buildChordMembers(RTCompiledGraph& graph, const std::unordered_map<int, int>& ownedIndexById)
+{
+    const std::size_t nodeCount = graph.entries.size();
+
+    graph.chordOffsets      .reserve(nodeCount + 1);
+    graph.chordClosureIsTree.assign(nodeCount, 0);
+
+    for (const auto& [nodeId, node] : graph.entries) {
+        graph.chordOffsets.push_back(static_cast<int>(graph.chordMembers.size()));
+
+        for (const auto& [memberId, durationMs] : node.durationMap) {
+            if (durationMs != 0) {
+                continue;
+            }
+
+            const auto ownedIt = ownedIndexById.find(memberId);
+
+            graph.chordMembers.push_back({ memberId, ownedIt != ownedIndexById.end() ? ownedIt->second : -1 });
+        }
+    }
+
+    graph.chordOffsets.push_back(static_cast<int>(graph.chordMembers.size()));
+
+    std::vector<int>          frontier;
+    std::vector<std::uint8_t> discovered(nodeCount, 0);
+    std::vector<int>          discoveredIndices;
+
+    for (std::size_t start = 0; start < nodeCount; ++start) {
+        if (!graph.ownsNode(static_cast<int>(start))) {
+            continue;
+        }
+
+        bool isTree = true;
+
+        frontier.assign(1, static_cast<int>(start));
+        discoveredIndices.clear();
+
+        while (isTree && !frontier.empty()) {
+            const int chainIndex = frontier.back();
+            frontier.pop_back();
+
+            for (const auto& member : graph.chordMembersOf(chainIndex)) {
+                if (member.nodeIndex == -1) {
+                    isTree = false;
+                    break;
+                }
+
+                if (graph.countLimits[static_cast<std::size_t>(member.nodeIndex)] <= 0) {
+                    continue;
+                }
+
+                if (member.nodeIndex == static_cast<int>(start) || discovered[static_cast<std::size_t>(member.nodeIndex)] != 0
+                    || static_cast<int>(discoveredIndices.size()) == RTCompiledGraph::maxTreeChordClosure) {
+                    isTree = false;
+                    break;
+                }
+
+                discovered[static_cast<std::size_t>(member.nodeIndex)] = 1;
+                discoveredIndices.push_back(member.nodeIndex);
+                frontier.push_back(member.nodeIndex);
+            }
+        }
+
+        for (const int index : discoveredIndices) {
+            discovered[static_cast<std::size_t>(index)] = 0;
+        }
+
+        graph.chordClosureIsTree[start] = isTree ? 1 : 0;
+    }
+}
+
+void buildPeriodicSelection(RTCompiledGraph& graph, int nodeIndex)
+{
+    const RTNode& parent    = graph.nodeAt(nodeIndex);
+    const int     firstEdge = graph.firstEdge(nodeIndex);
+    const int     edgeCount = graph.edgeEnd(nodeIndex) - firstEdge;
+
+    if (edgeCount > std::numeric_limits<std::int16_t>::max()) {
+        return;
+    }
+
+    std::vector<int> candidates;
+    candidates.reserve(static_cast<std::size_t>(edgeCount));
+
+    int period = 1;
+
+    RTCompiledGraph::PeriodicSelection selection;
+
+    for (int edge = firstEdge; edge < firstEdge + edgeCount; ++edge) {
+        const auto edgeIndex = static_cast<std::size_t>(edge);
+
+        if (graph.edgeIsTreeJump[edgeIndex] != 0) {
+            continue;
+        }
+
+        const int childIndex = graph.edgeChildIndices[edgeIndex];
+
+        if (childIndex == -1 || hasDisabledTraversals(parent, graph.edgeChildIds[edgeIndex])) {
+            return;
+        }
+
+        const int countLimit = graph.countLimits[static_cast<std::size_t>(childIndex)];
+
+        if (countLimit <= 0 || graph.edgeDurations[edgeIndex] == 0) {
+            continue;
+        }
+
+        if (graph.triggerLimits[static_cast<std::size_t>(childIndex)] > 0) {
+            return;
+        }
+
+        period = std::lcm(period, countLimit);
+
+        if (period > RTCompiledGraph::maxSelectionPeriod) {
+            return;
+        }
+
+        const RTNode::NodeType type = graph.nodeTypes[static_cast<std::size_t>(childIndex)];
+        const auto typeEnd = selection.types.begin() + selection.typeCount;
+
+        if (std::find(selection.types.begin(), typeEnd, type) == typeEnd) {
+            selection.types[static_cast<std::size_t>(selection.typeCount++)] = type;
+        }
+
+        candidates.push_back(edge);
+    }
+
+    selection.period = period;
+    selection.offset = static_cast<int>(graph.periodicSelectionChoices.size());
+
+    graph.periodicSelectionChoices.resize(graph.periodicSelectionChoices.size()
+                                              + static_cast<std::size_t>(period * selection.typeCount), -1);
+
+    for (int residue = 0; residue < period; ++residue) {
+        std::int16_t* choices = graph.periodicSelectionChoices.data() + selection.offset + residue * selection.typeCount;
+
+        for (int typeSlot = 0; typeSlot < selection.typeCount; ++typeSlot) {
+            int maxLimit = 0;
+
+            for (const int edge : candidates) {
+                const int childIndex = graph.edgeChildIndices[static_cast<std::size_t>(edge)];
+                const int countLimit = graph.countLimits[static_cast<std::size_t>(childIndex)];
+
+                if (graph.nodeTypes[static_cast<std::size_t>(childIndex)] != selection.types[static_cast<std::size_t>(typeSlot)]) {
+                    continue;
+                }
+
+                if (residue % countLimit == 0 && countLimit > maxLimit) {
+                    choices[typeSlot] = static_cast<std::int16_t>(edge - firstEdge);
+                    maxLimit          = countLimit;
+                }
+            }
+        }
+    }
+
+    graph.periodicSelections[static_cast<std::size_t>(nodeIndex)] = selection;
+}
+
+}
+
+bool RTCompiledGraph::isTraversalDisabled(int nodeIndex, int edge, int traversalId) const
+{
+    if (traversalId >= 0 && traversalId < maskedTraversalIds) {
+        return (edgeDisabledMasks[static_cast<std::size_t>(edge)] >> traversalId) & 1u;
+    }
+
+    const RTNode& parent = nodeAt(nodeIndex);
+
+    const auto disabledIt = parent.disabledTraversalsByChild.find(edgeChildIds[static_cast<std::size_t>(edge)]);
+
+    return disabledIt != parent.disabledTraversalsByChild.end()
+        && disabledIt->second.count(traversalId) > 0;
+}
+
+int RTCompiledGraph::edgeDuration(int nodeIndex, int edge, int targetId) const
+{
+    if (edge < firstEdge(nodeIndex) || edge >= edgeEnd(nodeIndex)
+        || edgeChildIds[static_cast<std::size_t>(edge)] != targetId) {
+        return noDuration;
+    }
+
+    return edgeDurations[static_cast<std::size_t>(edge)];
+}
+
+int RTCompiledGraph::danglingDuration(int nodeIndex, int traversalId) const
+{
+    const auto index = static_cast<std::size_t>(nodeIndex);
+
+    const int durationMs = danglingDurations[index];
+
+    if (durationMs <= 0) {
+        return noDuration;
+    }
+
+    if (traversalId >= 0 && traversalId < maskedTraversalIds) {
+        return ((danglingDisabledMasks[index] >> traversalId) & 1u) != 0 ? noDuration : durationMs;
+    }
+
+    const RTNode& node = nodeAt(nodeIndex);
+
+    const auto disabledIt = node.disabledTraversalsByChild.find(node.nodeID);
+
+    if (disabledIt != node.disabledTraversalsByChild.end() && disabledIt->second.count(traversalId) > 0) {
+        return noDuration;
+    }
+
+    return durationMs;
+}
+
+void RTCompiledGraph::patchDuration(int nodeIndex, int edge, int keyId, int durationMs)
+{
+    RTNode& node = entries[static_cast<std::size_t>(nodeIndex)].second;
+
+    const auto durationIt = node.durationMap.find(keyId);
+    if (durationIt != node.durationMap.end()) {
+        if ((durationIt->second == 0) != (durationMs == 0)) {
+            chordListsStale = true;
+        }
+
+        durationIt->second = durationMs;
+
+        if (keyId == node.nodeID) {
+            danglingDurations[static_cast<std::size_t>(nodeIndex)] = durationMs;
+        }
+
+        if (keyId == node.parentId && node.isAlternativeNode) {
+            alternativeDurations[static_cast<std::size_t>(nodeIndex)] = durationMs;
+        }
+    }
+
+    if (edge >= firstEdge(nodeIndex) && edge < edgeEnd(nodeIndex)
+        && edgeChildIds[static_cast<std::size_t>(edge)] == keyId) {
+        int& edgeDuration = edgeDurations[static_cast<std::size_t>(edge)];
+
+        if ((edgeDuration == 0) != (durationMs == 0)) {
+            periodicSelections[static_cast<std::size_t>(nodeIndex)].period = 0;
+        }
+
+        edgeDuration = durationMs;
+    }
+}
+
+RTCompiledGraph RTCompiledGraph::compile(const NodeMap& nodes, int graphID)
+{
+    RTCompiledGraph graph;
+
+    graph.graphID = graphID;
+
+    const std::size_t nodeCount = nodes.size();
+
+    graph.entries.reserve(nodeCount);
+
+    for (const auto& [nodeId, node] : nodes) {
+        graph.entries.emplace_back(nodeId, node);
+    }
+
+    std::sort(graph.entries.begin(), graph.entries.end(),
+              [](const Entry& left, const Entry& right) { return left.first < right.first; });
+
+    std::unordered_map<int, int> ownedIndexById;
+    ownedIndexById.reserve(nodeCount);
+
+    graph.nodeIds      .reserve(nodeCount);
+    graph.nodeTypes    .reserve(nodeCount);
+    graph.countLimits  .reserve(nodeCount);
+    graph.triggerLimits.reserve(nodeCount);
+    graph.edgeOffsets  .reserve(nodeCount + 1);
+
+    for (std::size_t index = 0; index < nodeCount; ++index) {
+        auto& [nodeId, node] = graph.entries[index];
+
+        node.denseIndex = static_cast<int>(index);
+
+        if (node.graphID == graphID) {
+            ownedIndexById[nodeId] = static_cast<int>(index);
+        }
+
+        graph.nodeIds      .push_back(nodeId);
+        graph.nodeTypes    .push_back(node.nodeType);
+        graph.countLimits  .push_back(node.countLimit);
+        graph.triggerLimits.push_back(node.triggerLimit);
+    }
+
+    for (const auto& [nodeId, node] : graph.entries) {
+        graph.edgeOffsets.push_back(static_cast<int>(graph.edgeChildIds.size()));
+
+        for (const int childId : node.children) {
+            const auto durationIt = node.durationMap.find(childId);
+            const auto ownedIt    = ownedIndexById.find(childId);
+
+            graph.edgeChildIds     .push_back(childId);
+            graph.edgeChildIndices .push_back(ownedIt != ownedIndexById.end() ? ownedIt->second : -1);
+            graph.edgeDurations    .push_back(durationIt != node.durationMap.end() ? durationIt->second : noDuration);
+            graph.edgeDisabledMasks.push_back(disabledMaskFor(node, childId));
+            graph.edgeIsTreeJump   .push_back(node.treeJumpChildren.count(childId) > 0 ? 1 : 0);
+        }
+    }
+
+    graph.edgeOffsets.push_back(static_cast<int>(graph.edgeChildIds.size()));
+
+    buildNodeDurations(graph);
+    buildTreeIntervals(graph, ownedIndexById);
+    buildChordMembers (graph, ownedIndexById);
+
+    graph.periodicSelections.resize(nodeCount);
+
+    for (std::size_t index = 0; index < nodeCount; ++index) {
+        if (graph.ownsNode(static_cast<int>(index))) {
+            buildPeriodicSelection(graph, static_cast<int>(index));
+        }
+    }
+
+    return graph;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "RTData.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+struct RTCompiledGraph
+{
+    using Entry          = std::pair<int, RTNode>;
+    using const_iterator = std::vector<Entry>::const_iterator;
+
+    static constexpr int noDuration         = -1;
+    static constexpr int maskedTraversalIds = 64;
+    static constexpr int maxSelectionPeriod = 128;
+    static constexpr int nodeTypeCount      = static_cast<int>(RTNode::NodeType::TraversalFlagData) + 1;
+
+    static constexpr int maxTreeChordClosure = 256;
+
+    struct ChordMember
+    {
+        int nodeId    = 0;
+        int nodeIndex = -1;
+    };
+
+    struct PeriodicSelection
+    {
+        int period    = 0;
+        int offset    = 0;
+        int typeCount = 0;
+
+        std::array<RTNode::NodeType, nodeTypeCount> types {};
+    };
+
+    int           graphID  = 0;
+    std::uint64_t revision = 0;
+
+    std::vector<Entry> entries;
+
+    std::vector<int>              nodeIds;
+    std::vector<RTNode::NodeType> nodeTypes;
+    std::vector<int>              countLimits;
+    std::vector<int>              triggerLimits;
+
+    std::vector<int>           edgeOffsets;
+    std::vector<int>           edgeChildIds;
+    std::vector<int>           edgeChildIndices;
+    std::vector<int>           edgeDurations;
+    std::vector<std::uint64_t> edgeDisabledMasks;
+    std::vector<std::uint8_t>  edgeIsTreeJump;
+
+    std::vector<int>           danglingDurations;
+    std::vector<int>           alternativeDurations;
+    std::vector<std::uint64_t> danglingDisabledMasks;
+
+    std::vector<int>          treeEnter;
+    std::vector<int>          treeExit;
+    std::vector<std::uint8_t> treeLeavesGraph;
+
+    std::vector<int>          chordOffsets;
+    std::vector<ChordMember>  chordMembers;
+    std::vector<std::uint8_t> chordClosureIsTree;
+    bool                      chordListsStale = false;
+
+    std::vector<PeriodicSelection> periodicSelections;
+    std::vector<std::int16_t>      periodicSelectionChoices;
+
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end()   const { return entries.end();   }
+
+    bool empty() const { return entries.empty(); }
+    int  size () const { return static_cast<int>(entries.size()); }
+
+    bool ownsNode(int index) const { return nodeAt(index).graphID == graphID; }
+
+    const RTNode& nodeAt(int index) const { return entries[static_cast<std::size_t>(index)].second; }
+
+    int firstEdge(int nodeIndex) const { return edgeOffsets[static_cast<std::size_t>(nodeIndex)];     }
+    int edgeEnd  (int nodeIndex) const { return edgeOffsets[static_cast<std::size_t>(nodeIndex) + 1]; }
+
+    std::span<const ChordMember> chordMembersOf(int nodeIndex) const
+    {
+        const auto first = static_cast<std::size_t>(chordOffsets[static_cast<std::size_t>(nodeIndex)]);
+        const auto last  = static_cast<std::size_t>(chordOffsets[static_cast<std::size_t>(nodeIndex) + 1]);
+
+        return { chordMembers.data() + first, last - first };
+    }
+
+    const PeriodicSelection& periodicSelectionAt(int nodeIndex) const
+    {
+        return periodicSelections[static_cast<std::size_t>(nodeIndex)];
+    }
+
+    bool isTreeDescendant(int nodeIndex, int ancestorIndex) const
+    {
+        const int enter = treeEnter[static_cast<std::size_t>(nodeIndex)];
+
+        return treeEnter[static_cast<std::size_t>(ancestorIndex)] < enter
+            && enter < treeExit[static_cast<std::size_t>(ancestorIndex)];
+    }
+
+    bool isTraversalDisabled(int nodeIndex, int edge, int traversalId) const;
+
+    int edgeDuration    (int nodeIndex, int edge, int targetId) const;
+    int danglingDuration(int nodeIndex, int traversalId)        const;
+
+    int alternativeDuration(int nodeIndex) const { return alternativeDurations[static_cast<std::size_t>(nodeIndex)]; }
+
+    void patchDuration(int nodeIndex, int edge, int keyId, int durationMs);
+
+    static RTCompiledGraph compile(const NodeMap& nodes, int graphID);
+};
@@ -34,6 +34,7 @@ struct RTtraversal {
     int channel = 1;
     int transpose = 0;
     double velocityMultiplier = 1.0;
+    int ruleIndex = -1;
 };
 
 struct RTNode {
@@ -74,6 +75,8 @@ struct RTNode {
     RTtraversal flagTraversal;
 
     int graphID = 0;
+
+    int denseIndex = -1;
 };
 
 
@@ -12,20 +12,20 @@
 
 #include <unordered_set>
 
-#include "../Plugin/PluginProcessor.h"
+#include "../Audio/SequenceTreeEngine.h"
 #include "ValueTreeState.h"
 #include "ValueTreeIdentifiers.h"
 
 
-RTGraphBuilder::RTGraphBuilder(SequenceTreeAudioProcessor& processorRef, ValueTreeState& valueTreeStateRef)
-    : processor(processorRef), valueTreeState(valueTreeStateRef)
+RTGraphBuilder::RTGraphBuilder(SequenceTreeEngine& engineRef, ValueTreeState& valueTreeStateRef)
+    : engine(engineRef), valueTreeState(valueTreeStateRef)
 {
 }
 
-static juce::Point<int> nodeCentre(const juce::ValueTree& nodeValueTree)
+static NodePosition nodeCentre(const juce::ValueTree& nodeValueTree)
 {
     return { (int) nodeValueTree.getProperty(ValueTreeIdentifiers::XPosition),
-             (int) nodeValueTree.getProperty(ValueTreeIdentifiers::YPosition) };
+             (int) nodeValueTree.getProperty(ValueTreeIdentifiers::YPosition), 0 };
 }
 
 static void collectDisabledTraversals(const juce::ValueTree& owner, std::unordered_set<int>& disabledSet)
@@ -61,18 +61,73 @@ static bool isTreeJumpConnection(const juce::ValueTree& parentValueTree,
     return (int) parentValueTree.getProperty(ValueTreeIdentifiers::RootNodeId) != childId;
 }
 
-void RTGraphBuilder::fillDurationMap(const juce::ValueTree& nodeValueTree, RTNode& rtNode)
+void RTGraphBuilder::NodeLookup::buildIndex()
+{
+    const juce::ValueTree& nodeMap = valueTreeState.nodeMap;
+
+    nodesById  .reserve(static_cast<std::size_t>(nodeMap.getNumChildren()));
+    parentsById.reserve(static_cast<std::size_t>(nodeMap.getNumChildren()));
+
+    for (int i = 0; i < nodeMap.getNumChildren(); ++i) {
+        const juce::ValueTree node = nodeMap.getChild(i);
+
+        nodesById.try_emplace((int) node.getProperty(ValueTreeIdentifiers::Id), node);
+
+        if (node.getType() == ValueTreeIdentifiers::TraversalFlagData) {
+            continue;
+        }
+
+        const juce::ValueTree childIds = node.getChildWithName(ValueTreeIdentifiers::NodeChildrenIds);
+
+        for (int j = 0; j < childIds.getNumChildren(); ++j) {
+            parentsById.try_emplace((int) childIds.getChild(j).getProperty(ValueTreeIdentifiers::Id), node);
+        }
+    }
+
+    indexed = true;
+}
+
+juce::ValueTree RTGraphBuilder::NodeLookup::node(int nodeId) const
+{
+    if (!indexed) {
+        return valueTreeState.getNode(nodeId);
+    }
+
+    const auto nodeIt = nodesById.find(nodeId);
+    return nodeIt != nodesById.end() ? nodeIt->second : juce::ValueTree();
+}
+
+juce::ValueTree RTGraphBuilder::NodeLookup::parent(int nodeId) const
+{
+    if (!indexed) {
+        return valueTreeState.getNodeParent(nodeId);
+    }
+
+    const auto parentIt = parentsById.find(nodeId);
+    return parentIt != parentsById.end() ? parentIt->second : juce::ValueTree();
+}
+
+RTGraphBuilder::NodeLookup RTGraphBuilder::indexedLookup() const
+{
+    NodeLookup lookup { valueTreeState };
+    lookup.buildIndex();
+
+    return lookup;
+}
+
+void RTGraphBuilder::fillDurationMap(const juce::ValueTree& nodeValueTree, RTNode& rtNode, const NodeLookup& lookup)
 {
     const bool isAlternative = (nodeValueTree.getType() == ValueTreeIdentifiers::AlternativeNodeData);
-    const juce::Point<int> centre = nodeCentre(nodeValueTree);
+    const NodePosition centre = nodeCentre(nodeValueTree);
 
     auto durationTo = [&](const juce::ValueTree& other) {
-        const juce::Point<int> delta = nodeCentre(other) - centre;
-        return arrowDurationFromDelta(delta.x, delta.y, isAlternative);
+        const NodePosition position = nodeCentre(other);
+        return arrowDurationFromDelta(position.xPosition - centre.xPosition,
+                                      position.yPosition - centre.yPosition, isAlternative);
     };
 
     if (isAlternative) {
-        juce::ValueTree parent = valueTreeState.getNodeParent(rtNode.nodeID);
+        juce::ValueTree parent = lookup.parent(rtNode.nodeID);
 
         if (parent.isValid()) {
             rtNode.durationMap[(int) parent.getProperty(ValueTreeIdentifiers::Id)] = durationTo(parent);
@@ -83,7 +138,7 @@ void RTGraphBuilder::fillDurationMap(const juce::ValueTree& nodeValueTree, RTNod
 
     for (int i = 0; i < childIds.getNumChildren(); i++) {
         const int childId = childIds.getChild(i).getProperty(ValueTreeIdentifiers::Id);
-        juce::ValueTree childTree = valueTreeState.getNode(childId);
+        juce::ValueTree childTree = lookup.node(childId);
 
         if (!childTree.isValid() || childTree.getType() == ValueTreeIdentifiers::AlternativeNodeData) {
             continue;
@@ -117,18 +172,27 @@ void RTGraphBuilder::makeRTGraph(const juce::ValueTree& nodeValueTree)
         return;
     }
 
+    makeRTGraph(nodeValueTree, indexedLookup());
+}
+
+void RTGraphBuilder::makeRTGraph(const juce::ValueTree& nodeValueTree, const NodeLookup& lookup)
+{
+    if (!nodeValueTree.isValid()) {
+        return;
+    }
+
     int rootNodeId = nodeValueTree.getProperty(ValueTreeIdentifiers::RootNodeId);
     if (rootNodeId == 0) {
         return;
     }
 
-    juce::ValueTree rootNodeValueTree = valueTreeState.getNode(rootNodeId);
+    juce::ValueTree rootNodeValueTree = lookup.node(rootNodeId);
 
     if (!rootNodeValueTree.isValid()) {
         rtGraphs.erase(rootNodeId);
         auto emptyGraph = std::make_shared<RTGraph>();
         emptyGraph->graphID = rootNodeId;
-        processor.setNewGraph(emptyGraph);
+        engine.setNewGraph(emptyGraph);
         return;
     }
 
@@ -138,11 +202,11 @@ void RTGraphBuilder::makeRTGraph(const juce::ValueTree& nodeValueTree)
     rtGraph->graphID   = rootNodeId;
     rtGraph->loopLimit = rootNodeValueTree.getProperty(ValueTreeIdentifiers::LoopLimit, 0);
 
-    createRTNodes(rootNodeValueTree, rtGraph, tempNodeMap);
-    createRTNodeConnections(rtGraph, tempNodeMap);
+    createRTNodes(rootNodeValueTree, rtGraph, tempNodeMap, lookup);
+    createRTNodeConnections(rtGraph, tempNodeMap, lookup);
 
     rtGraphs[rtGraph->graphID] = rtGraph;
-    processor.setNewGraph(rtGraph);
+    engine.setNewGraph(rtGraph);
 }
 
 void RTGraphBuilder::rebuildGraphsForTraversal(int traversalId)
@@ -173,18 +237,20 @@ void RTGraphBuilder::rebuildGraphsForTraversal(int traversalId)
         }
     }
 
+    const NodeLookup lookup = indexedLookup();
+
     for (int rootId : rootsToRebuild) {
-        makeRTGraph(valueTreeState.getNode(rootId));
+        makeRTGraph(lookup.node(rootId), lookup);
     }
 }
 
-void RTGraphBuilder::createRTNodes(juce::ValueTree rootNodeValueTree, std::shared_ptr<RTGraph> rtGraph, std::unordered_map<int, juce::ValueTree>& tempNodeMap) {
+void RTGraphBuilder::createRTNodes(juce::ValueTree rootNodeValueTree, std::shared_ptr<RTGraph> rtGraph, std::unordered_map<int, juce::ValueTree>& tempNodeMap, const NodeLookup& lookup) {
     std::vector<juce::ValueTree> stack = {rootNodeValueTree};
 
     while(!stack.empty()) {
 
         juce::ValueTree currentValueTree = stack.back();
-        juce::ValueTree nodeParentValueTree = valueTreeState.getNodeParent(currentValueTree.getProperty(ValueTreeIdentifiers::Id));
+        juce::ValueTree nodeParentValueTree = lookup.parent(currentValueTree.getProperty(ValueTreeIdentifiers::Id));
 
         juce::ValueTree nodeValueTreeChildren = currentValueTree.getChildWithName(ValueTreeIdentifiers::NodeChildrenIds);
         juce::ValueTree nodeValueTreeTraversals = currentValueTree.getChildWithName(ValueTreeIdentifiers::TraversalChildrenIds);
@@ -253,7 +319,7 @@ void RTGraphBuilder::createRTNodes(juce::ValueTree rootNodeValueTree, std::share
                 }
             }
 
-            fillDurationMap(currentValueTree, rtNode);
+            fillDurationMap(currentValueTree, rtNode, lookup);
 
 
             if (nodeType == ValueTreeIdentifiers::NodeData) {
@@ -318,7 +384,7 @@ void RTGraphBuilder::createRTNodes(juce::ValueTree rootNodeValueTree, std::share
                 for (int i = 0; i < nodeValueTreeChildren.getNumChildren(); i++) {
                     juce::ValueTree childIdTree = nodeValueTreeChildren.getChild(i);
                     int childId = childIdTree.getProperty(ValueTreeIdentifiers::Id);
-                    juce::ValueTree childDataTree = valueTreeState.getNode(childId);
+                    juce::ValueTree childDataTree = lookup.node(childId);
 
                     jassert(childDataTree.isValid());
                     stack.push_back(childDataTree);
@@ -330,7 +396,7 @@ void RTGraphBuilder::createRTNodes(juce::ValueTree rootNodeValueTree, std::share
     }
 }
 
-void RTGraphBuilder::createRTNodeConnections(std::shared_ptr<RTGraph> rtGraph, std::unordered_map<int, juce::ValueTree>& tempNodeMap)
+void RTGraphBuilder::createRTNodeConnections(std::shared_ptr<RTGraph> rtGraph, std::unordered_map<int, juce::ValueTree>& tempNodeMap, const NodeLookup& lookup)
 {
     for (auto& [id, nodeValueTree] : tempNodeMap) {
         if (nodeValueTree.getType() == ValueTreeIdentifiers::TraversalFlagData) {
@@ -343,7 +409,7 @@ void RTGraphBuilder::createRTNodeConnections(std::shared_ptr<RTGraph> rtGraph, s
             juce::ValueTree childIdTree = nodeChildrenIds.getChild(i);
             int childId = childIdTree.getProperty(ValueTreeIdentifiers::Id);
 
-            juce::ValueTree childDataTree = valueTreeState.getNode(childId);
+            juce::ValueTree childDataTree = lookup.node(childId);
 
             if (!childDataTree.isValid()) {
                 continue;
@@ -380,6 +446,9 @@ RTtraversal RTGraphBuilder::buildRTtraversal(int traversalId)
         if (traversalData.hasProperty(ValueTreeIdentifiers::TraversalVelocity)) {
             rtTraversal.velocityMultiplier = traversalData.getProperty(ValueTreeIdentifiers::TraversalVelocity);
         }
+        if (traversalData.hasProperty(ValueTreeIdentifiers::SelectionRuleIndex)) {
+            rtTraversal.ruleIndex = traversalData.getProperty(ValueTreeIdentifiers::SelectionRuleIndex);
+        }
     }
 
     return rtTraversal;
@@ -387,8 +456,8 @@ RTtraversal RTGraphBuilder::buildRTtraversal(int traversalId)
 
 void RTGraphBuilder::updateDurationMap(int nodeId)
 {
-    const auto* snap = processor.getPublishedSnapshot();
-    if (!snap || !snap->globalNodes) {
+    const auto* snap = engine.getPublishedSnapshot();
+    if (!snap || !snap->rtGraphs) {
         return;
     }
 
@@ -397,37 +466,138 @@ void RTGraphBuilder::updateDurationMap(int nodeId)
         return;
     }
 
-    auto newSnap = std::make_shared<SequenceTreeAudioProcessor::AudioSnapshot>();
-    newSnap->globalNodes = std::make_shared<NodeMap>(*snap->globalNodes);
-    newSnap->rtGraphs    = snap->rtGraphs;
+    juce::ValueTree parentValueTree = valueTreeState.getNodeParent(nodeId);
+
+    std::vector<std::pair<int, juce::ValueTree>> targets { { nodeId, nodeValueTree } };
+
+    if (parentValueTree.isValid()) {
+        targets.emplace_back((int) parentValueTree.getProperty(ValueTreeIdentifiers::Id), parentValueTree);
+    }
+
+    if (!patchDurations(targets)) {
+        republishDurations(targets);
+    }
+}
+
+bool RTGraphBuilder::patchDurations(const std::vector<std::pair<int, juce::ValueTree>>& targets)
+{
+    const auto* snap = engine.getPublishedSnapshot();
+
+    std::vector<std::pair<RTNode*, RTNode>> refreshedNodes;
+    std::vector<DurationPatch>              patches;
+
+    for (const auto& [targetId, targetTree] : targets) {
+        const RTNodeRef owner = snap->nodes.ref(targetId);
+        if (!owner) {
+            continue;
+        }
+
+        auto graphIt = rtGraphs.find(owner.graph->graphID);
+        if (graphIt == rtGraphs.end()) {
+            return false;
+        }
+
+        auto sourceIt = graphIt->second->nodeMap.find(targetId);
+        if (sourceIt == graphIt->second->nodeMap.end()) {
+            return false;
+        }
+
+        RTNode& source = sourceIt->second;
+
+        RTNode refreshed;
+        refreshed.nodeID = targetId;
+        fillDurationMap(targetTree, refreshed, NodeLookup { valueTreeState });
+
+        if (refreshed.durationMap.size() != source.durationMap.size()) {
+            return false;
+        }
+
+        for (const auto& [childId, disabledIds] : refreshed.disabledTraversalsByChild) {
+            const auto sourceDisabledIt = source.disabledTraversalsByChild.find(childId);
+
+            if (sourceDisabledIt == source.disabledTraversalsByChild.end() || sourceDisabledIt->second != disabledIds) {
+                return false;
+            }
+        }
+
+        for (const auto& [keyId, durationMs] : refreshed.durationMap) {
+            auto durationIt = source.durationMap.find(keyId);
+            if (durationIt == source.durationMap.end()) {
+                return false;
+            }
+
+            if (durationIt->second == durationMs) {
+                continue;
+            }
+
+            int edgeIndex = -1;
+
+            for (int edge = owner.graph->firstEdge(owner.index); edge < owner.graph->edgeEnd(owner.index); ++edge) {
+                if (owner.graph->edgeChildIds[static_cast<std::size_t>(edge)] == keyId) {
+                    edgeIndex = edge;
+                    break;
+                }
+            }
+
+            patches.push_back({ targetId, owner.index, edgeIndex, keyId, durationMs, owner.graph->revision });
+        }
+
+        refreshedNodes.emplace_back(&source, std::move(refreshed));
+    }
+
+    if (!engine.pushDurationPatches(patches)) {
+        return false;
+    }
+
+    for (auto& [source, refreshed] : refreshedNodes) {
+        source->durationMap = std::move(refreshed.durationMap);
+    }
+
+    return true;
+}
+
+void RTGraphBuilder::republishDurations(const std::vector<std::pair<int, juce::ValueTree>>& targets)
+{
+    const auto* snap = engine.getPublishedSnapshot();
+
+    std::unordered_map<int, std::shared_ptr<RTGraph>> patchedGraphs;
 
-    auto refresh = [&](int targetId, const juce::ValueTree& targetTree) {
-        auto globalNodeIt = newSnap->globalNodes->find(targetId);
-        if (globalNodeIt == newSnap->globalNodes->end()) {
-            return;
+    for (const auto& [targetId, targetTree] : targets) {
+        const RTNodeRef owner = snap->nodes.ref(targetId);
+        if (!owner) {
+            continue;
         }
 
-        globalNodeIt->second.durationMap.clear();
-        fillDurationMap(targetTree, globalNodeIt->second);
-    };
+        auto graphIt = rtGraphs.find(owner.graph->graphID);
+        if (graphIt == rtGraphs.end()) {
+            continue;
+        }
+
+        auto nodeIt = graphIt->second->nodeMap.find(targetId);
+        if (nodeIt == graphIt->second->nodeMap.end()) {
+            continue;
+        }
 
-    refresh(nodeId, nodeValueTree);
+        nodeIt->second.durationMap.clear();
+        fillDurationMap(targetTree, nodeIt->second, NodeLookup { valueTreeState });
 
-    juce::ValueTree parentValueTree = valueTreeState.getNodeParent(nodeId);
-    if (parentValueTree.isValid()) {
-        refresh((int) parentValueTree.getProperty(ValueTreeIdentifiers::Id), parentValueTree);
+        patchedGraphs.emplace(graphIt->first, graphIt->second);
     }
 
-    processor.publishAudioSnapshot(newSnap);
+    for (auto& [graphId, graph] : patchedGraphs) {
+        engine.setNewGraph(graph);
+    }
 }
 
 void RTGraphBuilder::rebuildAllGraphs()
 {
+    const NodeLookup lookup = indexedLookup();
+
     for (int i = 0; i < valueTreeState.nodeMap.getNumChildren(); ++i) {
         juce::ValueTree node = valueTreeState.nodeMap.getChild(i);
 
         if (node.getType() == ValueTreeIdentifiers::RootNodeData) {
-            makeRTGraph(node);
+            makeRTGraph(node, lookup);
         }
     }
 }
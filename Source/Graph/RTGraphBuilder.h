@@ -10,19 +10,21 @@
 
 #pragma once
 
-#include "../Util/PluginModules.h"
+#include "../Util/CoreModules.h"
 #include "RTData.h"
 
 #include <memory>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
-class SequenceTreeAudioProcessor;
+class SequenceTreeEngine;
 class ValueTreeState;
 
 class RTGraphBuilder
 {
 public:
-    RTGraphBuilder(SequenceTreeAudioProcessor& processor, ValueTreeState& valueTreeState);
+    RTGraphBuilder(SequenceTreeEngine& engine, ValueTreeState& valueTreeState);
 
     void makeRTGraph(const juce::ValueTree& nodeValueTree);
     void rebuildAllGraphs();
@@ -31,19 +33,46 @@ public:
     std::unordered_map<int, std::shared_ptr<RTGraph>> rtGraphs;
 
 private:
+    class NodeLookup
+    {
+    public:
+        explicit NodeLookup(ValueTreeState& state) : valueTreeState(state) {}
+
+        void buildIndex();
+
+        juce::ValueTree node  (int nodeId) const;
+        juce::ValueTree parent(int nodeId) const;
+
+    private:
+        ValueTreeState& valueTreeState;
+        bool            indexed = false;
+
+        std::unordered_map<int, juce::ValueTree> nodesById;
+        std::unordered_map<int, juce::ValueTree> parentsById;
+    };
+
+    NodeLookup indexedLookup() const;
+
+    void makeRTGraph(const juce::ValueTree& nodeValueTree, const NodeLookup& lookup);
+
     void createRTNodes(juce::ValueTree rootNodeValueTree,
                        std::shared_ptr<RTGraph> rtGraph,
-                       std::unordered_map<int, juce::ValueTree>& tempNodeMap);
+                       std::unordered_map<int, juce::ValueTree>& tempNodeMap,
+                       const NodeLookup& lookup);
 
     void createRTNodeConnections(std::shared_ptr<RTGraph> rtGraph,
-                                 std::unordered_map<int, juce::ValueTree>& tempNodeMap);
+                                 std::unordered_map<int, juce::ValueTree>& tempNodeMap,
+                                 const NodeLookup& lookup);
+
+    void fillDurationMap(const juce::ValueTree& nodeValueTree, RTNode& rtNode, const NodeLookup& lookup);
 
-    void fillDurationMap(const juce::ValueTree& nodeValueTree, RTNode& rtNode);
+    bool patchDurations    (const std::vector<std::pair<int, juce::ValueTree>>& targets);
+    void republishDurations(const std::vector<std::pair<int, juce::ValueTree>>& targets);
 
     RTtraversal buildRTtraversal(int traversalId);
 
     void rebuildGraphsForTraversal(int traversalId);
 
-    SequenceTreeAudioProcessor& processor;
-    ValueTreeState&             valueTreeState;
+    SequenceTreeEngine& engine;
+    ValueTreeState&     valueTreeState;
 };
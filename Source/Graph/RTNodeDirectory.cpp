@@ -0,0 +1,288 @@
+#include "RTNodeDirectory.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+RTNodeDirectory::const_iterator RTNodeDirectory::find(int nodeId) const
+{
+    const RTNodeRef nodeRef = ref(nodeId);
+
+    if (!nodeRef) {
+        return end();
+    }
+
+    return &nodeRef.graph->entries[static_cast<std::size_t>(nodeRef.index)];
+}
+
+const RTNode& RTNodeDirectory::at(int nodeId) const
+{
+    const RTNodeRef nodeRef = ref(nodeId);
+
+    if (!nodeRef) {
+        throw std::out_of_range("RTNodeDirectory::at");
+    }
+
+    return nodeRef.node();
+}
+
+bool RTNodeDirectory::isDescendantOf(int nodeId, int ancestorId) const
+{
+    if (ancestorId == -1 || nodeId == ancestorId) {
+        return false;
+    }
+
+    const RTNodeRef nodeRef = ref(nodeId);
+
+    if (!nodeRef) {
+        return false;
+    }
+
+    const RTCompiledGraph& graph = *nodeRef.graph;
+    const auto             index = static_cast<std::size_t>(nodeRef.index);
+
+    if (graph.treeEnter[index] != -1 && graph.treeLeavesGraph[index] == 0) {
+        const RTNodeRef ancestorRef = ref(ancestorId);
+
+        return ancestorRef.graph == nodeRef.graph && graph.isTreeDescendant(nodeRef.index, ancestorRef.index);
+    }
+
+    int current = nodeId;
+    int guard   = 0;
+
+    while (current != 0 && guard++ < 10000) {
+        const RTNodeRef currentRef = ref(current);
+        if (!currentRef) {
+            return false;
+        }
+
+        const int parent = currentRef.node().parentId;
+        if (parent == ancestorId) {
+            return true;
+        }
+
+        current = parent;
+    }
+
+    return false;
+}
+
+template <typename PageType>
+class RTNodeDirectory::PageWriter
+{
+public:
+
+    explicit PageWriter(std::vector<std::shared_ptr<const PageType>>& target)
+        : pages(target), writable(target.size(), nullptr) {}
+
+    typename PageType::value_type& operator[](int nodeId)
+    {
+        const auto pageIndex = static_cast<std::size_t>(nodeId >> pageBits);
+
+        if (pageIndex >= pages.size()) {
+            pages.resize(pageIndex + 1);
+            writable.resize(pageIndex + 1, nullptr);
+        }
+
+        if (writable[pageIndex] == nullptr) {
+            auto copy = pages[pageIndex] != nullptr ? std::make_shared<PageType>(*pages[pageIndex])
+                                                    : std::make_shared<PageType>();
+
+            writable[pageIndex] = copy.get();
+            pages[pageIndex]    = std::move(copy);
+        }
+
+        return (*writable[pageIndex])[static_cast<std::size_t>(nodeId & (pageSize - 1))];
+    }
+
+private:
+
+    std::vector<std::shared_ptr<const PageType>>& pages;
+    std::vector<PageType*>                        writable;
+};
+
+int RTNodeDirectory::inDegree(int nodeId) const
+{
+    if (nodeId < 0) {
+        return 0;
+    }
+
+    const auto pageIndex = static_cast<std::size_t>(nodeId >> pageBits);
+
+    if (pageIndex >= degreePages.size() || degreePages[pageIndex] == nullptr) {
+        return 0;
+    }
+
+    return (*degreePages[pageIndex])[static_cast<std::size_t>(nodeId & (pageSize - 1))];
+}
+
+bool RTNodeDirectory::isEntryRoot(int nodeId) const
+{
+    const RTNodeRef nodeRef = ref(nodeId);
+
+    return nodeRef && nodeRef.node().graphID == nodeId && inDegree(nodeId) == 0;
+}
+
+void RTNodeDirectory::updateLinks(const RTNodeDirectory& previous, std::vector<int>& changedIds)
+{
+    std::sort(changedIds.begin(), changedIds.end());
+    changedIds.erase(std::unique(changedIds.begin(), changedIds.end()), changedIds.end());
+
+    PageWriter<DegreePage> degrees(degreePages);
+
+    std::vector<int> touchedIds;
+
+    auto countEdges = [&](const RTNodeRef& parent, int delta) {
+        const RTCompiledGraph& graph = *parent.graph;
+
+        for (int edge = graph.firstEdge(parent.index); edge < graph.edgeEnd(parent.index); ++edge) {
+            const int childId = graph.edgeChildIds[static_cast<std::size_t>(edge)];
+
+            if (childId >= 0) {
+                degrees[childId] += delta;
+                touchedIds.push_back(childId);
+            }
+        }
+    };
+
+    for (const int nodeId : changedIds) {
+        const RTNodeRef before = previous.ref(nodeId);
+        const RTNodeRef after  = ref(nodeId);
+
+        if (before.graph == after.graph && before.index == after.index) {
+            continue;
+        }
+
+        if (before) {
+            countEdges(before, -1);
+        }
+
+        if (after) {
+            countEdges(after, 1);
+        }
+
+        touchedIds.push_back(nodeId);
+    }
+
+    std::sort(touchedIds.begin(), touchedIds.end());
+    touchedIds.erase(std::unique(touchedIds.begin(), touchedIds.end()), touchedIds.end());
+
+    std::shared_ptr<std::vector<int>> roots;
+
+    for (const int nodeId : touchedIds) {
+        const bool wasRoot = previous.isEntryRoot(nodeId);
+        const bool isRoot  = isEntryRoot(nodeId);
+
+        if (wasRoot == isRoot) {
+            continue;
+        }
+
+        if (roots == nullptr) {
+            roots = entryRoots != nullptr ? std::make_shared<std::vector<int>>(*entryRoots)
+                                          : std::make_shared<std::vector<int>>();
+        }
+
+        const auto position = std::lower_bound(roots->begin(), roots->end(), nodeId);
+
+        if (isRoot) {
+            roots->insert(position, nodeId);
+        } else {
+            roots->erase(position);
+        }
+    }
+
+    if (roots != nullptr) {
+        entryRoots = std::move(roots);
+    }
+}
+
+RTNodeDirectory RTNodeDirectory::withGraph(std::shared_ptr<RTCompiledGraph> graph) const
+{
+    RTNodeDirectory updated;
+
+    updated.graphs             = graphs;
+    updated.pages              = pages;
+    updated.degreePages        = degreePages;
+    updated.entryRoots         = entryRoots;
+    updated.freeStateIndices   = freeStateIndices;
+    updated.stateSlotHighWater = stateSlotHighWater;
+
+    PageWriter<Page> slots(updated.pages);
+
+    std::vector<int> changedIds;
+
+    const auto previousIt = graphs.find(graph->graphID);
+
+    const RTCompiledGraph* previous = previousIt != graphs.end() ? previousIt->second.get() : nullptr;
+
+    if (previous != nullptr) {
+        for (const int nodeId : previous->nodeIds) {
+            if (ref(nodeId).graph == previous) {
+                slots[nodeId].ref = {};
+                changedIds.push_back(nodeId);
+            }
+        }
+    }
+
+    for (int index = 0; index < graph->size(); ++index) {
+        const int nodeId = graph->nodeIds[static_cast<std::size_t>(index)];
+
+        if (nodeId < 0) {
+            continue;
+        }
+
+        if (graph->ownsNode(index) || !updated.ref(nodeId)) {
+            Slot& slot = slots[nodeId];
+
+            slot.ref = { graph.get(), index };
+            changedIds.push_back(nodeId);
+
+            if (slot.stateIndex == -1) {
+                if (updated.freeStateIndices.empty()) {
+                    slot.stateIndex = updated.stateSlotHighWater++;
+                } else {
+                    slot.stateIndex = updated.freeStateIndices.back();
+                    updated.freeStateIndices.pop_back();
+                }
+            }
+        }
+    }
+
+    if (previous != nullptr) {
+        for (const int nodeId : previous->nodeIds) {
+            if (ref(nodeId).graph == previous && !updated.ref(nodeId)) {
+                Slot& slot = slots[nodeId];
+
+                if (slot.stateIndex != -1) {
+                    updated.freeStateIndices.push_back(slot.stateIndex);
+                    slot.stateIndex = -1;
+                }
+            }
+        }
+    }
+
+    if (graph->empty()) {
+        updated.graphs.erase(graph->graphID);
+    } else {
+        updated.graphs[graph->graphID] = std::move(graph);
+    }
+
+    updated.updateLinks(*this, changedIds);
+
+    return updated;
+}
+
+void RTNodeDirectory::applyDurationPatch(const DurationPatch& patch)
+{
+    const RTNodeRef nodeRef = ref(patch.nodeId);
+
+    if (!nodeRef || nodeRef.index != patch.nodeIndex || nodeRef.graph->revision != patch.revision) {
+        return;
+    }
+
+    const auto graphIt = graphs.find(nodeRef.graph->graphID);
+    if (graphIt == graphs.end()) {
+        return;
+    }
+
+    graphIt->second->patchDuration(patch.nodeIndex, patch.edgeIndex, patch.keyId, patch.durationMs);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "RTCompiledGraph.h"
+
+#include <array>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+struct DurationPatch
+{
+    int           nodeId     = -1;
+    int           nodeIndex  = -1;
+    int           edgeIndex  = -1;
+    int           keyId      = -1;
+    int           durationMs = 0;
+    std::uint64_t revision   = 0;
+};
+
+struct RTNodeRef
+{
+    const RTCompiledGraph* graph = nullptr;
+    int                    index = -1;
+
+    explicit operator bool() const { return graph != nullptr; }
+
+    const RTNode&    node()         const { return graph->nodeAt(index); }
+    int              id()           const { return graph->nodeIds      [static_cast<std::size_t>(index)]; }
+    RTNode::NodeType type()         const { return graph->nodeTypes    [static_cast<std::size_t>(index)]; }
+    int              countLimit()   const { return graph->countLimits  [static_cast<std::size_t>(index)]; }
+    int              triggerLimit() const { return graph->triggerLimits[static_cast<std::size_t>(index)]; }
+};
+
+class RTNodeDirectory
+{
+public:
+    using Entry          = RTCompiledGraph::Entry;
+    using const_iterator = const Entry*;
+    using GraphMap       = std::unordered_map<int, std::shared_ptr<RTCompiledGraph>>;
+
+    const_iterator end() const { return nullptr; }
+
+    const_iterator find (int nodeId) const;
+    const RTNode&  at   (int nodeId) const;
+    std::size_t    count(int nodeId) const { return ref(nodeId) ? 1 : 0; }
+
+    RTNodeRef ref(int nodeId) const
+    {
+        if (nodeId < 0) {
+            return {};
+        }
+
+        const auto pageIndex = static_cast<std::size_t>(nodeId >> pageBits);
+
+        if (pageIndex >= pages.size() || pages[pageIndex] == nullptr) {
+            return {};
+        }
+
+        return (*pages[pageIndex])[static_cast<std::size_t>(nodeId & (pageSize - 1))].ref;
+    }
+
+    int stateIndexOf(int nodeId) const
+    {
+        if (nodeId < 0) {
+            return -1;
+        }
+
+        const auto pageIndex = static_cast<std::size_t>(nodeId >> pageBits);
+
+        if (pageIndex >= pages.size() || pages[pageIndex] == nullptr) {
+            return -1;
+        }
+
+        return (*pages[pageIndex])[static_cast<std::size_t>(nodeId & (pageSize - 1))].stateIndex;
+    }
+
+    int stateSlotCount() const { return stateSlotHighWater; }
+
+    RTNodeRef child(const RTCompiledGraph& graph, int edge) const
+    {
+        const int localIndex = graph.edgeChildIndices[static_cast<std::size_t>(edge)];
+
+        if (localIndex != -1) {
+            return { &graph, localIndex };
+        }
+
+        return ref(graph.edgeChildIds[static_cast<std::size_t>(edge)]);
+    }
+
+    const RTCompiledGraph& graphOf(const RTNode& node) const { return *ref(node.nodeID).graph; }
+
+    int edgeDuration(int nodeId, int edge, int targetId) const
+    {
+        const RTNodeRef nodeRef = ref(nodeId);
+
+        return nodeRef ? nodeRef.graph->edgeDuration(nodeRef.index, edge, targetId) : RTCompiledGraph::noDuration;
+    }
+
+    bool isDescendantOf(int nodeId, int ancestorId) const;
+
+    int inDegree(int nodeId) const;
+
+    std::span<const int> entryRootIds() const
+    {
+        return entryRoots != nullptr ? std::span<const int>(*entryRoots) : std::span<const int>();
+    }
+
+    template <typename Visitor>
+    void forEachNode(Visitor&& visit) const
+    {
+        for (const auto& page : pages) {
+            if (page == nullptr) {
+                continue;
+            }
+
+            for (const Slot& slot : *page) {
+                if (slot.ref) {
+                    visit(slot.ref);
+                }
+            }
+        }
+    }
+
+    RTNodeDirectory withGraph(std::shared_ptr<RTCompiledGraph> graph) const;
+
+    void applyDurationPatch(const DurationPatch& patch);
+
+private:
+    static constexpr int pageBits = 8;
+    static constexpr int pageSize = 1 << pageBits;
+
+    struct Slot
+    {
+        RTNodeRef ref;
+        int       stateIndex = -1;
+    };
+
+    using Page       = std::array<Slot, pageSize>;
+    using DegreePage = std::array<int, pageSize>;
+
+    template <typename PageType>
+    class PageWriter;
+
+    bool isEntryRoot(int nodeId) const;
+
+    void updateLinks(const RTNodeDirectory& previous, std::vector<int>& changedIds);
+
+    GraphMap                                       graphs;
+    std::vector<std::shared_ptr<const Page>>       pages;
+    std::vector<std::shared_ptr<const DegreePage>> degreePages;
+    std::shared_ptr<const std::vector<int>>        entryRoots;
+    std::vector<int>                         freeStateIndices;
+    int                                      stateSlotHighWater = 0;
+};
@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+    RuleCompileService.cpp
+    Created: 17 Oct 2026
+    Author:  Eli Baumgardner
+
+  ==============================================================================
+*/
+
+#include "RuleCompileService.h"
+#include "RTGraphBuilder.h"
+#include "ValueTreeIdentifiers.h"
+#include "ValueTreeState.h"
+#include "../Audio/SequenceTreeEngine.h"
+
+#include <array>
+#include <memory>
+
+RuleCompileService::RuleCompileService(SequenceTreeEngine& engine, ValueTreeState& valueTreeState, RTGraphBuilder& rtGraphBuilder)
+    : engine(engine), valueTreeState(valueTreeState), rtGraphBuilder(rtGraphBuilder)
+{
+}
+
+RuleCompileService::~RuleCompileService()
+{
+    compilerThread.removeAllJobs(true, 2000);
+}
+
+void RuleCompileService::compile(int traversalId, const juce::String& source, CompletionCallback onCompiled)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    if (traversalId != defaultRule) {
+        const juce::ValueTree traversalData = traversalDataFor(traversalId);
+
+        if (!traversalData.isValid() || ruleIndexFor(traversalData) == defaultRule) {
+            if (onCompiled) {
+                onCompiled(rejectedForSlot(traversalData));
+            }
+            return;
+        }
+    }
+
+    const int requestGeneration = ++generations[traversalId];
+
+    juce::WeakReference<RuleCompileService> safeThis (this);
+
+    compilerThread.addJob([safeThis, traversalId, requestGeneration, source,
+                           onCompiled = std::move(onCompiled)]() {
+        auto result = std::make_shared<RuleCompileResult>(RuleCompiler::compile(source));
+
+        std::shared_ptr<const ScriptTraversalRule::Program> program;
+
+        if (result->succeeded) {
+            program = ScriptTraversalRule::compile(result->script);
+
+            if (program == nullptr) {
+                result->succeeded = false;
+                result->error     = "the compiled rule failed verification";
+            }
+        }
+
+        juce::MessageManager::callAsync([safeThis, traversalId, requestGeneration, source, result, program, onCompiled]() {
+            if (safeThis == nullptr || requestGeneration != safeThis->generations[traversalId]) {
+                return;
+            }
+
+            if (program != nullptr) {
+                if (traversalId == defaultRule) {
+                    safeThis->storeSource(traversalId, source);
+                    safeThis->engine.setSelectionRule(program);
+                }
+                else {
+                    juce::ValueTree traversalData = safeThis->traversalDataFor(traversalId);
+                    const int       ruleIndex     = traversalData.isValid() ? safeThis->ruleIndexFor(traversalData) : defaultRule;
+
+                    if (ruleIndex == defaultRule) {
+                        *result = safeThis->rejectedForSlot(traversalData);
+                    }
+                    else {
+                        const bool newlyAssigned = ruleIndex != static_cast<int>(traversalData.getProperty(ValueTreeIdentifiers::SelectionRuleIndex, defaultRule));
+
+                        traversalData.setProperty(ValueTreeIdentifiers::SelectionRuleIndex, ruleIndex, nullptr);
+                        safeThis->storeSource(traversalId, source);
+                        safeThis->engine.setTraversalRule(ruleIndex, program);
+
+                        if (newlyAssigned) {
+                            safeThis->rtGraphBuilder.rebuildAllGraphs();
+                        }
+                    }
+                }
+            }
+
+            if (onCompiled) {
+                onCompiled(*result);
+            }
+        });
+    });
+}
+
+void RuleCompileService::recompileStoredRules()
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    for (auto& [traversalId, generation] : generations) {
+        ++generation;
+    }
+
+    engine.clearTraversalRules();
+
+    if (valueTreeState.traversalMap.hasProperty(ValueTreeIdentifiers::SelectionRuleSource)) {
+        compile(defaultRule, valueTreeState.traversalMap.getProperty(ValueTreeIdentifiers::SelectionRuleSource).toString(), nullptr);
+    }
+    else {
+        engine.setSelectionRule(nullptr);
+    }
+
+    for (int i = 0; i < valueTreeState.traversalMap.getNumChildren(); ++i) {
+        const juce::ValueTree traversalData = valueTreeState.traversalMap.getChild(i);
+
+        if (traversalData.hasProperty(ValueTreeIdentifiers::SelectionRuleSource)) {
+            compile(traversalData.getProperty(ValueTreeIdentifiers::TraversalId),
+                    traversalData.getProperty(ValueTreeIdentifiers::SelectionRuleSource).toString(),
+                    nullptr);
+        }
+    }
+}
+
+juce::String RuleCompileService::getSource(int traversalId) const
+{
+    const juce::ValueTree traversalData = traversalId == defaultRule ? valueTreeState.traversalMap
+                                                                     : traversalDataFor(traversalId);
+
+    if (traversalData.hasProperty(ValueTreeIdentifiers::SelectionRuleSource)) {
+        return traversalData.getProperty(ValueTreeIdentifiers::SelectionRuleSource).toString();
+    }
+
+    return traversalId == defaultRule ? RuleCompiler::builtInRuleSource() : getSource(defaultRule);
+}
+
+void RuleCompileService::storeSource(int traversalId, const juce::String& source)
+{
+    juce::ValueTree traversalData = traversalId == defaultRule ? valueTreeState.traversalMap
+                                                               : traversalDataFor(traversalId);
+
+    if (traversalData.isValid()) {
+        traversalData.setProperty(ValueTreeIdentifiers::SelectionRuleSource, source, nullptr);
+    }
+}
+
+juce::ValueTree RuleCompileService::traversalDataFor(int traversalId) const
+{
+    return valueTreeState.traversalMap.getChildWithProperty(ValueTreeIdentifiers::TraversalId, traversalId);
+}
+
+int RuleCompileService::ruleIndexFor(const juce::ValueTree& traversalData) const
+{
+    const int assigned = traversalData.getProperty(ValueTreeIdentifiers::SelectionRuleIndex, defaultRule);
+
+    if (assigned >= 0 && assigned < TraversalSession::maxTraversalRules) {
+        return assigned;
+    }
+
+    std::array<bool, TraversalSession::maxTraversalRules> inUse {};
+
+    for (int i = 0; i < valueTreeState.traversalMap.getNumChildren(); ++i) {
+        const int other = valueTreeState.traversalMap.getChild(i).getProperty(ValueTreeIdentifiers::SelectionRuleIndex, defaultRule);
+
+        if (other >= 0 && other < TraversalSession::maxTraversalRules) {
+            inUse[static_cast<std::size_t>(other)] = true;
+        }
+    }
+
+    for (int ruleIndex = 0; ruleIndex < TraversalSession::maxTraversalRules; ++ruleIndex) {
+        if (!inUse[static_cast<std::size_t>(ruleIndex)]) {
+            return ruleIndex;
+        }
+    }
+
+    return defaultRule;
+}
+
+RuleCompileResult RuleCompileService::rejectedForSlot(const juce::ValueTree& traversalData)
+{
+    RuleCompileResult rejected;
+    rejected.error       = traversalData.isValid() ? "every traversal rule slot is in use"
+                                                   : "the traversal no longer exists";
+    rejected.errorLine   = 1;
+    rejected.errorColumn = 1;
+
+    return rejected;
+}
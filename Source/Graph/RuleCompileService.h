@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    RuleCompileService.h
+    Created: 17 Oct 2026
+    Author:  Eli Baumgardner
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../Util/PluginModules.h"
+#include "../Audio/RuleCompiler.h"
+
+#include <functional>
+#include <map>
+
+class SequenceTreeEngine;
+class ValueTreeState;
+class RTGraphBuilder;
+
+class RuleCompileService
+{
+public:
+    RuleCompileService(SequenceTreeEngine& engine, ValueTreeState& valueTreeState, RTGraphBuilder& rtGraphBuilder);
+    ~RuleCompileService();
+
+    static constexpr int defaultRule = -1;
+
+    using CompletionCallback = std::function<void(const RuleCompileResult&)>;
+
+    void compile(int traversalId, const juce::String& source, CompletionCallback onCompiled);
+
+    void recompileStoredRules();
+
+    juce::String getSource(int traversalId) const;
+
+private:
+    juce::ValueTree traversalDataFor(int traversalId) const;
+
+    void storeSource(int traversalId, const juce::String& source);
+
+    int ruleIndexFor(const juce::ValueTree& traversalData) const;
+
+    static RuleCompileResult rejectedForSlot(const juce::ValueTree& traversalData);
+
+    SequenceTreeEngine& engine;
+    ValueTreeState&     valueTreeState;
+    RTGraphBuilder&     rtGraphBuilder;
+
+    std::map<int, int> generations;
+
+    juce::ThreadPool compilerThread { 1 };
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (RuleCompileService)
+    JUCE_DECLARE_NON_COPYABLE (RuleCompileService)
+};
@@ -5,6 +5,7 @@
 #include "ValueTreeIdentifiers.h"
 
 const juce::Identifier ValueTreeIdentifiers::PluginState          {"PluginState"};
+const juce::Identifier ValueTreeIdentifiers::SyncToHost           {"SyncToHost"};
 const juce::Identifier ValueTreeIdentifiers::CanvasData           {"CanvasData"};
 const juce::Identifier ValueTreeIdentifiers::NodeMap              {"NodeMap"};
 const juce::Identifier ValueTreeIdentifiers::NodeTreeMap          {"NodeTreeMap"};
@@ -74,6 +75,8 @@ const juce::Identifier ValueTreeIdentifiers::TraversalColour      {"TraversalCol
 const juce::Identifier ValueTreeIdentifiers::TraversalChannel     {"TraversalChannel"};
 const juce::Identifier ValueTreeIdentifiers::TraversalTranspose   {"TraversalTranspose"};
 const juce::Identifier ValueTreeIdentifiers::TraversalVelocity    {"TraversalVelocity"};
+const juce::Identifier ValueTreeIdentifiers::SelectionRuleIndex   {"SelectionRuleIndex"};
+const juce::Identifier ValueTreeIdentifiers::SelectionRuleSource  {"SelectionRuleSource"};
 const juce::Identifier ValueTreeIdentifiers::TraversalChildrenIds {"TraversalChildrenIds"};
 const juce::Identifier ValueTreeIdentifiers::DisabledTraversalIds {"DisabledTraversalIds"};
 const juce::Identifier ValueTreeIdentifiers::TraversalMap         {"TraversalMap"};
\ No newline at end of file
@@ -5,7 +5,7 @@
 #ifndef SEQUENCETREE_VALUETREEIDENTIFIERS_H
 #define SEQUENCETREE_VALUETREEIDENTIFIERS_H
 
-#include <juce_gui_basics/juce_gui_basics.h>
+#include "../Util/CoreModules.h"
 
 
 class ValueTreeIdentifiers {
@@ -13,6 +13,7 @@ class ValueTreeIdentifiers {
 public:
 
     static const juce::Identifier PluginState;
+    static const juce::Identifier SyncToHost;
     static const juce::Identifier CanvasData;
     static const juce::Identifier NodeMap;
     static const juce::Identifier NodeTreeMap;
@@ -94,6 +95,8 @@ public:
     static const juce::Identifier TraversalChannel;
     static const juce::Identifier TraversalTranspose;
     static const juce::Identifier TraversalVelocity;
+    static const juce::Identifier SelectionRuleIndex;
+    static const juce::Identifier SelectionRuleSource;
     // Traversal ValueTrees
 };
 
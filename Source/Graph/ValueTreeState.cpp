@@ -5,6 +5,8 @@
 #include "ValueTreeState.h"
 #include "ValueTreeIdentifiers.h"
 
+#include <cstring>
+
 ValueTreeState::ValueTreeState() {
 
     canvasData   = juce::ValueTree(ValueTreeIdentifiers::CanvasData);
@@ -37,6 +39,7 @@ void ValueTreeState::replaceState(const juce::ValueTree& restoredTree)
         restoredNodeMap = restoredTree;
     }
 
+    traversalMap.copyPropertiesFrom(restoredTraversalMap, nullptr);
     traversalMap.removeAllChildren(nullptr);
     for (int i = 0; i < restoredTraversalMap.getNumChildren(); ++i) {
         traversalMap.addChild(restoredTraversalMap.getChild(i).createCopy(), -1, nullptr);
@@ -58,6 +61,72 @@ void ValueTreeState::replaceState(const juce::ValueTree& restoredTree)
     nodeIdIncrement = maxId;
 }
 
+juce::ValueTree ValueTreeState::createStateTree() const
+{
+    juce::ValueTree state(ValueTreeIdentifiers::PluginState);
+
+    state.addChild(nodeMap.createCopy(),      -1, nullptr);
+    state.addChild(traversalMap.createCopy(), -1, nullptr);
+
+    return state;
+}
+
+static constexpr juce::uint32 binaryStateMagic = 0x21324356;
+
+void ValueTreeState::encodeStateBlob(const juce::ValueTree& stateTree, juce::MemoryBlock& destData)
+{
+    const std::unique_ptr<juce::XmlElement> xml(stateTree.createXml());
+
+    if (xml == nullptr) {
+        destData.reset();
+        return;
+    }
+
+    const juce::String xmlText = xml->toString(juce::XmlElement::TextFormat().singleLine().withoutHeader());
+    const auto stringLength    = static_cast<juce::uint32>(xmlText.getNumBytesAsUTF8());
+
+    destData.setSize(stringLength + 9);
+
+    auto* bytes = static_cast<char*>(destData.getData());
+
+    const juce::uint32 header[] = { juce::ByteOrder::swapIfBigEndian(binaryStateMagic),
+                                    juce::ByteOrder::swapIfBigEndian(stringLength) };
+
+    std::memcpy(bytes, header, sizeof(header));
+
+    xmlText.copyToUTF8(bytes + 8, stringLength + 1);
+}
+
+juce::ValueTree ValueTreeState::decodeStateBlob(const void* data, int sizeInBytes)
+{
+    if (data == nullptr || sizeInBytes <= 0) {
+        return {};
+    }
+
+    const auto* bytes = static_cast<const char*>(data);
+
+    juce::String xmlText;
+
+    if (sizeInBytes > 8 && juce::ByteOrder::littleEndianInt(bytes) == binaryStateMagic) {
+        const int stringLength = static_cast<int>(juce::ByteOrder::littleEndianInt(bytes + 4));
+
+        if (stringLength < 0 || stringLength > sizeInBytes - 8) {
+            return {};
+        }
+
+        xmlText = juce::String::fromUTF8(bytes + 8, stringLength);
+    }
+    else {
+        xmlText = juce::String::fromUTF8(bytes, sizeInBytes);
+    }
+
+    if (const auto xml = juce::parseXML(xmlText)) {
+        return juce::ValueTree::fromXml(*xml);
+    }
+
+    return {};
+}
+
 juce::ValueTree ValueTreeState::addNodeTree(juce::UndoManager* undoManager)
 {
     juce::ValueTree nodeTreeId         {ValueTreeIdentifiers::NodeTreeId};
@@ -168,8 +237,11 @@ juce::ValueTree ValueTreeState::addAlternativeNode(int parentNodeId, juce::UndoM
 
 juce::ValueTree ValueTreeState::addTraversalFlagNode(int parentNodeId, juce::UndoManager* undoManager)
 {
-    juce::ValueTree parentNode = getNode(parentNodeId);
+    return addTraversalFlagNode(getNode(parentNodeId), undoManager);
+}
 
+juce::ValueTree ValueTreeState::addTraversalFlagNode(juce::ValueTree parentNode, juce::UndoManager* undoManager)
+{
     jassert(parentNode.isValid());
     jassert(isNoteBearingNode(parentNode)
          || parentNode.getType() == ValueTreeIdentifiers::TraversalFlagData);
@@ -216,8 +288,11 @@ juce::ValueTree ValueTreeState::addModulatorNode(juce::ValueTree parentNode, con
 }
 
 juce::ValueTree ValueTreeState::addModulatorRoot(int parentNodeId, juce::UndoManager *undoManager) {
+    return addModulatorRoot(getNode(parentNodeId), undoManager);
+}
+
+juce::ValueTree ValueTreeState::addModulatorRoot(juce::ValueTree parentNode, juce::UndoManager *undoManager) {
 
-    juce::ValueTree parentNode = getNode(parentNodeId);
     juce::ValueTree nodeTree = addNodeTree(undoManager);
     int nodeTreeId = nodeTree.getProperty(ValueTreeIdentifiers::Id);
 
@@ -235,7 +310,10 @@ juce::ValueTree ValueTreeState::addModulatorRoot(int parentNodeId, juce::UndoMan
 }
 
 juce::ValueTree ValueTreeState::addModulator(int parentNodeId, juce::UndoManager *undoManager) {
-    juce::ValueTree parentNode = getNode(parentNodeId);
+    return addModulator(getNode(parentNodeId), undoManager);
+}
+
+juce::ValueTree ValueTreeState::addModulator(juce::ValueTree parentNode, juce::UndoManager *undoManager) {
     juce::Identifier parentNodeType = parentNode.getType();
 
     jassert(parentNode.isValid());
@@ -252,13 +330,18 @@ juce::ValueTree ValueTreeState::addModulator(int parentNodeId, juce::UndoManager
 }
 void ValueTreeState::connectNodes(int parentNodeId, int childNodeId, juce::UndoManager* undoManager)
 {
-    juce::ValueTree parentNode = getNode(parentNodeId);
+    connectNodes(getNode(parentNodeId), childNodeId, undoManager);
+}
 
+juce::ValueTree ValueTreeState::connectNodes(juce::ValueTree parentNode, int childNodeId, juce::UndoManager* undoManager)
+{
     juce::ValueTree nodeChildrenIds = parentNode.getChildWithName(ValueTreeIdentifiers::NodeChildrenIds);
 
     juce::ValueTree childId {ValueTreeIdentifiers::NodeId};
     childId.setProperty(ValueTreeIdentifiers::Id, childNodeId, undoManager);
     nodeChildrenIds.addChild(childId, -1, undoManager);
+
+    return childId;
 }
 
 void ValueTreeState::disconnectNodes(int parentNodeId, int childNodeId, juce::UndoManager* undoManager)
@@ -341,8 +424,11 @@ void ValueTreeState::setNodePosition(juce::ValueTree node, NodePosition nodePosi
 
 void ValueTreeState::setMidiValue(int nodeId,NodeNote note,juce::UndoManager* undoManager)
 {
-    juce::ValueTree node = getNode(nodeId);
+    setMidiValue(getNode(nodeId), note, undoManager);
+}
 
+void ValueTreeState::setMidiValue(juce::ValueTree node, NodeNote note, juce::UndoManager* undoManager)
+{
     jassert(node.isValid());
     jassert(isNoteBearingNode(node));
 
@@ -441,7 +527,7 @@ juce::ValueTree ValueTreeState::createTraversalData(int traversalId, juce::UndoM
 
     traversalData.setProperty(ValueTreeIdentifiers::TempoMultiplier,defaultTempoMult,undoManager);
 
-    traversalData.setProperty(ValueTreeIdentifiers::TraversalColour, juce::Colours::white.toString(), undoManager);
+    traversalData.setProperty(ValueTreeIdentifiers::TraversalColour, juce::String(defaultTraversalColour), undoManager);
 
     traversalData.setProperty(ValueTreeIdentifiers::TraversalChannel, 1, undoManager);
 
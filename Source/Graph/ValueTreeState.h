@@ -5,7 +5,7 @@
 #pragma once
 
 #include "../Util/NodeInfo.h"
-#include <juce_gui_basics/juce_gui_basics.h>
+#include "../Util/CoreModules.h"
 
 class ValueTreeState {
 
@@ -27,6 +27,10 @@ public:
     juce::ValueTree addModulatorRoot    (int parentNodeId, juce::UndoManager* undoManager);
     juce::ValueTree addModulator        (int parentNodeId, juce::UndoManager* undoManager);
 
+    juce::ValueTree addTraversalFlagNode(juce::ValueTree parentNode, juce::UndoManager* undoManager);
+    juce::ValueTree addModulatorRoot    (juce::ValueTree parentNode, juce::UndoManager* undoManager);
+    juce::ValueTree addModulator        (juce::ValueTree parentNode, juce::UndoManager* undoManager);
+
     juce::ValueTree addChildNode(juce::ValueTree parentNode, const juce::Identifier& nodeType,
                                  juce::UndoManager* undoManager);
 
@@ -35,7 +39,13 @@ public:
 
     void replaceState(const juce::ValueTree& restoredTree);
 
+    juce::ValueTree createStateTree() const;
+
+    static void            encodeStateBlob(const juce::ValueTree& stateTree, juce::MemoryBlock& destData);
+    static juce::ValueTree decodeStateBlob(const void* data, int sizeInBytes);
+
     void connectNodes   (int parentNodeId, int childNodeId, juce::UndoManager* undoManager);
+    juce::ValueTree connectNodes(juce::ValueTree parentNode, int childNodeId, juce::UndoManager* undoManager);
     void disconnectNodes(int parentNodeId, int childNodeId, juce::UndoManager* undoManager);
     void setArrowType   (int parentNodeId, int childNodeId, ArrowType arrowType, juce::UndoManager* undoManager);
     void removeRootNode (int rootNodeId, juce::UndoManager* undoManager);
@@ -44,6 +54,7 @@ public:
 
     void setNodePosition (juce::ValueTree node, NodePosition nodePosition, juce::UndoManager* undoManager);
     void setMidiValue    (int nodeId, NodeNote note, juce::UndoManager* undoManager);
+    void setMidiValue    (juce::ValueTree node, NodeNote note, juce::UndoManager* undoManager);
 
     NodePosition    getNodePosition (int nodeId);
     juce::ValueTree getRootNode     (int nodeId);
@@ -74,6 +85,8 @@ public:
     static constexpr int defaultMidiChannel       {1};
     static constexpr int defaultTempoMult         {1};
 
+    static constexpr const char* defaultTraversalColour {"ffffffff"};
+
 private:
 
     int nodeIdIncrement = 0;
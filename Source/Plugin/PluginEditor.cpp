@@ -42,7 +42,7 @@ SequenceTreeAudioProcessorEditor::SequenceTreeAudioProcessorEditor (SequenceTree
 
     port->onZoomChanged = [canvasPtr = canvas.get()](float z) { canvasPtr->valueField.setViewZoom(z); };
 
-    audioProcessor.notifyUi = [canvasPtr = canvas.get()] {
+    audioProcessor.engine.notifyUi = [canvasPtr = canvas.get()] {
         if (canvasPtr) {
             canvasPtr->triggerAsyncUpdate();
         }
@@ -52,6 +52,7 @@ SequenceTreeAudioProcessorEditor::SequenceTreeAudioProcessorEditor (SequenceTree
 
     audioProcessor.resumeStateListeners = [this] {
         canvas->setValueTreeState(applicationContext.valueTreeState->nodeMap);
+        titleBar->refreshTransportState();
         attachStateListeners();
     };
 
@@ -85,7 +86,7 @@ SequenceTreeAudioProcessorEditor::~SequenceTreeAudioProcessorEditor()
     if (desktop.getKioskModeComponent() == getTopLevelComponent())
         desktop.setKioskModeComponent(nullptr);
 
-    audioProcessor.notifyUi              = nullptr;
+    audioProcessor.engine.notifyUi       = nullptr;
     audioProcessor.suspendStateListeners = nullptr;
     audioProcessor.resumeStateListeners  = nullptr;
 
@@ -2,8 +2,10 @@
 #include "PluginEditor.h"
 #include "../UI/Node/Node.h"
 #include "../Graph/ValueTreeIdentifiers.h"
-#include <algorithm>
-#include <unordered_set>
+
+#if JucePlugin_Build_Standalone
+ #include <juce_audio_plugin_client/Standalone/juce_StandaloneFilterWindow.h>
+#endif
 
 
 
@@ -91,13 +93,29 @@ void SequenceTreeAudioProcessor::changeProgramName (int index, const juce::Strin
 //==============================================================================
 void SequenceTreeAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    tempoInfo.currentSampleRate = sampleRate;
-    traversalSession.prepare();
+    engine.prepare(sampleRate, samplesPerBlock);
+}
+
+// Hosts don't tell plugins how late their output reaches the speakers, so the device latency
+// is only known when running as the standalone app. Must be called on the message thread.
+int SequenceTreeAudioProcessor::getDeviceOutputLatencySamples() const
+{
+   #if JucePlugin_Build_Standalone
+    if (wrapperType == wrapperType_Standalone) {
+        if (auto* holder = juce::StandalonePluginHolder::getInstance()) {
+            if (auto* device = holder->deviceManager.getCurrentAudioDevice()) {
+                return device->getOutputLatencyInSamples();
+            }
+        }
+    }
+   #endif
+
+    return 0;
 }
 
 void SequenceTreeAudioProcessor::releaseResources()
 {
-    retiredSnapshots.clear();
+    engine.releaseResources();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -143,9 +161,8 @@ void SequenceTreeAudioProcessor::getStateInformation (juce::MemoryBlock& destDat
         state = pendingRestoreState;
     }
     else {
-        state = juce::ValueTree(ValueTreeIdentifiers::PluginState);
-        state.addChild(graphState.nodeMap.createCopy(),      -1, nullptr);
-        state.addChild(graphState.traversalMap.createCopy(), -1, nullptr);
+        state = graphState.createStateTree();
+        state.setProperty(ValueTreeIdentifiers::SyncToHost, engine.syncToHost.load(), nullptr);
     }
 
     std::unique_ptr<juce::XmlElement> xml(state.createXml());
@@ -165,8 +182,11 @@ void SequenceTreeAudioProcessor::applyRestoredState()
         suspendStateListeners();
     }
 
+    engine.syncToHost.store(restoredTree.getProperty(ValueTreeIdentifiers::SyncToHost, false));
+
     graphState.replaceState(restoredTree);
     rtGraphBuilder.rebuildAllGraphs();
+    ruleCompileService.recompileStoredRules();
 
     pendingRestoreState = juce::ValueTree();
 
@@ -215,151 +235,9 @@ void SequenceTreeAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
 {
     juce::ScopedNoDenormals noDenormals;
 
-    struct BlockScope
-    {
-        std::atomic<std::uint64_t>& counter;
-        ~BlockScope() { counter.fetch_add(1, std::memory_order_release); }
-    };
-
-    const BlockScope blockScope { blocksCompleted };
-
-    const int numSamples = buffer.getNumSamples();
-
     buffer.clear();
-    midiMessages.clear();
-
-    const bool resetHit = resetRequested.exchange(false);
-
-    if (resetHit) {
-        traversalSession.silenceAllNotes(midiMessages);
-    }
-
-    const bool playing   = isPlaying.load();
-    const bool suspended = wasPlaying && !playing;
-
-    if (suspended) {
-        traversalSession.suspendActiveNotes(midiMessages);
-    }
-
-    wasPlaying = playing;
-
-    AudioSnapshot* snap = currentSnapshot.load(std::memory_order_acquire);
-
-    if (!playing || !snap || !snap->globalNodes) {
-        if (resetHit) {
-            traversalSession.clearTraversals();
-        }
-
-        if ((resetHit || suspended) && notifyUi) {
-            notifyUi();
-        }
-        return;
-    }
-
-    NodeMap&  nodes    = *snap->globalNodes;
-    RTGraphs& rtGraphs = *snap->rtGraphs;
-
-    if (resetHit) {
-        traversalSession.restartActiveTraversals(nodes, rtGraphs, midiMessages);
-
-        if (notifyUi) {
-            notifyUi();
-        }
-    }
-
-    traversalSession.syncWithGraph(nodes, rtGraphs, midiMessages);
-
-    if (traversalSession.isIdle()
-        && !traversalSession.startTraversalsFromFirstRoot(nodes, rtGraphs, midiMessages)) {
-        return;
-    }
-
-    eventManager.processEvents(numSamples, midiMessages, nodes, traversalSession.getTraversals());
-
-    if (notifyUi && hasPendingUiCommands()) {
-        notifyUi();
-    }
-}
-
-bool SequenceTreeAudioProcessor::hasPendingUiCommands() const
-{
-    return eventManager.bridge.hasPendingCommands();
-}
-
-void SequenceTreeAudioProcessor::setNewGraph(std::shared_ptr<RTGraph> graph)
-{
-    const AudioSnapshot* oldSnap = publishedSnapshot.get();
-
-    auto newSnap = std::make_shared<AudioSnapshot>();
-
-    if (oldSnap && oldSnap->globalNodes) {
-        newSnap->globalNodes = std::make_shared<NodeMap>(*oldSnap->globalNodes);
-    } else {
-        newSnap->globalNodes = std::make_shared<NodeMap>();
-    }
-
-    if (oldSnap && oldSnap->rtGraphs) {
-        newSnap->rtGraphs = std::make_shared<RTGraphs>(*oldSnap->rtGraphs);
-    } else {
-        newSnap->rtGraphs = std::make_shared<RTGraphs>();
-    }
-
-    (*newSnap->rtGraphs)[graph->graphID] = graph;
-
-
-    for (const auto& [nodeId, node] : graph->nodeMap) {
-        (*newSnap->globalNodes)[nodeId] = node;
-    }
-
-    std::vector<int> staleIds;
-
-    for (const auto& [nodeId, node] : *newSnap->globalNodes) {
-        if (node.graphID == graph->graphID && !graph->nodeMap.count(nodeId)) {
-            staleIds.push_back(nodeId);
-        }
-    }
-
-    for (int id : staleIds) {
-        newSnap->globalNodes->erase(id);
-    }
-
-    publishAudioSnapshot(newSnap);
-}
-
-void SequenceTreeAudioProcessor::publishAudioSnapshot(std::shared_ptr<AudioSnapshot> snapshot)
-{
-    static_assert(std::atomic<AudioSnapshot*>::is_always_lock_free,
-                  "the audio thread must be able to read the snapshot without a lock");
-
-    AudioSnapshot* raw = snapshot.get();
-
-    auto retired      = std::move(publishedSnapshot);
-    publishedSnapshot = std::move(snapshot);
-
-    currentSnapshot.store(raw, std::memory_order_release);
-
-    std::atomic_thread_fence(std::memory_order_seq_cst);
-
-    if (retired != nullptr) {
-        retiredSnapshots.push_back({ std::move(retired),
-                                     blocksCompleted.load(std::memory_order_acquire) });
-    }
-
-    collectRetiredSnapshots();
-}
-
-void SequenceTreeAudioProcessor::collectRetiredSnapshots()
-{
-    const std::uint64_t completed = blocksCompleted.load(std::memory_order_acquire);
-
-    auto isUnreachableByAudioThread = [completed](const RetiredSnapshot& entry) {
-        return completed > entry.retiredAtBlock;
-    };
 
-    retiredSnapshots.erase(std::remove_if(retiredSnapshots.begin(),
-                                          retiredSnapshots.end(),
-                                          isUnreachableByAudioThread),
-                           retiredSnapshots.end());
+    engine.processBlock(getPlayHead(), buffer.getNumSamples(), midiMessages);
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout SequenceTreeAudioProcessor::createParameterLayout()
@@ -4,11 +4,10 @@
 #include <memory>
 #include <atomic>
 #include <functional>
-#include "../Graph/RTData.h"
 #include "../Graph/ValueTreeState.h"
 #include "../Graph/RTGraphBuilder.h"
-#include "../Audio/EventManager.h"
-#include "../Audio/TraversalSession.h"
+#include "../Graph/RuleCompileService.h"
+#include "../Audio/SequenceTreeEngine.h"
 
 class SequenceTreeAudioProcessorEditor;
 
@@ -46,12 +45,8 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    void setNewGraph(std::shared_ptr<RTGraph> graph);
-
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
-    std::function<void()>                  notifyUi;
-
     std::function<void()>                  suspendStateListeners;
     std::function<void()>                  resumeStateListeners;
 
@@ -59,57 +54,17 @@ public:
 
     void applyRestoredState();
 
-    struct AudioSnapshot
-    {
-        std::shared_ptr<NodeMap>      globalNodes;
-        std::shared_ptr<RTGraphs>     rtGraphs;
-    };
-
-    std::atomic<AudioSnapshot*> currentSnapshot { nullptr };
-    std::atomic<std::uint64_t>  blocksCompleted { 0 };
-
-    void publishAudioSnapshot(std::shared_ptr<AudioSnapshot> snapshot);
+    int getDeviceOutputLatencySamples() const;
 
-    std::atomic<bool>   isPlaying       = false;
-    std::atomic<bool>   resetRequested  = false;
-    bool                wasPlaying      = false;
-    std::atomic<double> tempoMultiplier { 1.0 };
+    SequenceTreeEngine engine;
 
     juce::AudioProcessorValueTreeState valueTreeState;
 
     ValueTreeState graphState;
 
-    RTGraphBuilder rtGraphBuilder { *this, graphState };
-
-
-    struct TempoInfo
-    {
-        double currentSampleRate = 44100.0;
-    };
-
-    TempoInfo tempoInfo;
-
-    EventManager     eventManager     { this };
-    TraversalSession traversalSession { eventManager };
-
-    bool hasPendingUiCommands() const;
-
-private:
-
-    struct RetiredSnapshot
-    {
-        std::shared_ptr<AudioSnapshot> snapshot;
-        std::uint64_t                  retiredAtBlock = 0;
-    };
-
-    void collectRetiredSnapshots();
-
-    std::shared_ptr<AudioSnapshot> publishedSnapshot;
-    std::vector<RetiredSnapshot>   retiredSnapshots;
-
-public:
+    RTGraphBuilder rtGraphBuilder { engine, graphState };
 
-    const AudioSnapshot* getPublishedSnapshot() const { return publishedSnapshot.get(); }
+    RuleCompileService ruleCompileService { engine, graphState, rtGraphBuilder };
 
     JUCE_DECLARE_WEAK_REFERENCEABLE (SequenceTreeAudioProcessor)
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SequenceTreeAudioProcessor)
@@ -0,0 +1,119 @@
+#include "../Audio/SequenceTreeEngine.h"
+#include "../Graph/ProjectGenerator.h"
+#include "../Graph/ValueTreeState.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+void printUsage()
+{
+    std::printf("usage: SequenceTreeGenerate [--nodes N | --trees N] [--depth N] [--fan-out N]\n"
+                "                            [--chords P] [--alternatives P] [--modulators P] [--flags P]\n"
+                "                            [--jumps P] [--chain-length N] [--step-ms N] [--seed N]\n"
+                "                            --out <file.state>\n");
+}
+
+float proportionFor(const juce::ArgumentList& arguments, const char* option, float fallback)
+{
+    if (!arguments.containsOption(option)) {
+        return fallback;
+    }
+
+    return juce::jlimit(0.0f, 1.0f, arguments.getValueForOption(option).getFloatValue());
+}
+
+int intFor(const juce::ArgumentList& arguments, const char* option, int fallback)
+{
+    return arguments.containsOption(option) ? arguments.getValueForOption(option).getIntValue() : fallback;
+}
+}
+
+int main(int argc, char** argv)
+{
+    const juce::ArgumentList arguments(argc, argv);
+
+    ProjectGenerator::Settings settings;
+
+    settings.trees                = intFor(arguments, "--trees",        settings.trees);
+    settings.depth                = intFor(arguments, "--depth",        settings.depth);
+    settings.fanOut               = intFor(arguments, "--fan-out",      settings.fanOut);
+    settings.modulatorChainLength = intFor(arguments, "--chain-length", settings.modulatorChainLength);
+    settings.stepMs               = intFor(arguments, "--step-ms",      settings.stepMs);
+    settings.seed                 = intFor(arguments, "--seed",         static_cast<int>(settings.seed));
+
+    settings.chordEdges       = proportionFor(arguments, "--chords",       settings.chordEdges);
+    settings.alternativeNodes = proportionFor(arguments, "--alternatives", settings.alternativeNodes);
+    settings.modulatorChains  = proportionFor(arguments, "--modulators",   settings.modulatorChains);
+    settings.traversalFlags   = proportionFor(arguments, "--flags",        settings.traversalFlags);
+    settings.crossTreeJumps   = proportionFor(arguments, "--jumps",        settings.crossTreeJumps);
+
+    const juce::String outPath = arguments.getValueForOption("--out");
+
+    if (outPath.isEmpty() || settings.trees <= 0 || settings.depth < 0 || settings.fanOut <= 0
+        || settings.modulatorChainLength <= 0 || settings.stepMs <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    if (arguments.containsOption("--nodes")) {
+        settings = ProjectGenerator::withNodeCount(settings, intFor(arguments, "--nodes", 0));
+    }
+
+    ValueTreeState state;
+
+    const ProjectGenerator::Stats stats = ProjectGenerator(settings).populate(state);
+
+    juce::MemoryBlock blob;
+    ProjectGenerator::createStateBlob(state, blob);
+
+    const juce::File out = juce::File::getCurrentWorkingDirectory().getChildFile(outPath);
+
+    if (!out.replaceWithData(blob.getData(), blob.getSize())) {
+        std::fprintf(stderr, "could not write %s\n", out.getFullPathName().toRawUTF8());
+        return 1;
+    }
+
+    SequenceTreeEngine engine;
+
+    const auto compileStart = std::chrono::steady_clock::now();
+    const auto rtGraphs     = ProjectGenerator::compileGraphs(engine, state);
+    const auto compileMs    = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compileStart).count();
+
+    int compiledNodes = 0;
+    int compiledEdges = 0;
+
+    if (const auto* snapshot = engine.getPublishedSnapshot()) {
+        for (const auto& [graphId, graph] : rtGraphs) {
+            const RTNodeRef rootRef = snapshot->nodes.ref(graphId);
+
+            if (rootRef && rootRef.graph->graphID == graphId) {
+                compiledNodes += rootRef.graph->size();
+                compiledEdges += static_cast<int>(rootRef.graph->edgeChildIds.size());
+            }
+        }
+    }
+
+    auto* report = new juce::DynamicObject();
+
+    report->setProperty("file",             out.getFullPathName());
+    report->setProperty("bytes",            static_cast<int>(blob.getSize()));
+    report->setProperty("seed",             static_cast<int>(settings.seed));
+    report->setProperty("trees",            stats.trees);
+    report->setProperty("nodes",            stats.nodes);
+    report->setProperty("chordEdges",       stats.chordEdges);
+    report->setProperty("alternativeNodes", stats.alternativeNodes);
+    report->setProperty("modulatorRoots",   stats.modulatorRoots);
+    report->setProperty("modulators",       stats.modulators);
+    report->setProperty("traversalFlags",   stats.traversalFlags);
+    report->setProperty("crossTreeJumps",   stats.crossTreeJumps);
+    report->setProperty("rtGraphs",         static_cast<int>(rtGraphs.size()));
+    report->setProperty("compiledNodes",    compiledNodes);
+    report->setProperty("compiledEdges",    compiledEdges);
+    report->setProperty("compileMs",        compileMs);
+
+    std::printf("%s\n", juce::JSON::toString(juce::var(report)).toRawUTF8());
+
+    return 0;
+}
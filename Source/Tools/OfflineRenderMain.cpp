@@ -0,0 +1,107 @@
+#include "../Audio/OfflineRenderer.h"
+
+#include <cstdio>
+
+namespace
+{
+void printUsage()
+{
+    std::printf("usage: SequenceTreeRender [--seconds N | --loops N] [--bpm N] [--sample-rate N]\n"
+                "                          [--block N] [--max-seconds N] [--sync | --free]\n"
+                "                          --out <file.mid|dir>\n"
+                "                          <state> [<state> ...]\n");
+}
+
+juce::File destinationFor(const juce::File& input, const juce::File& out, bool batch)
+{
+    if (!batch && out.hasFileExtension("mid")) {
+        return out;
+    }
+
+    return out.getChildFile(input.getFileNameWithoutExtension()).withFileExtension("mid");
+}
+}
+
+int main(int argc, char** argv)
+{
+    const juce::ArgumentList arguments(argc, argv);
+
+    OfflineRenderer::Settings settings;
+
+    if (arguments.containsOption("--seconds"))     settings.seconds    = arguments.getValueForOption("--seconds").getDoubleValue();
+    if (arguments.containsOption("--loops"))       settings.loops      = arguments.getValueForOption("--loops").getIntValue();
+    if (arguments.containsOption("--bpm"))         settings.bpm        = arguments.getValueForOption("--bpm").getDoubleValue();
+    if (arguments.containsOption("--sample-rate")) settings.sampleRate = arguments.getValueForOption("--sample-rate").getDoubleValue();
+    if (arguments.containsOption("--block"))       settings.blockSize  = arguments.getValueForOption("--block").getIntValue();
+    if (arguments.containsOption("--max-seconds")) settings.maxSeconds = arguments.getValueForOption("--max-seconds").getDoubleValue();
+
+    if (arguments.containsOption("--sync"))        settings.hostSynced = true;
+    if (arguments.containsOption("--free"))        settings.hostSynced = false;
+
+    const juce::String outPath = arguments.getValueForOption("--out");
+
+    juce::Array<juce::File> inputs;
+
+    for (int i = 0; i < arguments.size(); ++i) {
+        const auto& argument = arguments[i];
+
+        if (argument.isOption()) {
+            if (argument != "--sync" && argument != "--free" && !argument.text.containsChar('=')) {
+                ++i;
+            }
+            continue;
+        }
+
+        inputs.add(argument.resolveAsFile());
+    }
+
+    if (inputs.isEmpty() || outPath.isEmpty()
+        || settings.sampleRate <= 0.0 || settings.blockSize <= 0 || settings.bpm <= 0.0) {
+        printUsage();
+        return 1;
+    }
+
+    const bool       batch = inputs.size() > 1;
+    const juce::File out   = juce::File::getCurrentWorkingDirectory().getChildFile(outPath);
+
+    if (batch || !out.hasFileExtension("mid")) {
+        out.createDirectory();
+    }
+
+    int failures = 0;
+
+    for (const juce::File& input : inputs) {
+        juce::MemoryBlock blob;
+
+        OfflineRenderer renderer(settings);
+
+        if (!input.loadFileAsData(blob) || !renderer.loadState(blob.getData(), static_cast<int>(blob.getSize()))) {
+            std::printf("%s: could not load state\n", input.getFullPathName().toRawUTF8());
+            ++failures;
+            continue;
+        }
+
+        const juce::File destination = destinationFor(input, out, batch);
+
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        const auto result     = renderer.renderToFile(destination);
+        const auto elapsed    = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+
+        if (!result.written) {
+            std::printf("%s: could not write %s\n", input.getFullPathName().toRawUTF8(),
+                        destination.getFullPathName().toRawUTF8());
+            ++failures;
+            continue;
+        }
+
+        const double renderedSeconds = static_cast<double>(result.renderedSamples) / settings.sampleRate;
+
+        std::printf("%s -> %s  %.2fs rendered, %d notes, %d loops%s, %.0fx real time\n",
+                    input.getFullPathName().toRawUTF8(), destination.getFullPathName().toRawUTF8(),
+                    renderedSeconds, result.noteCount, result.loopsCompleted,
+                    result.finished ? "" : " (hit max length)",
+                    renderedSeconds / juce::jmax(elapsed, 1.0e-6));
+    }
+
+    return failures == 0 ? 0 : 1;
+}
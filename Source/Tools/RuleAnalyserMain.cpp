@@ -0,0 +1,243 @@
+#include "../Audio/RuleCompiler.h"
+#include "../Audio/ScriptCostAnalysis.h"
+#include "../Audio/ScriptTraversalRule.h"
+#include "ScriptFuzzCase.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+    int children           = 64;
+    int traversals         = 128;
+    int selectionsPerBlock = 1;
+    int blockBudget        = 32768;
+    int fuzzCases          = 0;
+    int seed               = 1;
+    int maxReported        = 8;
+
+    ScriptFuzzCase::Mode fuzzMode = ScriptFuzzCase::Mode::Structured;
+};
+
+void printUsage()
+{
+    std::printf("usage: SequenceTreeRuleAnalyser [--children N] [--traversals N] [--selections-per-block N]\n"
+                "                                [--block-budget STEPS] [--fuzz N] [--seed N] [--report N]\n"
+                "                                [--raw] [--builtin] [<rule file> ...]\n");
+}
+
+int intFor(const juce::ArgumentList& arguments, const char* option, int fallback)
+{
+    return arguments.containsOption(option) ? arguments.getValueForOption(option).getIntValue() : fallback;
+}
+
+const char* opcodeName(ScriptOpcode opcode)
+{
+    switch (opcode) {
+        case ScriptOpcode::Halt:           return "Halt";
+        case ScriptOpcode::PushInt:        return "PushInt";
+        case ScriptOpcode::PushLocal:      return "PushLocal";
+        case ScriptOpcode::PushField:      return "PushField";
+        case ScriptOpcode::StoreLocal:     return "StoreLocal";
+        case ScriptOpcode::Pop:            return "Pop";
+        case ScriptOpcode::LoadChild:      return "LoadChild";
+        case ScriptOpcode::Add:            return "Add";
+        case ScriptOpcode::Subtract:       return "Subtract";
+        case ScriptOpcode::Multiply:       return "Multiply";
+        case ScriptOpcode::Divide:         return "Divide";
+        case ScriptOpcode::Modulo:         return "Modulo";
+        case ScriptOpcode::Negate:         return "Negate";
+        case ScriptOpcode::Equal:          return "Equal";
+        case ScriptOpcode::NotEqual:       return "NotEqual";
+        case ScriptOpcode::Less:           return "Less";
+        case ScriptOpcode::LessOrEqual:    return "LessOrEqual";
+        case ScriptOpcode::Greater:        return "Greater";
+        case ScriptOpcode::GreaterOrEqual: return "GreaterOrEqual";
+        case ScriptOpcode::LogicalAnd:     return "LogicalAnd";
+        case ScriptOpcode::LogicalOr:      return "LogicalOr";
+        case ScriptOpcode::LogicalNot:     return "LogicalNot";
+        case ScriptOpcode::Jump:           return "Jump";
+        case ScriptOpcode::JumpIfFalse:    return "JumpIfFalse";
+        case ScriptOpcode::JumpIfTrue:     return "JumpIfTrue";
+        case ScriptOpcode::Return:         return "Return";
+    }
+
+    return "?";
+}
+
+void printScript(const RTScript& script)
+{
+    for (std::size_t pc = 0; pc < script.instructions.size(); ++pc) {
+        const ScriptInstruction& instruction = script.instructions[pc];
+
+        std::printf("    %4d  %-15s %d\n", static_cast<int>(pc), opcodeName(instruction.opcode), instruction.operand);
+    }
+}
+
+long long blockCost(const ScriptCostBound& bound, const Options& options)
+{
+    return static_cast<long long>(bound.worstCaseSteps(options.children))
+         * options.traversals * options.selectionsPerBlock;
+}
+
+bool analyseRule(const juce::String& name, const juce::String& source, const Options& options)
+{
+    const RuleCompileResult compiled = RuleCompiler::compile(source);
+
+    if (!compiled.succeeded) {
+        std::printf("%s: line %d, column %d: %s\n", name.toRawUTF8(), compiled.errorLine, compiled.errorColumn,
+                    compiled.error.toRawUTF8());
+        return false;
+    }
+
+    const auto program = ScriptTraversalRule::compile(compiled.script);
+
+    if (program == nullptr) {
+        std::printf("%s: rejected by the script verifier\n", name.toRawUTF8());
+        return false;
+    }
+
+    const ScriptCostBound bound = analyseScriptCost(program->optimisedScript);
+    const long long       cost  = blockCost(bound, options);
+    const bool            fits  = cost <= options.blockBudget;
+
+    if (bound.isBounded) {
+        std::printf("%s: %d steps + %d per child, %d at %d children\n", name.toRawUTF8(), bound.fixedSteps,
+                    bound.stepsPerChild, bound.worstCaseSteps(options.children), options.children);
+    }
+    else {
+        std::printf("%s: unbounded loop, capped at %d steps by the step budget\n", name.toRawUTF8(), bound.budgetCap);
+    }
+
+    std::printf("    %lld steps per block across %d traversals, block budget %d: %s\n", cost, options.traversals,
+                options.blockBudget, fits ? "ok" : "OVER BUDGET");
+
+    return fits;
+}
+
+bool runFuzzer(const Options& options)
+{
+    juce::Random random(options.seed);
+
+    std::vector<std::uint8_t> bytes;
+
+    int compiled   = 0;
+    int unbounded  = 0;
+    int overBudget = 0;
+    int violations = 0;
+    int reported   = 0;
+
+    for (int index = 0; index < options.fuzzCases; ++index) {
+        bytes.resize(static_cast<std::size_t>(random.nextInt(512)));
+
+        for (auto& byte : bytes) {
+            byte = static_cast<std::uint8_t>(random.nextInt(256));
+        }
+
+        const ScriptFuzzCase          fuzzCase(bytes.data(), bytes.size(), options.children, options.fuzzMode);
+        const ScriptFuzzCase::Outcome outcome = fuzzCase.run();
+
+        if (!outcome.compiled) {
+            continue;
+        }
+
+        ++compiled;
+
+        if (!outcome.bound.isBounded) {
+            ++unbounded;
+        }
+
+        const bool fits = blockCost(outcome.bound, options) <= options.blockBudget;
+
+        if (!fits) {
+            ++overBudget;
+        }
+
+        if (!outcome.withinBound()) {
+            ++violations;
+        }
+
+        if ((!outcome.withinBound() || !fits) && reported < options.maxReported) {
+            ++reported;
+
+            std::printf("case %d: %s, %d children, %d steps measured, bound %d%s\n", index,
+                        outcome.withinBound() ? "over block budget" : "BOUND VIOLATED", outcome.childCount,
+                        outcome.stepsUsed, outcome.bound.worstCaseSteps(outcome.childCount),
+                        outcome.bound.isBounded ? "" : " (unbounded)");
+
+            printScript(fuzzCase.getScript());
+        }
+    }
+
+    std::printf("fuzzed %d cases: %d compiled, %d unbounded, %d over the block budget, %d bound violations\n",
+                options.fuzzCases, compiled, unbounded, overBudget, violations);
+
+    return violations == 0;
+}
+}
+
+int main(int argc, char** argv)
+{
+    const juce::ArgumentList arguments(argc, argv);
+
+    Options options;
+
+    options.children           = intFor(arguments, "--children",             options.children);
+    options.traversals         = intFor(arguments, "--traversals",           options.traversals);
+    options.selectionsPerBlock = intFor(arguments, "--selections-per-block", options.selectionsPerBlock);
+    options.blockBudget        = intFor(arguments, "--block-budget",         options.blockBudget);
+    options.fuzzCases          = intFor(arguments, "--fuzz",                 options.fuzzCases);
+    options.seed               = intFor(arguments, "--seed",                 options.seed);
+    options.maxReported        = intFor(arguments, "--report",               options.maxReported);
+
+    if (arguments.containsOption("--raw")) {
+        options.fuzzMode = ScriptFuzzCase::Mode::RawBytes;
+    }
+
+    juce::Array<juce::File> inputs;
+
+    for (int i = 0; i < arguments.size(); ++i) {
+        const auto& argument = arguments[i];
+
+        if (argument.isOption()) {
+            if (argument != "--builtin" && argument != "--raw" && !argument.text.containsChar('=')) {
+                ++i;
+            }
+            continue;
+        }
+
+        inputs.add(argument.resolveAsFile());
+    }
+
+    const bool analyseBuiltIn = arguments.containsOption("--builtin");
+
+    if ((inputs.isEmpty() && !analyseBuiltIn && options.fuzzCases <= 0) || options.children < 0
+        || options.traversals <= 0 || options.selectionsPerBlock <= 0 || options.blockBudget <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    bool passed = true;
+
+    if (analyseBuiltIn) {
+        passed &= analyseRule("builtin", RuleCompiler::builtInRuleSource(), options);
+    }
+
+    for (const juce::File& input : inputs) {
+        if (!input.existsAsFile()) {
+            std::printf("%s: could not read rule\n", input.getFullPathName().toRawUTF8());
+            passed = false;
+            continue;
+        }
+
+        passed &= analyseRule(input.getFullPathName(), input.loadFileAsString(), options);
+    }
+
+    if (options.fuzzCases > 0) {
+        passed &= runFuzzer(options);
+    }
+
+    return passed ? 0 : 1;
+}
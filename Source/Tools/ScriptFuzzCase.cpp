@@ -0,0 +1,342 @@
+#include "ScriptFuzzCase.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace
+{
+constexpr RTNode::NodeType childTypes[] = {
+    RTNode::NodeType::Node,
+    RTNode::NodeType::Node,
+    RTNode::NodeType::Node,
+    RTNode::NodeType::Alternative,
+    RTNode::NodeType::Modulator,
+    RTNode::NodeType::ModulatorRoot,
+    RTNode::NodeType::TraversalFlagData
+};
+
+constexpr int boundaryOperands[] = {
+    std::numeric_limits<int>::min(),
+    std::numeric_limits<int>::min() + 1,
+    -65536,
+    -2,
+    -1,
+    0,
+    1,
+    2,
+    65535,
+    std::numeric_limits<int>::max() - 1,
+    std::numeric_limits<int>::max()
+};
+
+bool isPlayableChild(RTNode::NodeType type)
+{
+    return type == RTNode::NodeType::Node || type == RTNode::NodeType::Alternative;
+}
+
+bool isJump(ScriptOpcode opcode)
+{
+    return opcode == ScriptOpcode::Jump || opcode == ScriptOpcode::JumpIfFalse || opcode == ScriptOpcode::JumpIfTrue;
+}
+}
+
+int ScriptFuzzCase::ByteReader::next(int lowest, int highest)
+{
+    if (position >= size || highest <= lowest) {
+        return lowest;
+    }
+
+    const auto range = static_cast<unsigned>(highest - lowest) + 1;
+
+    unsigned value = data[position++];
+
+    if (range > 256 && position < size) {
+        value = (value << 8) | data[position++];
+    }
+
+    return lowest + static_cast<int>(value % range);
+}
+
+int ScriptFuzzCase::ByteReader::nextInt()
+{
+    std::uint32_t value = 0;
+
+    for (int byte = 0; byte < 4 && position < size; ++byte) {
+        value = (value << 8) | data[position++];
+    }
+
+    return static_cast<int>(value);
+}
+
+ScriptFuzzCase::ScriptFuzzCase(const std::uint8_t* data, std::size_t size, int maxChildren, Mode mode)
+{
+    ByteReader reader(data, size);
+
+    buildGraph(reader, std::max(0, maxChildren));
+
+    if (mode == Mode::RawBytes) {
+        buildRawScript(reader);
+    }
+    else {
+        buildScript(reader);
+    }
+}
+
+int ScriptFuzzCase::nextOperand(ByteReader& reader, int smallLimit)
+{
+    switch (reader.next(0, 3)) {
+        case 0:  return boundaryOperands[reader.next(0, static_cast<int>(std::size(boundaryOperands)) - 1)];
+        case 1:  return reader.nextInt();
+        default: return reader.next(-8, std::max(8, smallLimit));
+    }
+}
+
+void ScriptFuzzCase::buildGraph(ByteReader& reader, int maxChildren)
+{
+    childCount            = reader.next(0, maxChildren);
+    parentCount           = reader.next(0, 64);
+    traversalId           = reader.next(0, 8);
+    allowTreeJumpChildren = reader.next(0, 1) == 1;
+
+    NodeMap nodeMap;
+
+    RTNode parent;
+    parent.nodeID   = parentId;
+    parent.graphID  = parentId;
+    parent.nodeType = RTNode::NodeType::RootNode;
+
+    for (int index = 0; index < childCount; ++index) {
+        RTNode child;
+        child.nodeID            = parentId + 1 + index;
+        child.parentId          = parentId;
+        child.graphID           = parentId;
+        child.nodeType          = childTypes[reader.next(0, static_cast<int>(std::size(childTypes)) - 1)];
+        child.countLimit        = reader.next(0, 8);
+        child.triggerLimit      = reader.next(0, 3);
+        child.repeatValue       = reader.next(1, 4);
+        child.pitchOffset       = reader.next(-12, 12);
+        child.switchCountLimit  = reader.next(0, 3);
+        child.subLoopCountLimit = reader.next(0, 3);
+
+        parent.children.push_back(child.nodeID);
+        parent.durationMap[child.nodeID] = reader.next(0, 8) * 50;
+
+        if (reader.next(0, 7) == 0) {
+            parent.treeJumpChildren.insert(child.nodeID);
+        }
+
+        nodeMap[child.nodeID] = std::move(child);
+    }
+
+    nodeMap[parentId] = std::move(parent);
+
+    nodes = RTNodeDirectory().withGraph(std::make_shared<RTCompiledGraph>(RTCompiledGraph::compile(nodeMap, parentId)));
+
+    nodeState.prepare(NodeStateTable::capacityFor(nodes.stateSlotCount()));
+    nodeState.bind(&nodes);
+    nodeState.set(NodeStateSlot::LastNode, parentId, reader.next(-1, childCount + 1));
+
+    for (int nodeId = parentId + 1; nodeId <= parentId + childCount; ++nodeId) {
+        nodeState.set(NodeStateSlot::Trigger, nodeId, reader.next(0, 3));
+        nodeState.set(NodeStateSlot::Count,   nodeId, reader.next(0, 16));
+    }
+}
+
+void ScriptFuzzCase::buildScript(ByteReader& reader)
+{
+    script.localCount = reader.next(0, 8);
+
+    if (reader.next(0, 3) == 0) {
+        script.stepBudget = reader.next(0, 512);
+    }
+
+    const int statements = reader.next(1, 24);
+
+    for (int statement = 0; statement < statements && !reader.exhausted(); ++statement) {
+        if (reader.next(0, 5) == 0) {
+            emitChildLoop(reader);
+        }
+        else {
+            emitStatement(reader, false);
+        }
+    }
+
+    auto& code = script.instructions;
+
+    const int instructionCount = static_cast<int>(code.size());
+
+    for (auto& instruction : code) {
+        if (isJump(instruction.opcode)) {
+            instruction.operand = std::clamp(instruction.operand, 0, instructionCount);
+        }
+    }
+
+    if (reader.next(0, 1) == 1) {
+        code.push_back({ ScriptOpcode::PushLocal, reader.next(0, 7) });
+        code.push_back({ ScriptOpcode::Return });
+    }
+}
+
+void ScriptFuzzCase::buildRawScript(ByteReader& reader)
+{
+    script.localCount = reader.next(0, RTScript::maxLocals);
+
+    if (reader.next(0, 3) == 0) {
+        script.stepBudget = reader.next(0, 512);
+    }
+
+    auto& code = script.instructions;
+
+    while (!reader.exhausted() && static_cast<int>(code.size()) < maxRawInstructions) {
+        const auto opcode = static_cast<ScriptOpcode>(reader.next(0, static_cast<int>(ScriptOpcode::Return) + 1));
+
+        code.push_back({ opcode, nextOperand(reader, static_cast<int>(code.size()) + 4) });
+    }
+}
+
+void ScriptFuzzCase::emitStatement(ByteReader& reader, bool insideLoop)
+{
+    auto& code = script.instructions;
+
+    const int  here  = static_cast<int>(code.size());
+    const int  local = reader.next(0, 7);
+    const auto field = reader.next(0, static_cast<int>(ScriptField::FieldCount) - 1);
+
+    switch (reader.next(0, 7)) {
+        case 0:
+            code.push_back({ ScriptOpcode::PushField, field });
+            code.push_back({ ScriptOpcode::StoreLocal, local });
+            break;
+
+        case 1:
+            code.push_back({ ScriptOpcode::PushField, field });
+            code.push_back({ ScriptOpcode::PushLocal, local });
+            code.push_back({ ScriptOpcode::Greater });
+            code.push_back({ ScriptOpcode::JumpIfFalse, here + 4 + reader.next(0, 6) });
+            break;
+
+        case 2:
+            code.push_back({ ScriptOpcode::PushField, ScriptField::ParentCount });
+            code.push_back({ ScriptOpcode::PushField, field });
+            code.push_back({ ScriptOpcode::Modulo });
+            code.push_back({ ScriptOpcode::PushInt, 0 });
+            code.push_back({ ScriptOpcode::Equal });
+            code.push_back({ ScriptOpcode::JumpIfFalse, here + 6 + reader.next(0, 6) });
+            break;
+
+        case 3:
+            code.push_back({ ScriptOpcode::PushLocal, local });
+            code.push_back({ ScriptOpcode::PushInt, nextOperand(reader, 4) });
+            code.push_back({ static_cast<ScriptOpcode>(reader.next(static_cast<int>(ScriptOpcode::Add),
+                                                                   static_cast<int>(ScriptOpcode::LogicalOr))) });
+            code.push_back({ ScriptOpcode::StoreLocal, local });
+            break;
+
+        case 4:
+            code.push_back({ ScriptOpcode::PushLocal, local });
+            code.push_back({ ScriptOpcode::Return });
+            break;
+
+        case 5:
+            if (!insideLoop) {
+                code.push_back({ ScriptOpcode::PushField, field });
+                code.push_back({ reader.next(0, 1) == 0 ? ScriptOpcode::JumpIfFalse : ScriptOpcode::JumpIfTrue,
+                                 reader.next(0, here + 8) });
+                break;
+            }
+            [[fallthrough]];
+
+        default: {
+            const auto opcode = static_cast<ScriptOpcode>(reader.next(0, static_cast<int>(ScriptOpcode::Return)));
+
+            int operand = 0;
+
+            switch (opcode) {
+                case ScriptOpcode::PushInt:    operand = nextOperand(reader, 8);  break;
+                case ScriptOpcode::PushLocal:
+                case ScriptOpcode::StoreLocal: operand = local;                   break;
+                case ScriptOpcode::PushField:  operand = field;                   break;
+                case ScriptOpcode::Jump:
+                case ScriptOpcode::JumpIfFalse:
+                case ScriptOpcode::JumpIfTrue: operand = insideLoop ? here + 1 + reader.next(0, 4)
+                                                                    : reader.next(0, here + 8); break;
+                default:                                                          break;
+            }
+
+            code.push_back({ opcode, operand });
+            break;
+        }
+    }
+}
+
+void ScriptFuzzCase::emitChildLoop(ByteReader& reader)
+{
+    auto& code = script.instructions;
+
+    const int index = reader.next(0, 7);
+
+    code.push_back({ ScriptOpcode::PushInt, reader.next(0, 1) });
+    code.push_back({ ScriptOpcode::StoreLocal, index });
+
+    const int header = static_cast<int>(code.size());
+
+    code.push_back({ ScriptOpcode::PushLocal, index });
+    code.push_back({ ScriptOpcode::PushField, ScriptField::ParentChildCount });
+    code.push_back({ ScriptOpcode::Less });
+    code.push_back({ ScriptOpcode::JumpIfFalse, 0 });
+    code.push_back({ ScriptOpcode::PushLocal, index });
+    code.push_back({ ScriptOpcode::LoadChild });
+
+    const int bodyStatements = reader.next(0, 6);
+
+    for (int statement = 0; statement < bodyStatements; ++statement) {
+        emitStatement(reader, true);
+    }
+
+    const int increment = static_cast<int>(code.size());
+
+    for (int pc = header + 6; pc < increment; ++pc) {
+        auto& instruction = code[static_cast<std::size_t>(pc)];
+
+        if (isJump(instruction.opcode)) {
+            instruction.operand = std::clamp(instruction.operand, pc + 1, increment);
+        }
+    }
+
+    code.push_back({ ScriptOpcode::PushLocal, index });
+    code.push_back({ ScriptOpcode::PushInt, reader.next(1, 2) });
+    code.push_back({ ScriptOpcode::Add });
+    code.push_back({ ScriptOpcode::StoreLocal, index });
+    code.push_back({ ScriptOpcode::Jump, reader.next(0, 15) == 0 ? header + reader.next(-2, 6) : header });
+
+    code[static_cast<std::size_t>(header) + 3].operand = static_cast<int>(code.size());
+}
+
+ScriptFuzzCase::Outcome ScriptFuzzCase::run() const
+{
+    Outcome outcome;
+
+    outcome.childCount = childCount;
+
+    const auto program = ScriptTraversalRule::compile(script, ScriptTraversalRule::StepAccounting::Always);
+
+    if (program == nullptr) {
+        return outcome;
+    }
+
+    outcome.compiled = true;
+    outcome.bound    = analyseScriptCost(program->optimisedScript);
+
+    ScriptTraversalRule rule;
+    rule.setProgram(program.get());
+
+    const RTNode& parent = nodes.at(parentId);
+
+    const RuleContext context { nodes, nodes.graphOf(parent), parent, parentCount, traversalId,
+                                &isPlayableChild, nodeState, allowTreeJumpChildren };
+
+    outcome.selectedChild = rule.selectChild(context, outcome.stepsUsed);
+
+    return outcome;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../Audio/ScriptCostAnalysis.h"
+#include "../Audio/ScriptTraversalRule.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class ScriptFuzzCase
+{
+public:
+
+    static constexpr int defaultMaxChildren = 64;
+    static constexpr int maxRawInstructions = 256;
+
+    enum class Mode
+    {
+        Structured,
+        RawBytes
+    };
+
+    ScriptFuzzCase(const std::uint8_t* data, std::size_t size, int maxChildren = defaultMaxChildren,
+                   Mode mode = Mode::Structured);
+
+    struct Outcome
+    {
+        bool            compiled      = false;
+        int             childCount    = 0;
+        int             selectedChild = -1;
+        int             stepsUsed     = 0;
+        ScriptCostBound bound;
+
+        bool withinBound() const { return !compiled || stepsUsed <= bound.worstCaseSteps(childCount); }
+    };
+
+    Outcome run() const;
+
+    const RTScript& getScript() const { return script; }
+
+    int getChildCount() const { return childCount; }
+
+private:
+
+    class ByteReader
+    {
+    public:
+
+        ByteReader(const std::uint8_t* bytes, std::size_t byteCount) : data(bytes), size(byteCount) {}
+
+        int next(int lowest, int highest);
+        int nextInt();
+
+        bool exhausted() const { return position >= size; }
+
+    private:
+
+        const std::uint8_t* data;
+        std::size_t         size;
+        std::size_t         position = 0;
+    };
+
+    void buildGraph(ByteReader& reader, int maxChildren);
+    void buildScript(ByteReader& reader);
+    void buildRawScript(ByteReader& reader);
+
+    void emitStatement(ByteReader& reader, bool insideLoop);
+    void emitChildLoop(ByteReader& reader);
+
+    static int nextOperand(ByteReader& reader, int smallLimit);
+
+    static constexpr int parentId = 1;
+
+    RTScript script;
+
+    RTNodeDirectory nodes;
+    NodeStateTable  nodeState;
+
+    int  childCount            = 0;
+    int  parentCount           = 0;
+    int  traversalId           = 0;
+    bool allowTreeJumpChildren = false;
+};
@@ -0,0 +1,24 @@
+#include "ScriptFuzzCase.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+
+    const auto mode = (data[0] & 1) != 0 ? ScriptFuzzCase::Mode::RawBytes : ScriptFuzzCase::Mode::Structured;
+
+    const ScriptFuzzCase          fuzzCase(data + 1, size - 1, ScriptFuzzCase::defaultMaxChildren, mode);
+    const ScriptFuzzCase::Outcome outcome = fuzzCase.run();
+
+    if (!outcome.withinBound()) {
+        std::fprintf(stderr, "script ran %d steps over %d children, static bound %d\n", outcome.stepsUsed,
+                     outcome.childCount, outcome.bound.worstCaseSteps(outcome.childCount));
+        std::abort();
+    }
+
+    return 0;
+}
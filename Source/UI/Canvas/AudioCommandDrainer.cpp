@@ -8,118 +8,251 @@
 #include "DanglingArrowLayer.h"
 #include "../Node/Node.h"
 #include "../Node/Arrow.h"
-#include "../../Graph/ValueTreeIdentifiers.h"
-#include "../../Graph/ValueTreeState.h"
 #include "../../Plugin/PluginProcessor.h"
 #include "../../Util/ApplicationContext.h"
 
+#include <bit>
+#include <cmath>
+
 AudioCommandDrainer::AudioCommandDrainer(NodeCanvas& canvasRef, ApplicationContext& context)
     : canvas(canvasRef), applicationContext(context)
 {
 }
 
-void AudioCommandDrainer::drainAll() const
+AudioUIBridge& AudioCommandDrainer::bridge() const
+{
+    return applicationContext.processor->engine.eventManager.bridge;
+}
+
+void AudioCommandDrainer::drainAll()
 {
-    drainHighlights();
+    bridge().takeVisualChanges();
+
+    hasAudioClock = bridge().readAudioClock(audioClock);
+
+    audioClock.latencySamples += applicationContext.processor->getDeviceOutputLatencySamples();
+    drainMs       = juce::Time::getMillisecondCounterHiRes();
+
+    drainNodeStates();
     drainArrowResets();
     drainProgress();
-    drainCounts();
 }
 
-juce::Colour AudioCommandDrainer::getTraversalColour(int traversalId) const
+void AudioCommandDrainer::timerCallback()
 {
-    const juce::ValueTree traversalData = applicationContext.valueTreeState->traversalMap
-        .getChildWithProperty(ValueTreeIdentifiers::TraversalId, traversalId);
-
-    if (!traversalData.isValid()) {
-        return juce::Colours::white;
-    }
+    drainMs = juce::Time::getMillisecondCounterHiRes();
 
-    const juce::String colourString = traversalData.getProperty(ValueTreeIdentifiers::TraversalColour).toString();
+    applyDueNodeVisuals();
+}
 
-    if (colourString.isEmpty()) {
-        return juce::Colours::white;
+double AudioCommandDrainer::dueTimeFor(std::int64_t samplePosition) const
+{
+    if (!hasAudioClock) {
+        return drainMs;
     }
 
-    return juce::Colour::fromString(colourString);
+    return juce::jmin(AudioUIBridge::wallClockMsAt(audioClock, samplePosition), drainMs + maxScheduleAheadMs);
 }
 
-void AudioCommandDrainer::drainHighlights() const
+void AudioCommandDrainer::drainNodeStates()
 {
-    applicationContext.processor->eventManager.bridge.highlights.drain(
-        [this](const AudioUIBridge::HighlightCommand& command)
+    bridge().nodeVisuals.collectChanges(seenNodeVersions,
+        [this](int entry, std::int64_t nodeId, const AudioUIBridge::NodeVisualState& state)
     {
-        if (command.nodeId == AudioUIBridge::allNodes) {
-            canvas.nodeManager.clearHighlights();
-            return;
+        if (appliedNodeVisuals.size() <= static_cast<std::size_t>(entry)) {
+            appliedNodeVisuals.resize(static_cast<std::size_t>(entry) + 1);
         }
 
-        Node* const node = canvas.nodeManager.find(command.nodeId);
-        if (node == nullptr) {
+        AppliedNodeVisual& applied = appliedNodeVisuals[static_cast<std::size_t>(entry)];
+
+        const double dueMs = dueTimeFor(state.changedSample);
+
+        if (applied.pendingCount == 0 && dueMs <= drainMs + dueToleranceMs) {
+            applyNodeVisual(entry, static_cast<int>(nodeId), state);
             return;
         }
 
-        juce::Colour highlightColour = juce::Colours::white;
+        ++applied.pendingCount;
+        pendingNodeVisuals.push_back({ dueMs, entry, static_cast<int>(nodeId), state });
+    });
+
+    applyDueNodeVisuals();
+}
+
+void AudioCommandDrainer::applyDueNodeVisuals()
+{
+    blockedEntries.assign(appliedNodeVisuals.size(), false);
+
+    double nextDueMs = 0.0;
+    bool   hasNext   = false;
+
+    std::size_t kept = 0;
 
-        if (command.shouldHighlight) {
-            highlightColour = getTraversalColour(command.traversalId);
+    for (std::size_t index = 0; index < pendingNodeVisuals.size(); ++index) {
+        const PendingNodeVisual pending = pendingNodeVisuals[index];
+        const auto              entry   = static_cast<std::size_t>(pending.entry);
+
+        if (blockedEntries[entry] || pending.dueMs > drainMs + dueToleranceMs) {
+            blockedEntries[entry] = true;
+            nextDueMs = hasNext ? juce::jmin(nextDueMs, pending.dueMs) : pending.dueMs;
+            hasNext   = true;
+
+            pendingNodeVisuals[kept++] = pending;
+            continue;
         }
 
-        node->setHighlightVisual(command.traversalId, command.shouldHighlight, highlightColour);
-    });
+        --appliedNodeVisuals[entry].pendingCount;
+        applyNodeVisual(pending.entry, pending.nodeId, pending.state);
+    }
+
+    pendingNodeVisuals.resize(kept);
+
+    if (!hasNext) {
+        stopTimer();
+        return;
+    }
+
+    startTimer(juce::jmax(1, static_cast<int>(std::ceil(nextDueMs - drainMs))));
+}
+
+void AudioCommandDrainer::applyNodeVisual(int entry, int nodeId, const AudioUIBridge::NodeVisualState& state)
+{
+    AppliedNodeVisual& applied = appliedNodeVisuals[static_cast<std::size_t>(entry)];
+
+    const AppliedNodeVisual previous = applied.nodeId == nodeId ? applied : AppliedNodeVisual {};
+    applied.nodeId        = nodeId;
+    applied.highlightMask = state.highlightMask;
+    applied.pulseCount    = state.pulseCount;
+
+    applied.unmaskedTraversalId = state.unmaskedTraversalId;
+    applied.unmaskedCount       = state.unmaskedCount;
+
+    Node* const node = canvas.nodeManager.find(nodeId);
+    if (node == nullptr) {
+        return;
+    }
+
+    applyHighlights(*node, previous, state);
+
+    const int countLimit = juce::jmax(1, state.countLimit);
+
+    if (state.hasCount && (node->displayCurrentCount != state.currentCount || node->displayCountLimit != countLimit)) {
+        node->displayCurrentCount = state.currentCount;
+        node->displayCountLimit   = countLimit;
+        node->repaint();
+    }
 }
 
-void AudioCommandDrainer::drainProgress() const
+void AudioCommandDrainer::applyHighlights(Node& node, const AppliedNodeVisual& previous,
+                                          const AudioUIBridge::NodeVisualState& state) const
 {
-    applicationContext.processor->eventManager.bridge.progress.drain(
-        [this](const AudioUIBridge::ProgressCommand& command)
+    std::uint64_t turnedOn  = state.highlightMask & ~previous.highlightMask;
+    std::uint64_t turnedOff = previous.highlightMask & ~state.highlightMask;
+
+    if (state.pulseCount != previous.pulseCount) {
+        const std::uint64_t pulseBit = AudioUIBridge::traversalBit(state.pulseTraversalId);
+
+        if ((state.highlightMask & pulseBit) != 0) {
+            turnedOn |= pulseBit;
+        }
+        else {
+            node.setHighlightVisual(state.pulseTraversalId, true, canvas.traversalColours.colourFor(state.pulseTraversalId));
+            turnedOff |= pulseBit;
+        }
+    }
+
+    auto traversalIdOf = [](std::uint64_t bits) {
+        return std::countr_zero(bits) + AudioUIBridge::minMaskedTraversalId;
+    };
+
+    const bool clearedAll = (turnedOff & AudioUIBridge::traversalBit(-1)) != 0;
+
+    if (clearedAll) {
+        node.setHighlightVisual(-1, false, juce::Colours::white);
+        turnedOn = state.highlightMask;
+    }
+    else {
+        for (std::uint64_t bits = turnedOff; bits != 0; bits &= bits - 1) {
+            node.setHighlightVisual(traversalIdOf(bits), false, juce::Colours::white);
+        }
+    }
+
+    for (std::uint64_t bits = turnedOn; bits != 0; bits &= bits - 1) {
+        const int traversalId = traversalIdOf(bits);
+        node.setHighlightVisual(traversalId, true, canvas.traversalColours.colourFor(traversalId));
+    }
+
+    const bool wasUnmaskedOn = previous.unmaskedCount > 0 && !clearedAll;
+    const bool isUnmaskedOn  = state.unmaskedCount > 0;
+    const bool unmaskedMoved = previous.unmaskedTraversalId != state.unmaskedTraversalId;
+
+    if (wasUnmaskedOn && (!isUnmaskedOn || unmaskedMoved)) {
+        node.setHighlightVisual(previous.unmaskedTraversalId, false, juce::Colours::white);
+    }
+
+    if (isUnmaskedOn && (!wasUnmaskedOn || unmaskedMoved || state.unmaskedCount > previous.unmaskedCount)) {
+        node.setHighlightVisual(state.unmaskedTraversalId, true,
+                                canvas.traversalColours.colourFor(state.unmaskedTraversalId));
+    }
+}
+
+bool AudioCommandDrainer::isSupersededByReset(const AudioUIBridge::ArrowVisualState& state) const
+{
+    for (const auto& reset : drainedResets) {
+        if (reset.rootId == state.graphId && reset.traversalId == state.traversalId
+            && AudioUIBridge::isStampAfter(reset.stamp, state.stamp)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void AudioCommandDrainer::drainProgress()
+{
+    bridge().arrowVisuals.collectChanges(seenArrowVersions,
+        [this](int, std::int64_t arrowKey, const AudioUIBridge::ArrowVisualState& state)
     {
-        Node* const parentNode = canvas.nodeManager.find(command.parentNodeId);
+        if (isSupersededByReset(state)) {
+            return;
+        }
+
+        const int parentNodeId = static_cast<int>(arrowKey >> 32);
+        const int childNodeId  = static_cast<int>(static_cast<std::uint32_t>(arrowKey));
+
+        Node* const parentNode = canvas.nodeManager.find(parentNodeId);
         if (parentNode == nullptr) {
             return;
         }
 
-        const juce::Colour progressColour = getTraversalColour(command.traversalId);
+        const juce::Colour progressColour = canvas.traversalColours.colourFor(state.traversalId);
+        const double       startMs        = dueTimeFor(state.startSample);
 
-        if (command.parentNodeId == command.childNodeId) {
+        if (parentNodeId == childNodeId) {
             for (Arrow* const arrow : canvas.arrowManager.all()) {
                 if (arrow->isDangling() && arrow->startNode == parentNode) {
-                    arrow->startProgress(command.traversalId, command.durationMs, progressColour, command.isConnection);
+                    arrow->startProgress(state.traversalId, state.durationMs, progressColour, state.isConnection, startMs);
                 }
             }
             return;
         }
 
-        const auto arrowIt = parentNode->nodeArrows.find(command.childNodeId);
+        const auto arrowIt = parentNode->nodeArrows.find(childNodeId);
         if (arrowIt == parentNode->nodeArrows.end() || arrowIt->second == nullptr) {
             return;
         }
 
-        arrowIt->second->startProgress(command.traversalId, command.durationMs, progressColour, command.isConnection);
+        arrowIt->second->startProgress(state.traversalId, state.durationMs, progressColour, state.isConnection, startMs);
     });
 }
 
-void AudioCommandDrainer::drainArrowResets() const
+void AudioCommandDrainer::drainArrowResets()
 {
-    applicationContext.processor->eventManager.bridge.arrowResets.drain(
-        [this](const AudioUIBridge::ResetCommand& command)
-    {
-        canvas.arrowManager.resetGraphProgress(command.rootId, command.traversalId);
-    });
-}
+    drainedResets.clear();
 
-void AudioCommandDrainer::drainCounts() const
-{
-    applicationContext.processor->eventManager.bridge.counts.drain(
-        [this](const AudioUIBridge::CountCommand& command)
+    bridge().arrowResets.drain([this](const AudioUIBridge::ResetCommand& command)
     {
-        Node* const node = canvas.nodeManager.find(command.nodeId);
-        if (node == nullptr) {
-            return;
-        }
-
-        node->displayCurrentCount = command.currentCount;
-        node->displayCountLimit   = juce::jmax(1, command.countLimit);
-        node->repaint();
+        drainedResets.push_back(command);
+        canvas.arrowManager.resetGraphProgress(command.rootId, command.traversalId);
     });
 }
@@ -6,27 +6,77 @@
 
 #include <juce_gui_basics/juce_gui_basics.h>
 
+#include "../../Audio/AudioUIBridge.h"
+
+#include <cstdint>
+#include <vector>
+
 struct ApplicationContext;
 
+class Node;
 class NodeCanvas;
 
-class AudioCommandDrainer {
+class AudioCommandDrainer : private juce::Timer {
 
 public:
 
     AudioCommandDrainer(NodeCanvas& canvas, ApplicationContext& context);
 
-    void drainAll() const;
+    void drainAll();
 
 private:
 
-    void drainHighlights() const;
-    void drainProgress() const;
-    void drainArrowResets() const;
-    void drainCounts() const;
+    static constexpr double dueToleranceMs     = 4.0;
+    static constexpr double maxScheduleAheadMs = 500.0;
+
+    struct AppliedNodeVisual
+    {
+        int           nodeId        = -1;
+        std::uint64_t highlightMask = 0;
+        std::uint32_t pulseCount    = 0;
+        int           pendingCount  = 0;
+
+        int           unmaskedTraversalId = -1;
+        int           unmaskedCount       = 0;
+    };
+
+    struct PendingNodeVisual
+    {
+        double                         dueMs  = 0.0;
+        int                            entry  = 0;
+        int                            nodeId = 0;
+        AudioUIBridge::NodeVisualState state;
+    };
+
+    void timerCallback() override;
+
+    void drainNodeStates();
+    void drainProgress();
+    void drainArrowResets();
 
-    juce::Colour getTraversalColour(int traversalId) const;
+    double dueTimeFor(std::int64_t samplePosition) const;
+
+    void applyNodeVisual(int entry, int nodeId, const AudioUIBridge::NodeVisualState& state);
+    void applyDueNodeVisuals();
+
+    void applyHighlights(Node& node, const AppliedNodeVisual& previous,
+                         const AudioUIBridge::NodeVisualState& state) const;
+
+    bool isSupersededByReset(const AudioUIBridge::ArrowVisualState& state) const;
+
+    AudioUIBridge& bridge() const;
 
     NodeCanvas&         canvas;
     ApplicationContext& applicationContext;
+
+    std::vector<std::uint32_t>               seenNodeVersions;
+    std::vector<std::uint32_t>               seenArrowVersions;
+    std::vector<AppliedNodeVisual>           appliedNodeVisuals;
+    std::vector<AudioUIBridge::ResetCommand> drainedResets;
+    std::vector<PendingNodeVisual>           pendingNodeVisuals;
+    std::vector<bool>                        blockedEntries;
+
+    AudioUIBridge::AudioClock audioClock;
+    bool                      hasAudioClock = false;
+    double                    drainMs       = 0.0;
 };
@@ -78,7 +78,7 @@ void NodeCanvas::handleAsyncUpdate() {
 
                 auto emptyGraph = std::make_shared<RTGraph>();
                 emptyGraph->graphID = rootNodeId;
-                applicationContext.processor->setNewGraph(emptyGraph);
+                applicationContext.processor->engine.setNewGraph(emptyGraph);
             }
         }
         else if (updateType == AsyncUpdateType::NodeMoved) {
@@ -116,14 +116,14 @@ void NodeCanvas::handleAsyncUpdate() {
 void NodeCanvas::setProcessorPlayblack(bool isPlaying)
 {
     start = isPlaying;
-    applicationContext.processor->isPlaying.store(start);
+    applicationContext.processor->engine.isPlaying.store(start);
 
     if (isPlaying) {
         nodeManager.equipRootTraversals();
     }
 
     for(auto& [graphID,graph] : applicationContext.rtGraphBuilder->rtGraphs) {
-        applicationContext.processor->setNewGraph(graph);
+        applicationContext.processor->engine.setNewGraph(graph);
     }
 
     if (! isPlaying) {
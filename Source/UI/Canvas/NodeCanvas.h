@@ -19,6 +19,7 @@
 #include "NodeCanvasTreeListener.h"
 #include "ValueField.h"
 #include "AudioCommandDrainer.h"
+#include "TraversalColourTable.h"
 #include "DanglingArrowLayer.h"
 #include "NodeManager.h"
 #include "ArrowManager.h"
@@ -78,6 +79,7 @@ class NodeCanvas : public juce::Component, public juce::AsyncUpdater {
 
         NodeManager         nodeManager        { *this, applicationContext };
         ArrowManager        arrowManager       { *this, applicationContext };
+        TraversalColourTable traversalColours   { applicationContext.valueTreeState->traversalMap };
         AudioCommandDrainer drainer            { *this, applicationContext };
         DanglingArrowLayer  danglingArrowLayer { *this, applicationContext };
         CanvasHitTester     hitTester          { *this };
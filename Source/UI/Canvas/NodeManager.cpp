@@ -13,6 +13,7 @@
 #include "../../Graph/ValueTreeState.h"
 #include "../../Graph/ValueTreeIdentifiers.h"
 #include "../../Graph/RTGraphBuilder.h"
+#include "../../Plugin/PluginProcessor.h"
 #include "../../Util/ApplicationContext.h"
 
 NodeManager::NodeManager(NodeCanvas& canvasRef, ApplicationContext& context)
@@ -209,6 +210,30 @@ void NodeManager::setPosition(int nodeId) const
     canvas.arrowManager.refreshFor(node);
 }
 
+static bool collectTreeAncestorIds(const RTNodeDirectory& nodes, int nodeId, std::unordered_set<int>& ancestors)
+{
+    const RTNodeRef nodeRef = nodes.ref(nodeId);
+
+    if (!nodeRef) {
+        return false;
+    }
+
+    const RTCompiledGraph& graph = *nodeRef.graph;
+    const auto             index = static_cast<std::size_t>(nodeRef.index);
+
+    if (graph.treeEnter[index] == -1 || graph.treeLeavesGraph[index] != 0) {
+        return false;
+    }
+
+    for (int ancestorIndex = 0; ancestorIndex < graph.size(); ++ancestorIndex) {
+        if (graph.ownsNode(ancestorIndex) && graph.isTreeDescendant(nodeRef.index, ancestorIndex)) {
+            ancestors.insert(graph.nodeIds[static_cast<std::size_t>(ancestorIndex)]);
+        }
+    }
+
+    return true;
+}
+
 static std::unordered_set<int> collectAncestorIds(const juce::ValueTree& nodeMap, int nodeId)
 {
     std::unordered_set<int> ancestors;
@@ -244,7 +269,14 @@ void NodeManager::moveDescendants(juce::ValueTree nodeValueTree, int deltaX, int
 {
     const int rootId = (int) nodeValueTree.getProperty(ValueTreeIdentifiers::Id);
 
-    std::unordered_set<int> visited = collectAncestorIds(applicationContext.valueTreeState->nodeMap, rootId);
+    std::unordered_set<int> visited;
+
+    const auto* snapshot = applicationContext.processor->engine.getPublishedSnapshot();
+
+    if (snapshot == nullptr || !collectTreeAncestorIds(snapshot->nodes, rootId, visited)) {
+        visited = collectAncestorIds(applicationContext.valueTreeState->nodeMap, rootId);
+    }
+
     visited.insert(rootId);
 
     moveDescendants(nodeValueTree, deltaX, deltaY, visited);
@@ -0,0 +1,72 @@
+#include "TraversalColourTable.h"
+#include "../../Graph/ValueTreeIdentifiers.h"
+
+TraversalColourTable::TraversalColourTable(juce::ValueTree traversalMapIn) : traversalMap(std::move(traversalMapIn))
+{
+    traversalMap.addListener(this);
+    rebuild();
+}
+
+TraversalColourTable::~TraversalColourTable()
+{
+    traversalMap.removeListener(this);
+}
+
+void TraversalColourTable::valueTreeChildAdded(juce::ValueTree& parent, juce::ValueTree& child)
+{
+    if (parent == traversalMap) {
+        store(child);
+    }
+}
+
+void TraversalColourTable::valueTreeChildRemoved(juce::ValueTree& parent, juce::ValueTree&, int)
+{
+    if (parent == traversalMap) {
+        rebuild();
+    }
+}
+
+void TraversalColourTable::valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& propertyIdentifier)
+{
+    if (tree.getParent() != traversalMap) {
+        return;
+    }
+
+    if (propertyIdentifier == ValueTreeIdentifiers::TraversalId) {
+        rebuild();
+    }
+    else if (propertyIdentifier == ValueTreeIdentifiers::TraversalColour) {
+        store(tree);
+    }
+}
+
+void TraversalColourTable::rebuild()
+{
+    colours.clear();
+
+    for (int i = 0; i < traversalMap.getNumChildren(); ++i) {
+        store(traversalMap.getChild(i));
+    }
+}
+
+void TraversalColourTable::store(const juce::ValueTree& traversalData)
+{
+    if (traversalData.getType() != ValueTreeIdentifiers::TraversalData) {
+        return;
+    }
+
+    const int traversalId = traversalData.getProperty(ValueTreeIdentifiers::TraversalId, -1);
+
+    if (traversalId < 0 || traversalId > maxTraversalId) {
+        return;
+    }
+
+    if (static_cast<std::size_t>(traversalId) >= colours.size()) {
+        colours.resize(static_cast<std::size_t>(traversalId) + 1, juce::Colours::white);
+    }
+
+    const juce::String colourString = traversalData.getProperty(ValueTreeIdentifiers::TraversalColour).toString();
+
+    colours[static_cast<std::size_t>(traversalId)] = colourString.isEmpty() ? juce::Colours::white
+                                                                            : juce::Colour::fromString(colourString);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../../Util/PluginModules.h"
+
+#include <vector>
+
+class TraversalColourTable : private juce::ValueTree::Listener
+{
+public:
+
+    explicit TraversalColourTable(juce::ValueTree traversalMap);
+    ~TraversalColourTable() override;
+
+    juce::Colour colourFor(int traversalId) const
+    {
+        if (traversalId < 0 || static_cast<std::size_t>(traversalId) >= colours.size()) {
+            return juce::Colours::white;
+        }
+
+        return colours[static_cast<std::size_t>(traversalId)];
+    }
+
+private:
+
+    void valueTreeChildAdded(juce::ValueTree& parent, juce::ValueTree& child) override;
+    void valueTreeChildRemoved(juce::ValueTree& parent, juce::ValueTree& child, int childIndex) override;
+    void valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& propertyIdentifier) override;
+
+    void rebuild();
+    void store(const juce::ValueTree& traversalData);
+
+    static constexpr int maxTraversalId = 4096;
+
+    juce::ValueTree           traversalMap;
+    std::vector<juce::Colour> colours;
+};
@@ -54,7 +54,15 @@ TraversalMenu::TraversalMenu(ApplicationContext& context, bool showResizer)
         }, context.lookAndFeel);
 
     editTraversalRulesButton->setText("edit traversal rules");
-    editTraversalRulesButton->onClick = [this]() { traversalRulesLauncher.show(); };
+    editTraversalRulesButton->onClick = [this]() {
+        auto* rulesWindow = dynamic_cast<TraversalRulesWindow*>(traversalRulesLauncher.getContent());
+
+        if (rulesWindow != nullptr && rulesWindow->getTraversalId() != selectedTraversalId()) {
+            traversalRulesLauncher.close();
+        }
+
+        traversalRulesLauncher.show();
+    };
 
     addAndMakeVisible(editTraversalRulesButton.get());
 
@@ -122,6 +130,14 @@ void TraversalMenu::selectTraversal(int traversalId) {
     displayMenu.setSelectedItem(traversalId);
 }
 
+int TraversalMenu::selectedTraversalId() const {
+    if (!currentTraversalData.isValid()) {
+        return -1;
+    }
+
+    return currentTraversalData.getProperty(ValueTreeIdentifiers::TraversalId);
+}
+
 TraversalMenu::~TraversalMenu() {
     applicationContext.valueTreeState->traversalMap.removeListener(menuListener.get());
 }
@@ -56,7 +56,7 @@ public:
     PopupWindowLauncher traversalRulesLauncher {
         "Traversal Rules",
         [this]() {
-            auto content = std::make_unique<TraversalRulesWindow>(applicationContext);
+            auto content = std::make_unique<TraversalRulesWindow>(applicationContext, selectedTraversalId());
             content->setSize(TraversalRulesWindow::defaultWidth, TraversalRulesWindow::defaultHeight);
 
             return content;
@@ -67,6 +67,8 @@ private:
 
     juce::ValueTree currentTraversalData;
 
+    int selectedTraversalId() const;
+
     int minimumWidth() const override { return minMenuWidth; }
 
     std::unique_ptr<TraversalMenuListener> menuListener;
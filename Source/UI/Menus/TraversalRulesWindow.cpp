@@ -4,16 +4,22 @@
 
 #include "TraversalRulesWindow.h"
 #include "../Theme/CustomLookAndFeel.h"
+#include "../../Plugin/PluginProcessor.h"
 
-TraversalRulesWindow::TraversalRulesWindow(ApplicationContext& context)
-    : titlebar(context), rulesPanel(context)
+TraversalRulesWindow::TraversalRulesWindow(ApplicationContext& context, int traversalId)
+    : context(context), traversalId(traversalId), titlebar(context), rulesPanel(context)
 {
     setLookAndFeel(context.lookAndFeel);
 
     rulesPanel.onWidthDragged = [this](int newWidth) { setPanelWidth(newWidth); };
+    titlebar.onRunRules       = [this] { compileRules(); };
+
+    configureRuleEditor();
 
     addAndMakeVisible(titlebar);
     addAndMakeVisible(rulesPanel);
+    addAndMakeVisible(ruleEditor);
+    addAndMakeVisible(statusLabel);
 }
 
 TraversalRulesWindow::~TraversalRulesWindow() {
@@ -37,6 +43,9 @@ void TraversalRulesWindow::resized() {
 
     titlebar.setBounds(bounds.removeFromTop(RulesTitlebar::preferredHeight));
     rulesPanel.setBounds(bounds.removeFromLeft(panelWidth));
+
+    statusLabel.setBounds(bounds.removeFromBottom(statusHeight));
+    ruleEditor.setBounds(bounds);
 }
 
 int TraversalRulesWindow::clampPanelWidth(int newWidth) const {
@@ -57,6 +66,62 @@ void TraversalRulesWindow::setPanelWidth(int newWidth) {
     resized();
 }
 
+void TraversalRulesWindow::configureRuleEditor() {
+    const Theme& theme = CustomLookAndFeel::get(*this);
+
+    ruleEditor.setMultiLine(true);
+    ruleEditor.setReturnKeyStartsNewLine(true);
+    ruleEditor.setTabKeyUsedAsCharacter(true);
+    ruleEditor.setScrollbarsShown(true);
+    ruleEditor.setFont(juce::Font(juce::FontOptions(juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain)));
+
+    ruleEditor.setColour(juce::TextEditor::backgroundColourId,     theme.editorColour);
+    ruleEditor.setColour(juce::TextEditor::textColourId,           theme.textColour);
+    ruleEditor.setColour(juce::TextEditor::outlineColourId,        juce::Colours::transparentBlack);
+    ruleEditor.setColour(juce::TextEditor::focusedOutlineColourId, juce::Colours::transparentBlack);
+
+    ruleEditor.setText(context.processor != nullptr ? context.processor->ruleCompileService.getSource(traversalId)
+                                                    : juce::String(RuleCompiler::builtInRuleSource()),
+                       juce::dontSendNotification);
+
+    statusLabel.setColour(juce::Label::textColourId, juce::Colours::lightgrey);
+    statusLabel.setFont(juce::Font(juce::FontOptions(9.0f)));
+}
+
+void TraversalRulesWindow::compileRules() {
+    if (context.processor == nullptr) {
+        return;
+    }
+
+    statusLabel.setText("Compiling...", juce::dontSendNotification);
+
+    juce::Component::SafePointer<TraversalRulesWindow> safeThis (this);
+
+    context.processor->ruleCompileService.compile(traversalId, ruleEditor.getText(), [safeThis](const RuleCompileResult& result) {
+        if (safeThis != nullptr) {
+            safeThis->showCompileResult(result);
+        }
+    });
+}
+
+void TraversalRulesWindow::showCompileResult(const RuleCompileResult& result) {
+    if (!result.succeeded) {
+        statusLabel.setText("Line " + juce::String(result.errorLine) + ", column " + juce::String(result.errorColumn)
+                                + ": " + result.error,
+                            juce::dontSendNotification);
+        return;
+    }
+
+    juce::String status = "Running. Worst case " + juce::String(result.fixedSteps) + " steps";
+
+    if (result.stepsPerChild > 0) {
+        status << " + " << result.stepsPerChild << " per child, budget covers "
+               << result.maxChildrenWithinBudget() << " children";
+    }
+
+    statusLabel.setText(status, juce::dontSendNotification);
+}
+
 TraversalRulesWindow::RulesTitlebar::RulesTitlebar(ApplicationContext& context)
     : Bar(context, { Orientation::horizontal, Background::litFromTop }),
       undoRedoPane(context)
@@ -70,6 +135,11 @@ TraversalRulesWindow::RulesTitlebar::RulesTitlebar(ApplicationContext& context)
         }, context.lookAndFeel);
 
     playButton->setTooltip("Run Rules");
+    playButton->onClick = [this] {
+        if (onRunRules) {
+            onRunRules();
+        }
+    };
 
     addAndMakeVisible(playButton.get());
     addAndMakeVisible(undoRedoPane);
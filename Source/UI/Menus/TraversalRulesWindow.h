@@ -8,6 +8,7 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 
 #include "../../Util/ApplicationContext.h"
+#include "../../Audio/RuleCompiler.h"
 #include "../Bar.h"
 #include "../Buttons/ButtonPane.h"
 #include "../Buttons/IconButton.h"
@@ -25,6 +26,8 @@ public:
 
         static constexpr int preferredHeight = 28;
 
+        std::function<void()> onRunRules;
+
     private:
 
         void paintOverBar(juce::Graphics& g) override;
@@ -36,16 +39,19 @@ public:
         ButtonPane                  undoRedoPane;
     };
 
-    explicit TraversalRulesWindow(ApplicationContext& context);
+    explicit TraversalRulesWindow(ApplicationContext& context, int traversalId = -1);
     ~TraversalRulesWindow() override;
 
     void paint(juce::Graphics& g) override;
     void resized() override;
 
+    int getTraversalId() const { return traversalId; }
+
     static constexpr int defaultWidth  = 360;
     static constexpr int defaultHeight = 260 + RulesTitlebar::preferredHeight;
 
     static constexpr int minContentWidth = 80;
+    static constexpr int statusHeight    = 18;
 
 private:
 
@@ -70,9 +76,19 @@ private:
     int  clampPanelWidth(int newWidth) const;
     void setPanelWidth(int newWidth);
 
+    void configureRuleEditor();
+    void compileRules();
+    void showCompileResult(const RuleCompileResult& result);
+
+    ApplicationContext& context;
+    const int           traversalId;
+
     RulesTitlebar titlebar;
     RulesPanel    rulesPanel;
 
+    juce::TextEditor ruleEditor;
+    juce::Label      statusLabel;
+
     int panelWidth = RulesPanel::defaultPanelWidth;
 };
 
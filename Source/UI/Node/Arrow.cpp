@@ -352,13 +352,13 @@ bool Arrow::advanceHoverFade()
     return false;
 }
 
-void Arrow::startProgress(int traversalId, int durationMs, juce::Colour colour, bool oneShot)
+void Arrow::startProgress(int traversalId, int durationMs, juce::Colour colour, bool oneShot, double startMs)
 {
     if (connectsTraversalFlag()) {
         return;
     }
 
-    progress.start(traversalId, durationMs, colour, oneShot);
+    progress.start(traversalId, durationMs, colour, oneShot, startMs);
     ensureAnimationTimerRunning();
     repaint();
 }
@@ -17,11 +17,11 @@ public:
         bool         oneShot    = false;
     };
 
-    void start(int traversalId, int durationMs, juce::Colour colour, bool oneShot = false)
+    void start(int traversalId, int durationMs, juce::Colour colour, bool oneShot, double startMs)
     {
         Track& track = tracks[traversalId];
         track.t          = 0.0f;
-        track.startMs    = juce::Time::getMillisecondCounterHiRes();
+        track.startMs    = startMs;
         track.durationMs = juce::jmax(1, durationMs);
         track.colour     = colour;
         track.active     = durationMs > 0;
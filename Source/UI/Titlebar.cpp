@@ -39,15 +39,28 @@ Titlebar::Titlebar(ApplicationContext& context)
     auto applyMultiplier = [this]() {
         double value = tempoDisplay.editor.getText().getDoubleValue();
         if (value > 0.0) {
-            applicationContext.processor->tempoMultiplier.store(value);
+            applicationContext.processor->engine.tempoMultiplier.store(value);
         }
         else {
-            tempoDisplay.editor.setText(juce::String(applicationContext.processor->tempoMultiplier.load()), false);
+            tempoDisplay.editor.setText(juce::String(applicationContext.processor->engine.tempoMultiplier.load()), false);
         }
     };
 
     tempoDisplay.editor.onReturnKey = applyMultiplier;
     tempoDisplay.editor.onFocusLost = applyMultiplier;
+
+    refreshTransportState();
+    tempoDisplay.syncButton->onClick = [this]() {
+        const bool shouldSync = !tempoDisplay.syncButton->isSelected();
+
+        tempoDisplay.syncButton->setSelected(shouldSync);
+        applicationContext.processor->engine.syncToHost.store(shouldSync);
+    };
+}
+
+void Titlebar::refreshTransportState()
+{
+    tempoDisplay.syncButton->setSelected(applicationContext.processor->engine.syncToHost.load());
 }
 
 void Titlebar::configureDisplaySelector()
@@ -104,7 +117,7 @@ void Titlebar::togglePlayback()
 
 void Titlebar::resetTraversals()
 {
-    applicationContext.processor->resetRequested.store(true);
+    applicationContext.processor->engine.resetRequested.store(true);
 
     if (auto* canvas = applicationContext.canvas) {
         canvas->arrowManager.resetAllProgress();
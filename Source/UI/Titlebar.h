@@ -26,6 +26,8 @@ public:
 
     std::function<void()> toggled;
 
+    void refreshTransportState();
+
 private:
 
     void paintOverBar(juce::Graphics& g) override;
@@ -0,0 +1,13 @@
+//
+// Created by Eli Baumgardner on 10/17/26.
+//
+
+#ifndef SEQUENCETREE_COREMODULES_H
+#define SEQUENCETREE_COREMODULES_H
+
+#include <juce_core/juce_core.h>                           // For general JUCE utilities like jmap, jlimit
+#include <juce_data_structures/juce_data_structures.h>     // For ValueTree, UndoManager
+#include <juce_audio_basics/juce_audio_basics.h>           // For MidiBuffer, MidiFile, AudioPlayHead
+
+
+#endif //SEQUENCETREE_COREMODULES_H